@@ -0,0 +1,467 @@
+#include <iostream>
+#include <iomanip>
+#include <fstream>
+#include <sstream>
+#include <string>
+#include <vector>
+#include <map>
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <thread>
+#include <random>
+#include <filesystem>
+#include <sys/wait.h>
+#include "bn2.h"
+#include "kernels.h"
+
+// Benchmark suite behind `make bench`:
+//   kernels  GFLOP/s of complete_task1 (a panel) and complete_task2 (the updates of
+//            that panel) per tile size, on an in-memory matrix.
+//   queues   push/pop throughput of CircularQueueMtx and CircularQueueAtomic under
+//            1 to 64 contending threads.
+//   e2e      makespan ("Time taken") of the full factorization over a grid of matrix
+//            sizes and thread counts, running a.out builds with NUM_THREADS set.
+// Every case runs `warmup` untimed repetitions, then `reps` timed ones (measure_exec_time
+// for the in-process suites); the median, p95, p99, min, mean and standard deviation of
+// the repetition times are written as CSV and JSON. --ci stops a kernel or queue case
+// once the 95 % confidence interval of its mean is within that many percent of it,
+// --budget-ms once it has run that long, and --clock selects the clock. With --baseline,
+// medians are compared against an earlier CSV and slowdowns past --tolerance percent
+// fail the run. A factorization that fails or runs past --timeout seconds is killed and its
+// case reported as failed; the suite goes on and the run exits with status 1.
+
+struct BenchOptions {
+    int warmup = 2;
+    int reps = 10;
+    bool kernels = true;
+    bool queues = true;
+    bool e2e = true;
+    std::vector<int> tiles = {10, 20, 40, 80};
+    int kernel_cols = 1024;
+    std::vector<int> queue_threads = {1, 2, 4, 8, 16, 32, 64};
+    size_t queue_ops = 1 << 20;
+    std::vector<int> sizes = {512, 1024, 1536};
+    std::vector<int> e2e_threads = {1, 2, 4, 8, 16, 28};
+    std::string dir = "build/bench";
+    std::string csv = "bench_results.csv";
+    std::string json = "bench_results.json";
+    std::string baseline;
+    double tolerance = 10.0;
+    double ci = 0.0;                    // Percent, 0: always run reps repetitions
+    double budget_ms = 0.0;             // Per case, 0: no limit
+    int timeout_s = 300;                // Per factorization run, 0: no limit
+    TimingClock clock = TimingClock::Steady;
+
+    // Repetitions of an in-process case: reps at most, at least 5 with a confidence target.
+    TimingOptions timing() const {
+        TimingOptions t;
+        t.warmup = warmup;
+        t.min_reps = ci > 0 || budget_ms > 0 ? std::min(reps, 5) : reps;
+        t.max_reps = reps;
+        t.time_budget_ms = budget_ms;
+        t.rel_ci = ci / 100.0;
+        t.clock = clock;
+        return t;
+    }
+};
+
+// Times of one benchmark case, and the work done per repetition.
+struct BenchResult {
+    std::string suite;
+    std::string name;
+    std::string params;             // key=value pairs separated by ';'
+    double work;                    // Work per repetition, in units of rate_unit * seconds
+    std::string rate_unit;
+    TimingResult timing;            // Timed repetitions
+
+    std::string key() const { return suite + "," + name + "," + params; }
+
+    double median() const { return timing.median_ns / 1e6; }
+    double rate() const { return median() > 0 ? work / (median() / 1e3) : 0.0; }
+};
+
+// Runs warmup + reps repetitions of run(), which returns the time it measured itself in
+// milliseconds (the factorization's own "Time taken").
+template <class Run>
+TimingResult repeat(const BenchOptions& options, Run run) {
+    for (int r = 0; r < options.warmup; ++r) {
+        run();
+    }
+    std::vector<double> ns;
+    for (int r = 0; r < options.reps; ++r) {
+        ns.push_back(run() * 1e6);
+    }
+    return TimingResult::summarize(std::move(ns));
+}
+
+// Random matrix with a fixed seed, so every run factors the same values.
+matrix_t<double> random_matrix(int rows, int cols) {
+    matrix_t<double> mat(rows, cols);
+    std::mt19937 rng(42);
+    std::uniform_real_distribution<double> dist(-1.0, 1.0);
+    for (int i = 0; i < rows; ++i) {
+        for (int j = 0; j < cols; ++j) {
+            mat.set(i, j, dist(rng));
+        }
+    }
+    return mat;
+}
+
+// First panel of a square matrix and every update that applies it, with ALPHA = BETA = tile.
+void bench_kernels(const BenchOptions& options, std::vector<BenchResult>& results) {
+    const int n = options.kernel_cols;
+    const matrix_t<double> pristine = random_matrix(n, n);
+    matrix_t<double> mat(n, n);
+    global_up_array.assign(n, 0.0);
+    global_b_array.assign(n, 0.0);
+
+    for (int tile : options.tiles) {
+        if (tile + 1 >= n) {
+            continue;
+        }
+        int row_end = tile + 1;
+        double t1_flops = task_flops(1, n, 1, row_end, 1, row_end);
+        double t2_flops = 0;
+        for (int col = tile + 1; col < n; col += tile) {
+            t2_flops += task_flops(2, n, 1, row_end, col, std::min(col + tile, n));
+        }
+
+        // The updates apply the panel's reflectors, so their setup runs the panel.
+        TimingOptions panel = options.timing();
+        panel.setup = [&]() { mat = pristine; };
+        TimingResult t1 = measure_exec_time(panel, [&]() {
+            complete_task1(mat.view(), n, n, 1, row_end, 1, row_end);
+        });
+        TimingOptions updates = options.timing();
+        updates.setup = [&]() {
+            mat = pristine;
+            complete_task1(mat.view(), n, n, 1, row_end, 1, row_end);
+        };
+        TimingResult t2 = measure_exec_time(updates, [&]() {
+            for (int col = tile + 1; col < n; col += tile) {
+                complete_task2(mat.view(), n, n, 1, row_end, col, std::min(col + tile, n));
+            }
+        });
+
+        std::string params = "tile=" + std::to_string(tile) + ";cols=" + std::to_string(n);
+        results.push_back({"kernels", "complete_task1", params, t1_flops / 1e9, "GFLOP/s", t1});
+        results.push_back({"kernels", "complete_task2", params, t2_flops / 1e9, "GFLOP/s", t2});
+        std::cout << "  tile " << std::setw(4) << tile << ": task1 " << results[results.size() - 2].rate()
+                  << " GFLOP/s, task2 " << results.back().rate() << " GFLOP/s" << std::endl;
+    }
+}
+
+// `threads` threads each push and pop their share of ops elements. start() creates them
+// waiting, so that the timed run() only covers releasing them until the last one is done.
+template <class Queue>
+class QueueRound {
+    Queue queue;
+    std::atomic<bool> go;
+    std::vector<std::thread> workers;
+
+public:
+    QueueRound() : queue(1024), go(false) {}
+
+    void start(int threads, size_t ops) {
+        go.store(false);
+        size_t per_thread = ops / threads;
+        for (int t = 0; t < threads; ++t) {
+            workers.emplace_back([this, t, per_thread]() {
+                while (!go.load(std::memory_order_acquire)) {
+                    std::this_thread::yield();
+                }
+                for (size_t k = 0; k < per_thread; ++k) {
+                    while (!queue.push_back(static_cast<int>(k) + t)) {
+                        std::this_thread::yield();
+                    }
+                    while (!queue.pop_front()) {
+                        std::this_thread::yield();
+                    }
+                }
+            });
+        }
+    }
+
+    void run() {
+        go.store(true, std::memory_order_release);
+        for (auto& worker : workers) {
+            worker.join();
+        }
+        workers.clear();
+    }
+};
+
+template <class Queue>
+TimingResult time_queue(const BenchOptions& options, int threads, size_t ops) {
+    QueueRound<Queue> round;
+    TimingOptions timing = options.timing();
+    timing.setup = [&]() { round.start(threads, ops); };
+    return measure_exec_time(timing, [&]() { round.run(); });
+}
+
+void bench_queues(const BenchOptions& options, std::vector<BenchResult>& results) {
+    for (int threads : options.queue_threads) {
+        size_t ops = options.queue_ops / threads * threads;
+        std::string params = "threads=" + std::to_string(threads);
+        TimingResult mtx = time_queue<CircularQueueMtx<int>>(options, threads, ops);
+        TimingResult atomic = time_queue<CircularQueueAtomic<int>>(options, threads, ops);
+        // A push and a pop per element.
+        results.push_back({"queues", "CircularQueueMtx", params, 2.0 * ops / 1e6, "Mops/s", mtx});
+        results.push_back({"queues", "CircularQueueAtomic", params, 2.0 * ops / 1e6, "Mops/s", atomic});
+        std::cout << "  " << std::setw(2) << threads << " threads: CircularQueueMtx " << results[results.size() - 2].rate()
+                  << " Mops/s, CircularQueueAtomic " << results.back().rate() << " Mops/s" << std::endl;
+    }
+}
+
+// Runs one factorization and returns its "Time taken" line in milliseconds. The run is sent
+// SIGTERM after timeout_s seconds (0: never) and SIGKILL 10 seconds later.
+double run_factorization(const std::string& dir, const std::string& exe, const std::string& matrix, int timeout_s) {
+    std::string limit = timeout_s > 0 ? "timeout -k 10 " + std::to_string(timeout_s) + " " : "";
+    std::string command = "cd '" + dir + "' && " + limit + "'./" + exe + "' '" + matrix + "' 2>&1";
+    FILE* pipe = popen(command.c_str(), "r");
+    if (!pipe) {
+        throw std::runtime_error("Error running " + exe);
+    }
+    std::string output;
+    char buf[4096];
+    while (fgets(buf, sizeof(buf), pipe)) {
+        output += buf;
+    }
+    int status = pclose(pipe);
+    // timeout exits with 124 after SIGTERM and 137 after SIGKILL.
+    if (timeout_s > 0 && WIFEXITED(status) && (WEXITSTATUS(status) == 124 || WEXITSTATUS(status) == 137)) {
+        throw std::runtime_error(exe + " " + matrix + " timed out after " + std::to_string(timeout_s) + " s");
+    }
+    const std::string marker = "Time taken: ";
+    size_t pos = output.find(marker);
+    if (status != 0 || pos == std::string::npos) {
+        throw std::runtime_error(exe + " " + matrix + " failed:\n" + output);
+    }
+    return std::stod(output.substr(pos + marker.size()));
+}
+
+// Cases that failed are added to failed instead of results.
+void bench_e2e(const BenchOptions& options, std::vector<BenchResult>& results, std::vector<std::string>& failed) {
+    for (int size : options.sizes) {
+        std::string matrix = "bench_" + std::to_string(size) + ".bin";
+        if (!std::filesystem::exists(options.dir + "/" + matrix)) {
+            random_matrix(size, size).save(options.dir + "/" + matrix, MatrixFormat::Binary);
+        }
+        // Householder QR of a square matrix: 4/3 n^3 flops.
+        double gflop = 4.0 / 3.0 * size * size * static_cast<double>(size) / 1e9;
+        for (int threads : options.e2e_threads) {
+            std::string exe = "a_t" + std::to_string(threads) + ".out";
+            if (!std::filesystem::exists(options.dir + "/" + exe)) {
+                throw std::runtime_error("Missing " + options.dir + "/" + exe + " (build it with make bench)");
+            }
+            std::string params = "size=" + std::to_string(size) + ";threads=" + std::to_string(threads);
+            std::cout << "  " << std::setw(5) << size << " x " << std::setw(5) << size << ", " << std::setw(2) << threads
+                      << " threads: ";
+            try {
+                TimingResult timing = repeat(options, [&]() {
+                    return run_factorization(options.dir, exe, matrix, options.timeout_s);
+                });
+                results.push_back({"e2e", "factorization", params, gflop, "GFLOP/s", timing});
+                std::cout << results.back().median() << " ms" << std::endl;
+            } catch (const std::runtime_error& e) {
+                failed.push_back("e2e,factorization," + params);
+                std::cout << "FAILED" << std::endl << e.what() << std::endl;
+            }
+        }
+    }
+}
+
+void write_csv(const std::string& filename, const std::vector<BenchResult>& results, const BenchOptions& options) {
+    std::ofstream out(filename, std::ios::trunc);
+    if (!out.is_open()) {
+        throw std::runtime_error("Error opening file for writing: " + filename);
+    }
+    // New columns go last, so older files still work as --baseline.
+    out << "suite,name,params,warmup,reps,median_ms,p95_ms,min_ms,mean_ms,rate,rate_unit,p99_ms,stddev_ms,ci95_ms,clock\n";
+    for (const auto& r : results) {
+        const TimingResult& t = r.timing;
+        out << r.suite << "," << r.name << "," << r.params << "," << options.warmup << "," << t.reps() << ","
+            << t.median_ns / 1e6 << "," << t.p95_ns / 1e6 << "," << t.min_ns / 1e6 << "," << t.mean_ns / 1e6 << ","
+            << r.rate() << "," << r.rate_unit << "," << t.p99_ns / 1e6 << "," << t.stddev_ns / 1e6 << ","
+            << t.ci95_ns / 1e6 << "," << timing_clock_name(t.clock) << "\n";
+    }
+}
+
+void write_json(const std::string& filename, const std::vector<BenchResult>& results, const BenchOptions& options) {
+    std::ofstream out(filename, std::ios::trunc);
+    if (!out.is_open()) {
+        throw std::runtime_error("Error opening file for writing: " + filename);
+    }
+    out << "{\"warmup\":" << options.warmup << ",\"reps\":" << options.reps
+        << ",\"hardware_threads\":" << std::thread::hardware_concurrency() << ",\"results\":[\n";
+    for (size_t k = 0; k < results.size(); ++k) {
+        const auto& r = results[k];
+        out << "{\"suite\":\"" << r.suite << "\",\"name\":\"" << r.name << "\",\"params\":{";
+        std::stringstream params(r.params);
+        std::string pair;
+        for (bool first = true; std::getline(params, pair, ';'); first = false) {
+            size_t eq = pair.find('=');
+            out << (first ? "" : ",") << "\"" << pair.substr(0, eq) << "\":" << pair.substr(eq + 1);
+        }
+        const TimingResult& t = r.timing;
+        out << "},\"median_ms\":" << t.median_ns / 1e6 << ",\"p95_ms\":" << t.p95_ns / 1e6 << ",\"p99_ms\":"
+            << t.p99_ns / 1e6 << ",\"min_ms\":" << t.min_ns / 1e6 << ",\"mean_ms\":" << t.mean_ns / 1e6
+            << ",\"stddev_ms\":" << t.stddev_ns / 1e6 << ",\"ci95_ms\":" << t.ci95_ns / 1e6 << ",\"converged\":"
+            << (t.converged ? "true" : "false") << ",\"clock\":\"" << timing_clock_name(t.clock) << "\",\"rate\":"
+            << r.rate() << ",\"rate_unit\":\"" << r.rate_unit << "\",\"samples_ms\":[";
+        for (size_t s = 0; s < t.samples_ns.size(); ++s) {
+            out << (s ? "," : "") << t.samples_ns[s] / 1e6;
+        }
+        out << "]}" << (k + 1 < results.size() ? ",\n" : "\n");
+    }
+    out << "]}\n";
+}
+
+// Compares medians against a CSV written by an earlier run. Returns the number of cases
+// that got slower by more than tolerance percent.
+int compare_baseline(const std::string& filename, const std::vector<BenchResult>& results, double tolerance) {
+    std::ifstream in(filename);
+    if (!in.is_open()) {
+        throw std::runtime_error("Error opening file: " + filename);
+    }
+    std::map<std::string, double> baseline;
+    std::string line;
+    std::getline(in, line);     // Header
+    while (std::getline(in, line)) {
+        std::vector<std::string> fields;
+        std::stringstream ss(line);
+        for (std::string field; std::getline(ss, field, ',');) {
+            fields.push_back(field);
+        }
+        if (fields.size() >= 6) {
+            baseline[fields[0] + "," + fields[1] + "," + fields[2]] = std::stod(fields[5]);
+        }
+    }
+
+    int regressions = 0;
+    for (const auto& r : results) {
+        auto it = baseline.find(r.key());
+        if (it == baseline.end() || it->second <= 0) {
+            continue;
+        }
+        double change = 100.0 * (r.median() - it->second) / it->second;
+        if (change > tolerance) {
+            std::cout << "REGRESSION " << r.key() << ": median " << r.median() << " ms vs " << it->second
+                      << " ms (+" << change << " %)" << std::endl;
+            ++regressions;
+        }
+    }
+    return regressions;
+}
+
+std::vector<int> parse_list(const std::string& text) {
+    std::vector<int> values;
+    std::string item;
+    for (char c : text + ",") {
+        if (c == ',' || c == ' ') {
+            if (!item.empty()) {
+                values.push_back(std::stoi(item));
+            }
+            item.clear();
+        } else {
+            item += c;
+        }
+    }
+    return values;
+}
+
+int main(int argc, char *argv[]) {
+    BenchOptions options;
+    std::vector<std::string> suites;
+    for (int k = 1; k < argc; ++k) {
+        std::string arg = argv[k];
+        auto value = [&]() -> std::string {
+            if (k + 1 >= argc) {
+                std::cerr << "Missing value for " << arg << std::endl;
+                std::exit(EXIT_FAILURE);
+            }
+            return argv[++k];
+        };
+        if (arg == "--warmup") options.warmup = std::stoi(value());
+        else if (arg == "--reps") options.reps = std::max(std::stoi(value()), 1);
+        else if (arg == "--tiles") options.tiles = parse_list(value());
+        else if (arg == "--kernel-cols") options.kernel_cols = std::stoi(value());
+        else if (arg == "--queue-threads") options.queue_threads = parse_list(value());
+        else if (arg == "--queue-ops") options.queue_ops = std::stoull(value());
+        else if (arg == "--sizes") options.sizes = parse_list(value());
+        else if (arg == "--threads") options.e2e_threads = parse_list(value());
+        else if (arg == "--dir") options.dir = value();
+        else if (arg == "--csv") options.csv = value();
+        else if (arg == "--json") options.json = value();
+        else if (arg == "--baseline") options.baseline = value();
+        else if (arg == "--tolerance") options.tolerance = std::stod(value());
+        else if (arg == "--ci") options.ci = std::stod(value());
+        else if (arg == "--budget-ms") options.budget_ms = std::stod(value());
+        else if (arg == "--timeout") options.timeout_s = std::stoi(value());
+        else if (arg == "--clock") {
+            std::string name = value();
+            if (name == "steady") options.clock = TimingClock::Steady;
+            else if (name == "raw") options.clock = TimingClock::MonotonicRaw;
+            else if (name == "tsc") options.clock = TimingClock::Tsc;
+            else {
+                std::cerr << "Unknown clock " << name << " (steady, raw, tsc)" << std::endl;
+                return EXIT_FAILURE;
+            }
+        }
+        else if (arg == "kernels" || arg == "queues" || arg == "e2e") suites.push_back(arg);
+        else {
+            std::cerr << "Usage: " << argv[0] << " [kernels] [queues] [e2e] [--warmup N] [--reps N]"
+                      << " [--tiles LIST] [--kernel-cols N] [--queue-threads LIST] [--queue-ops N]"
+                      << " [--sizes LIST] [--threads LIST] [--dir DIR] [--csv FILE] [--json FILE]"
+                      << " [--baseline CSV] [--tolerance PERCENT] [--ci PERCENT] [--budget-ms MS]"
+                      << " [--clock steady|raw|tsc] [--timeout SEC]" << std::endl;
+            return EXIT_FAILURE;
+        }
+    }
+    if (!suites.empty()) {
+        options.kernels = std::find(suites.begin(), suites.end(), "kernels") != suites.end();
+        options.queues = std::find(suites.begin(), suites.end(), "queues") != suites.end();
+        options.e2e = std::find(suites.begin(), suites.end(), "e2e") != suites.end();
+    }
+
+    std::vector<BenchResult> results;
+    std::vector<std::string> failed;
+    try {
+        std::cout << std::fixed << std::setprecision(3);
+        if (options.kernels) {
+            std::cout << "Kernels (" << options.kernel_cols << " columns):" << std::endl;
+            bench_kernels(options, results);
+        }
+        if (options.queues) {
+            std::cout << "Queues (" << options.queue_ops << " elements per round):" << std::endl;
+            bench_queues(options, results);
+        }
+        if (options.e2e) {
+            std::cout << "Factorization:" << std::endl;
+            std::filesystem::create_directories(options.dir);
+            bench_e2e(options, results, failed);
+        }
+
+        // Compared before writing, so the baseline may be the previous output file.
+        int regressions = options.baseline.empty() ? 0 : compare_baseline(options.baseline, results, options.tolerance);
+
+        write_csv(options.csv, results, options);
+        write_json(options.json, results, options);
+        std::cout << results.size() << " results (median of up to " << options.reps << " after " << options.warmup
+                  << " warmup, " << timing_clock_name(options.clock) << " clock) written to " << options.csv << " and " << options.json << std::endl;
+
+        for (const auto& key : failed) {
+            std::cout << "Failed: " << key << std::endl;
+        }
+        if (!options.baseline.empty()) {
+            std::cout << regressions << " regressions past " << options.tolerance << " % against "
+                      << options.baseline << std::endl;
+        }
+        return regressions == 0 && failed.empty() ? 0 : 1;
+    } catch (const std::exception& e) {
+        std::cerr << e.what() << std::endl;
+        return EXIT_FAILURE;
+    }
+}
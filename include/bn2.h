@@ -1,3 +1,5 @@
+#pragma once
+
 #include <iostream>
 #include <vector>
 #include <fstream>
@@ -11,135 +13,661 @@
 #include <type_traits>
 
 #include <cmath>
+#include <cstdlib>
+#include <cstring>
+#include <cerrno>
+#include <charconv>
+#include <exception>
+#include <thread>
 #include <algorithm>
 
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
 #include <mutex>
+#include <condition_variable>
 #include <optional>
 #include <atomic>
+#include <limits>
+#include <memory>
+#include <cstdint>
+#include <ctime>
+
+// Hint to the CPU that the calling thread is spinning on shared state.
+inline void cpu_relax() {
+#if defined(__x86_64__) || defined(__i386__)
+    __builtin_ia32_pause();
+#elif defined(__aarch64__)
+    asm volatile("yield");
+#endif
+}
 
-// Helper function to get a string representation of the time unit.
-template <typename Duration>
-constexpr const char* get_time_unit() {
-    if constexpr (std::is_same_v<Duration, std::chrono::nanoseconds>) {
-        return "nanoseconds";
-    } else if constexpr (std::is_same_v<Duration, std::chrono::microseconds>) {
-        return "microseconds";
-    } else if constexpr (std::is_same_v<Duration, std::chrono::milliseconds>) {
-        return "milliseconds";
-    } else if constexpr (std::is_same_v<Duration, std::chrono::seconds>) {
-        return "seconds";
-    } else {
-        return "time units";
+// Clocks measure_exec_time can read.
+enum class TimingClock {
+    Steady,         // std::chrono::steady_clock
+    MonotonicRaw,   // clock_gettime(CLOCK_MONOTONIC_RAW): not slewed by NTP adjustments
+    Tsc             // RDTSC between lfences, scaled by tsc_ns_per_tick(); Steady on other CPUs
+};
+
+inline const char* timing_clock_name(TimingClock clock) {
+    switch (clock) {
+        case TimingClock::Steady: return "steady";
+        case TimingClock::MonotonicRaw: return "raw";
+        case TimingClock::Tsc: return "tsc";
     }
+    return "unknown";
 }
 
-// Function to measure execution time of a given function
-// The default is std::chrono::nanoseconds.
-template <typename TimeUnit = std::chrono::nanoseconds, typename Func, typename... Args>
-auto measure_exec_time(Func&& func, Args&&... args) {
-    auto start = std::chrono::high_resolution_clock::now();
-
-    // Handle functions that return void separately.
-    if constexpr (std::is_void_v<std::invoke_result_t<Func, Args...>>) {
-        std::invoke(std::forward<Func>(func), std::forward<Args>(args)...);
-        auto end = std::chrono::high_resolution_clock::now();
-        auto elapsed = std::chrono::duration_cast<TimeUnit>(end - start);
-        std::cout << "Time elapsed: " << elapsed.count() << " " 
-                  << get_time_unit<TimeUnit>() << "\n";
-        // No value is returned.
+// Nanoseconds per TSC tick, measured against steady_clock over 2 ms on first use.
+inline double tsc_ns_per_tick() {
+#if defined(__x86_64__) || defined(__i386__)
+    static const double ns_per_tick = [] {
+        auto time0 = std::chrono::steady_clock::now();
+        uint64_t tick0 = __builtin_ia32_rdtsc();
+        std::chrono::steady_clock::time_point time1;
+        do {
+            time1 = std::chrono::steady_clock::now();
+        } while (time1 - time0 < std::chrono::milliseconds(2));
+        uint64_t tick1 = __builtin_ia32_rdtsc();
+        return std::chrono::duration<double, std::nano>(time1 - time0).count() / static_cast<double>(tick1 - tick0);
+    }();
+    return ns_per_tick;
+#else
+    return 1.0;
+#endif
+}
+
+// Current reading of clock: nanoseconds, or ticks for Tsc.
+inline uint64_t timing_clock_read(TimingClock clock) {
+    switch (clock) {
+        case TimingClock::MonotonicRaw: {
+            timespec ts;
+            clock_gettime(CLOCK_MONOTONIC_RAW, &ts);
+            return static_cast<uint64_t>(ts.tv_sec) * 1000000000ull + static_cast<uint64_t>(ts.tv_nsec);
+        }
+        case TimingClock::Tsc:
+#if defined(__x86_64__) || defined(__i386__)
+        {
+            // The fences keep the timed code from moving across the reads.
+            __builtin_ia32_lfence();
+            uint64_t ticks = __builtin_ia32_rdtsc();
+            __builtin_ia32_lfence();
+            return ticks;
+        }
+#endif
+        case TimingClock::Steady:
+            break;
+    }
+    return static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::steady_clock::now().time_since_epoch()).count());
+}
+
+// How measure_exec_time repeats a call. After warmup untimed samples it takes timed ones
+// until max_reps of them, until time_budget_ms of wall time have passed since the start,
+// or until the 95 % confidence interval of the mean is within rel_ci of the mean, whichever
+// comes first, but never fewer than min_reps. A sample times batch back-to-back calls and
+// counts their average, which keeps the clock overhead out of sub-microsecond calls. setup,
+// if set, runs untimed before every sample (e.g. to restore the input the call modifies).
+struct TimingOptions {
+    int warmup = 0;
+    int min_reps = 1;
+    int max_reps = 1;
+    int batch = 1;
+    double time_budget_ms = 0;          // 0: no time limit
+    double rel_ci = 0;                  // e.g. 0.01 for +-1 %; 0: no confidence target
+    TimingClock clock = TimingClock::Steady;
+    std::function<void()> setup;
+};
+
+// Statistics of the timed samples of one measurement, in nanoseconds per call.
+struct TimingResult {
+    std::vector<double> samples_ns;     // In the order they were taken
+    double min_ns = 0;
+    double median_ns = 0;
+    double p95_ns = 0;
+    double p99_ns = 0;
+    double max_ns = 0;
+    double mean_ns = 0;
+    double stddev_ns = 0;               // Sample standard deviation
+    double ci95_ns = 0;                 // Half-width of the 95 % confidence interval of the mean
+    bool converged = false;             // Stopped because the confidence target was met
+    TimingClock clock = TimingClock::Steady;
+
+    // Two-sided 95 % Student t quantile for the given degrees of freedom.
+    static double t95(size_t df) {
+        static const double table[] = {12.706, 4.303, 3.182, 2.776, 2.571, 2.447, 2.365, 2.306, 2.262, 2.228,
+                                       2.201, 2.179, 2.160, 2.145, 2.131, 2.120, 2.110, 2.101, 2.093, 2.086,
+                                       2.080, 2.074, 2.069, 2.064, 2.060, 2.056, 2.052, 2.048, 2.045, 2.042};
+        return df == 0 ? 0.0 : df <= 30 ? table[df - 1] : 1.96;
+    }
+
+    // Statistics of the given samples.
+    static TimingResult summarize(std::vector<double> samples, TimingClock clock = TimingClock::Steady) {
+        TimingResult r;
+        r.samples_ns = std::move(samples);
+        r.clock = clock;
+        size_t n = r.samples_ns.size();
+        if (n == 0) {
+            return r;
+        }
+        std::vector<double> sorted(r.samples_ns);
+        std::sort(sorted.begin(), sorted.end());
+        r.min_ns = sorted.front();
+        r.max_ns = sorted.back();
+        r.median_ns = n % 2 ? sorted[n / 2] : (sorted[n / 2 - 1] + sorted[n / 2]) / 2;
+        r.p95_ns = r.percentile(95);
+        r.p99_ns = r.percentile(99);
+        double sum = 0;
+        for (double x : sorted) sum += x;
+        r.mean_ns = sum / n;
+        double squares = 0;
+        for (double x : sorted) squares += (x - r.mean_ns) * (x - r.mean_ns);
+        r.stddev_ns = n > 1 ? std::sqrt(squares / (n - 1)) : 0.0;
+        r.ci95_ns = n > 1 ? t95(n - 1) * r.stddev_ns / std::sqrt(static_cast<double>(n)) : 0.0;
+        return r;
+    }
+
+    // p-th percentile (nearest rank) of the samples.
+    double percentile(double p) const {
+        if (samples_ns.empty()) {
+            return 0.0;
+        }
+        std::vector<double> sorted(samples_ns);
+        std::sort(sorted.begin(), sorted.end());
+        size_t rank = static_cast<size_t>(std::ceil(p / 100.0 * sorted.size()));
+        return sorted[std::min(std::max<size_t>(rank, 1), sorted.size()) - 1];
+    }
+
+    size_t reps() const { return samples_ns.size(); }
+};
+
+// Times func(args...) as set out in options and returns the statistics; the results of
+// the calls are discarded.
+template <typename Func, typename... Args>
+TimingResult measure_exec_time(const TimingOptions& options, Func&& func, Args&&... args) {
+    double ns_per_unit = options.clock == TimingClock::Tsc ? tsc_ns_per_tick() : 1.0;
+    int batch = std::max(options.batch, 1);
+    auto sample = [&]() {
+        if (options.setup) {
+            options.setup();
+        }
+        uint64_t start = timing_clock_read(options.clock);
+        for (int k = 0; k < batch; ++k) {
+            std::invoke(func, args...);
+        }
+        uint64_t end = timing_clock_read(options.clock);
+        return static_cast<double>(end - start) * ns_per_unit / batch;
+    };
+
+    auto begin = std::chrono::steady_clock::now();
+    for (int r = 0; r < options.warmup; ++r) {
+        sample();
+    }
+
+    std::vector<double> samples;
+    double mean = 0, m2 = 0;        // Running mean and sum of squared deviations (Welford)
+    bool converged = false;
+    int max_reps = std::max(options.max_reps, options.min_reps);
+    while (static_cast<int>(samples.size()) < max_reps) {
+        double x = sample();
+        samples.push_back(x);
+        double delta = x - mean;
+        mean += delta / samples.size();
+        m2 += delta * (x - mean);
+
+        size_t n = samples.size();
+        if (static_cast<int>(n) < options.min_reps) {
+            continue;
+        }
+        if (options.rel_ci > 0 && n > 1) {
+            double ci = TimingResult::t95(n - 1) * std::sqrt(m2 / (n - 1) / n);
+            if (ci <= options.rel_ci * mean) {
+                converged = true;
+                break;
+            }
+        }
+        if (options.time_budget_ms > 0 && std::chrono::duration<double, std::milli>(
+                std::chrono::steady_clock::now() - begin).count() >= options.time_budget_ms) {
+            break;
+        }
+    }
+
+    TimingResult result = TimingResult::summarize(std::move(samples), options.clock);
+    result.converged = converged;
+    return result;
+}
+
+// File formats understood by matrix_t::save().
+enum class MatrixFormat {
+    Text,      // Whitespace separated values, one row per line.
+    Binary     // MatrixFileHeader followed by the raw elements.
+};
+
+// Which elements matrix_t::save() writes. Elements outside the part are written as zero.
+enum class MatrixPart {
+    Full,           // Every element.
+    UpperTriangle,  // Elements with col >= row.
+    LowerTriangle   // Elements with col <= row.
+};
+
+// How a binary matrix file is mapped into memory.
+enum class MapMode {
+    ReadOnly,  // Shared read-only mapping; writing to the matrix faults.
+    Private    // Copy-on-write mapping; writes stay private to the process.
+};
+
+// Huge page backing of matrix_t storage.
+enum class HugePages {
+    None,         // Regular pages.
+    Transparent,  // 2 MiB aligned allocation advised with MADV_HUGEPAGE.
+    Explicit      // MAP_HUGETLB; falls back to Transparent when no huge pages are reserved.
+};
+
+// How matrix_t allocates its elements. With pad_ld the leading dimension (the distance
+// between rows, ld()) is rounded up to whole cache lines and then to an odd number of
+// them, so walking down a column spreads over all cache sets instead of aliasing to a
+// few of them when cols() is a power of two. Every row then starts on a cache line.
+struct MatrixStorage {
+    size_t alignment = 64;                      // Alignment of row 0 in bytes, a power of two
+    bool pad_ld = false;                        // Pad the leading dimension as above
+    HugePages huge_pages = HugePages::None;     // Huge page backing
+};
+
+// Element type codes stored in MatrixFileHeader::dtype.
+enum class MatrixDType : uint32_t {
+    Unknown = 0,
+    Float32 = 1,
+    Float64 = 2,
+    Int32   = 3,
+    Int64   = 4
+};
+
+template <class T>
+constexpr MatrixDType matrix_dtype() {
+    if constexpr (std::is_same_v<T, float>) {
+        return MatrixDType::Float32;
+    } else if constexpr (std::is_same_v<T, double>) {
+        return MatrixDType::Float64;
+    } else if constexpr (std::is_integral_v<T> && std::is_signed_v<T> && sizeof(T) == 4) {
+        return MatrixDType::Int32;
+    } else if constexpr (std::is_integral_v<T> && std::is_signed_v<T> && sizeof(T) == 8) {
+        return MatrixDType::Int64;
     } else {
-        auto result = std::invoke(std::forward<Func>(func), std::forward<Args>(args)...);
-        auto end = std::chrono::high_resolution_clock::now();
-        auto elapsed = std::chrono::duration_cast<TimeUnit>(end - start);
-        std::cout << "Time elapsed: " << elapsed.count() << " " 
-                  << get_time_unit<TimeUnit>() << "\n";
-        return result;
+        return MatrixDType::Unknown;
     }
 }
 
+// Header of the binary matrix format. The elements follow at data_offset, which is a
+// multiple of alignment (a page), row-major with consecutive rows ld elements apart,
+// so a file can be mapped and used in place without a parse step.
+struct MatrixFileHeader {
+    static constexpr char MAGIC[8] = {'B', 'N', '2', 'M', 'A', 'T', '\0', '\0'};
+    static constexpr uint32_t VERSION = 1;
+    static constexpr uint64_t ALIGNMENT = 4096;
+
+    char magic[8];          // MAGIC
+    uint32_t version;       // VERSION
+    uint32_t dtype;         // MatrixDType of the elements
+    uint32_t layout;        // 0 = row-major
+    uint32_t elem_size;     // sizeof(element)
+    uint64_t rows;          // Number of rows
+    uint64_t cols;          // Number of columns
+    uint64_t ld;            // Distance between consecutive rows, in elements (>= cols)
+    uint64_t alignment;     // Alignment of data_offset, in bytes
+    uint64_t data_offset;   // Offset of the first element, in bytes
+
+    // Returns true if the first bytes of a file carry the binary format magic.
+    static bool matches(const char* bytes, size_t length) {
+        return length >= sizeof(MAGIC) && std::memcmp(bytes, MAGIC, sizeof(MAGIC)) == 0;
+    }
+};
+
+template <class T>
+class MatrixStreamLoader;
+
+template <class T>
+class MatrixWriter;
+
+template <class T>
+class matrix_view_t;
+
 template <class T>
 class matrix_t {
+    template <class U> friend class MatrixStreamLoader;
+    template <class U> friend class MatrixWriter;
+
 private:
+    // Where the elements live.
+    enum class Backing : unsigned char {
+        None,       // Nothing allocated
+        Heap,       // std::aligned_alloc
+        Anonymous,  // Anonymous huge page mapping
+        File        // Mapped binary matrix file
+    };
+
     int m;   // Number of rows
     int n;   // Number of columns
+    int lda; // Leading dimension: distance between consecutive rows, in elements (>= n)
     T* data; // Pointer to allocated array holding matrix elements
+    void* map_base;     // Start of the mapping when data lives in a mapping
+    size_t map_length;  // Length of the mapping
+    Backing backing;
+    HugePages huge;     // Huge page backing actually obtained
+    MatrixStorage storage;  // Layout of the next allocation
+
+    // Frees owned storage or unmaps a mapping.
+    void release() {
+        if (backing == Backing::Heap) {
+            std::free(data);
+        } else if (map_base != nullptr) {
+            munmap(map_base, map_length);
+        }
+        data = nullptr;
+        map_base = nullptr;
+        map_length = 0;
+        backing = Backing::None;
+        huge = HugePages::None;
+    }
+
+    // Leading dimension of a matrix with cols columns under storage.
+    static int leading_dimension(int cols, const MatrixStorage& storage) {
+        if (!storage.pad_ld || cols <= 0) {
+            return cols;
+        }
+        const int line = static_cast<int>(std::max<size_t>(1, 64 / sizeof(T)));
+        int ld = (cols + line - 1) / line * line;
+        if ((ld / line) % 2 == 0) {
+            ld += line;
+        }
+        return ld;
+    }
+
+    // Replaces the elements with uninitialized storage for a rows x cols matrix laid
+    // out as storage asks.
+    void allocate(int rows, int cols) {
+        static_assert(std::is_trivially_copyable_v<T>, "matrix_t holds raw elements.");
+        release();
+        m = rows;
+        n = cols;
+        lda = leading_dimension(cols, storage);
+        if (m <= 0 || n <= 0) {
+            return;
+        }
+
+        const size_t bytes = static_cast<size_t>(m) * lda * sizeof(T);
+        const size_t huge_page = size_t(1) << 21;
+        if (storage.huge_pages == HugePages::Explicit) {
+            size_t length = (bytes + huge_page - 1) / huge_page * huge_page;
+            void* base = mmap(nullptr, length, PROT_READ | PROT_WRITE,
+                              MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB, -1, 0);
+            if (base != MAP_FAILED) {
+                data = static_cast<T*>(base);
+                map_base = base;
+                map_length = length;
+                backing = Backing::Anonymous;
+                huge = HugePages::Explicit;
+                return;
+            }
+        }
+
+        size_t alignment = std::max({storage.alignment, alignof(T), sizeof(void*)});
+        if (storage.huge_pages != HugePages::None) {
+            alignment = std::max(alignment, huge_page);
+        }
+        void* base = std::aligned_alloc(alignment, (bytes + alignment - 1) / alignment * alignment);
+        if (base == nullptr) {
+            throw std::bad_alloc();
+        }
+        data = static_cast<T*>(base);
+        backing = Backing::Heap;
+        if (storage.huge_pages != HugePages::None
+            && madvise(base, (bytes + alignment - 1) / alignment * alignment, MADV_HUGEPAGE) == 0) {
+            huge = HugePages::Transparent;
+        }
+    }
+
+    // Position of element (row, col) in data. Offsets are 64-bit: rows() * ld() may
+    // exceed 2^31 even though each dimension fits in an int.
+    inline size_t offset(int row, int col) const {
+        return static_cast<size_t>(row) * lda + col;
+    }
+
+    // Copies the elements of other, which has the same shape, row by row.
+    void copy_rows(const matrix_t& other) {
+        for (int i = 0; i < m; ++i) {
+            std::copy(other.data + static_cast<size_t>(i) * other.lda,
+                      other.data + static_cast<size_t>(i) * other.lda + n,
+                      data + static_cast<size_t>(i) * lda);
+        }
+    }
+
+    // Loads a binary matrix file. It is mapped copy-on-write and used in place unless
+    // storage asks for padding or huge pages, which the file layout cannot provide; the
+    // rows are then copied into a new allocation.
+    void load_binary(const std::string& filename) {
+        if (!storage.pad_ld && storage.huge_pages == HugePages::None) {
+            map_binary(filename, MapMode::Private);
+            return;
+        }
+        matrix_t file(filename, MapMode::ReadOnly);
+        allocate(file.m, file.n);
+        copy_rows(file);
+    }
+
+    // Whitespace as understood by operator>>.
+    static bool is_space(char c) {
+        return c == ' ' || c == '\n' || c == '\t' || c == '\r' || c == '\v' || c == '\f';
+    }
+
+    // Calls f(token_begin, token_end) for every whitespace separated token in
+    // [first, last) until f returns false.
+    template <class F>
+    static void for_each_token(const char* first, const char* last, F f) {
+        while (first < last) {
+            while (first < last && is_space(*first)) {
+                ++first;
+            }
+            const char* token = first;
+            while (first < last && !is_space(*first)) {
+                ++first;
+            }
+            if (token < first && !f(token, first)) {
+                return;
+            }
+        }
+    }
+
+    // Number of values on one line.
+    static size_t count_line_values(const char* first, const char* last) {
+        size_t count = 0;
+        for_each_token(first, last, [&](const char*, const char*) {
+            ++count;
+            return true;
+        });
+        return count;
+    }
+
+    // Parses a whole token into value. Returns false if the token is not a number.
+    template <class V>
+    static bool parse_token(const char* first, const char* last, V& value) {
+        if (first < last && *first == '+') {
+            ++first;
+        }
+        auto [ptr, ec] = std::from_chars(first, last, value);
+        return ec == std::errc() && ptr == last;
+    }
+
+    // Parses [first, line_end) as a "rows cols" header line.
+    // Returns false, leaving rows and cols untouched, if it holds anything else.
+    static bool parse_header(const char* first, const char* line_end, int& rows, int& cols) {
+        std::vector<std::pair<const char*, const char*>> tokens;
+        for_each_token(first, line_end, [&](const char* b, const char* e) {
+            tokens.emplace_back(b, e);
+            return tokens.size() <= 2;
+        });
+        int possible_m, possible_n;
+        if (tokens.size() == 2
+            && parse_token(tokens[0].first, tokens[0].second, possible_m)
+            && parse_token(tokens[1].first, tokens[1].second, possible_n)) {
+            rows = possible_m;
+            cols = possible_n;
+            return true;
+        }
+        return false;
+    }
+
+    // Runs body(c) for c in [0, num_chunks), one thread per chunk, and rethrows the
+    // first exception raised by any chunk.
+    template <class F>
+    static void run_chunks(size_t num_chunks, F body) {
+        std::vector<std::exception_ptr> errors(num_chunks);
+        auto guarded = [&](size_t c) {
+            try {
+                body(c);
+            } catch (...) {
+                errors[c] = std::current_exception();
+            }
+        };
+        std::vector<std::thread> workers;
+        for (size_t c = 1; c < num_chunks; ++c) {
+            workers.emplace_back(guarded, c);
+        }
+        guarded(0);
+        for (auto& worker : workers) {
+            worker.join();
+        }
+        for (auto& error : errors) {
+            if (error) {
+                std::rethrow_exception(error);
+            }
+        }
+    }
+
+    // Returns true if element (row, col) belongs to part.
+    static bool in_part(MatrixPart part, int row, int col) {
+        return part == MatrixPart::Full
+            || (part == MatrixPart::UpperTriangle && col >= row)
+            || (part == MatrixPart::LowerTriangle && col <= row);
+    }
+
+    // Formats rows [row_begin, row_end) as text into buffer (replacing its contents),
+    // using the shortest representation that reads back to the same value.
+    void format_rows(std::vector<char>& buffer, size_t row_begin, size_t row_end, MatrixPart part) const {
+        buffer.clear();
+        char digits[64];
+        for (size_t i = row_begin; i < row_end; ++i) {
+            for (int j = 0; j < n; ++j) {
+                T value = in_part(part, static_cast<int>(i), j) ? data[i * lda + j] : T(0);
+                char* end = std::to_chars(digits, digits + sizeof(digits), value).ptr;
+                buffer.insert(buffer.end(), digits, end);
+                buffer.push_back(j < n - 1 ? ' ' : '\n');
+            }
+        }
+    }
+
+    // Writes all of [bytes, bytes + length) to fd.
+    static void write_all(int fd, const char* bytes, size_t length, const std::string& filename) {
+        while (length > 0) {
+            ssize_t written = ::write(fd, bytes, length);
+            if (written < 0) {
+                if (errno == EINTR) {
+                    continue;
+                }
+                throw std::runtime_error("Error writing matrix data to file: " + filename);
+            }
+            bytes += written;
+            length -= static_cast<size_t>(written);
+        }
+    }
 
 public:
     // Default constructor
-    matrix_t() : m(0), n(0), data(nullptr) {}
+    matrix_t() : m(0), n(0), lda(0), data(nullptr), map_base(nullptr), map_length(0),
+                 backing(Backing::None), huge(HugePages::None) {}
+
+    // Empty matrix whose allocations follow storage.
+    explicit matrix_t(const MatrixStorage& storage) : matrix_t() {
+        this->storage = storage;
+    }
 
     // Parameterized constructor
-    matrix_t(int rows, int cols) : m(rows), n(cols), data(nullptr) {
-        if (rows > 0 && cols > 0) {
-            data = new T[rows * cols];
-        }
+    matrix_t(int rows, int cols) : matrix_t() {
+        allocate(rows, cols);
+    }
+
+    matrix_t(int rows, int cols, const MatrixStorage& storage) : matrix_t(storage) {
+        allocate(rows, cols);
+    }
+
+    // Constructor to read matrix from a file (text or binary, see read_matrix).
+    matrix_t(const std::string& filename) : matrix_t() {
+        read_matrix(filename);
     }
 
-    // Constructor to read matrix from a file
-    matrix_t(const std::string& filename) : m(0), n(0), data(nullptr) {
+    matrix_t(const std::string& filename, const MatrixStorage& storage) : matrix_t(storage) {
         read_matrix(filename);
     }
 
+    // Constructor to map a binary matrix file.
+    matrix_t(const std::string& filename, MapMode mode) : matrix_t() {
+        map_binary(filename, mode);
+    }
+
     // Initializer list constructor
-    matrix_t(std::initializer_list<std::initializer_list<T>> init) : m(0), n(0), data(nullptr) {
-        m = static_cast<int>(init.size());
-        n = (m > 0) ? static_cast<int>(init.begin()->size()) : 0;
+    matrix_t(std::initializer_list<std::initializer_list<T>> init) : matrix_t() {
+        int rows = static_cast<int>(init.size());
+        int cols = (rows > 0) ? static_cast<int>(init.begin()->size()) : 0;
 
         // Check that all rows have the same number of columns.
         for (const auto& row : init) {
-            if (static_cast<int>(row.size()) != n) {
+            if (static_cast<int>(row.size()) != cols) {
                 throw std::invalid_argument("All rows in initializer list must have the same number of columns.");
             }
         }
 
         // Allocate memory.
-        if (m * n > 0) {
-            data = new T[m * n];
-        }
+        allocate(rows, cols);
 
         // Populate the matrix.
         int i = 0;
         for (const auto& row : init) {
             int j = 0;
             for (const auto& value : row) {
-                data[i * n + j] = value;
+                data[offset(i, j)] = value;
                 ++j;
             }
             ++i;
         }
     }
 
-    // Copy constructor
-    matrix_t(const matrix_t& other) : m(other.m), n(other.n), data(nullptr) {
-        if (m * n > 0) {
-            data = new T[m * n];
-            for (int i = 0; i < m * n; ++i) {
-                data[i] = other.data[i];
-            }
-        }
+    // Copy constructor (a copy of a mapped matrix owns its storage, laid out like other's
+    // allocations)
+    matrix_t(const matrix_t& other) : matrix_t(other.storage) {
+        allocate(other.m, other.n);
+        copy_rows(other);
     }
 
     // Move constructor
-    matrix_t(matrix_t&& other) noexcept : m(other.m), n(other.n), data(other.data) {
+    matrix_t(matrix_t&& other) noexcept
+        : m(other.m), n(other.n), lda(other.lda), data(other.data), map_base(other.map_base),
+          map_length(other.map_length), backing(other.backing), huge(other.huge), storage(other.storage) {
         other.m = 0;
         other.n = 0;
+        other.lda = 0;
         other.data = nullptr;
+        other.map_base = nullptr;
+        other.map_length = 0;
+        other.backing = Backing::None;
+        other.huge = HugePages::None;
     }
 
-    // Copy assignment operator
+    // Copy assignment operator (the elements are copied into this matrix's storage layout)
     matrix_t& operator=(const matrix_t& other) {
         if (this != &other) {
-            // Delete current data.
-            delete[] data;
-            m = other.m;
-            n = other.n;
-            data = nullptr;
-            if (m * n > 0) {
-                data = new T[m * n];
-                for (int i = 0; i < m * n; ++i) {
-                    data[i] = other.data[i];
-                }
-            }
+            allocate(other.m, other.n);
+            copy_rows(other);
         }
         return *this;
     }
@@ -148,158 +676,251 @@ public:
     matrix_t& operator=(matrix_t&& other) noexcept {
         if (this != &other) {
             // Delete current data.
-            delete[] data;
+            release();
             m = other.m;
             n = other.n;
+            lda = other.lda;
             data = other.data;
+            map_base = other.map_base;
+            map_length = other.map_length;
+            backing = other.backing;
+            huge = other.huge;
+            storage = other.storage;
 
             other.m = 0;
             other.n = 0;
+            other.lda = 0;
             other.data = nullptr;
+            other.map_base = nullptr;
+            other.map_length = 0;
+            other.backing = Backing::None;
+            other.huge = HugePages::None;
         }
         return *this;
     }
 
     // Destructor
     ~matrix_t() {
-        delete[] data;
+        release();
     }
 
     // Fill the matrix with a constant value of type T.
     void fill(const T& value) {
         if (data != nullptr) {
-            std::fill(data, data + m * n, value);
+            std::fill(data, data + static_cast<size_t>(m) * lda, value);
         }
     }
 
     // Method to read matrix from a file.
+    // Binary files (see MatrixFileHeader) are mapped copy-on-write; anything else is
+    // parsed as text by parse_text().
     void read_matrix(const std::string& filename) {
         // Clean up any previously allocated data.
-        delete[] data;
-        data = nullptr;
+        release();
         m = 0;
         n = 0;
+        lda = 0;
 
-        std::ifstream infile(filename);
-        if (!infile.is_open()) {
+        int fd = ::open(filename.c_str(), O_RDONLY);
+        if (fd < 0) {
             throw std::runtime_error("Error opening file: " + filename);
         }
-
-        std::string line;
-        if (!std::getline(infile, line)) {
+        struct stat st;
+        if (fstat(fd, &st) != 0) {
+            ::close(fd);
+            throw std::runtime_error("Error opening file: " + filename);
+        }
+        size_t length = static_cast<size_t>(st.st_size);
+        if (length == 0) {
+            ::close(fd);
             throw std::runtime_error("Error: file is empty.");
         }
 
+        void* base = mmap(nullptr, length, PROT_READ, MAP_PRIVATE, fd, 0);
+        ::close(fd);
+        if (base == MAP_FAILED) {
+            throw std::runtime_error("Error mapping file: " + filename);
+        }
+        madvise(base, length, MADV_SEQUENTIAL);
+
+        const char* text = static_cast<const char*>(base);
+        if (MatrixFileHeader::matches(text, length)) {
+            munmap(base, length);
+            load_binary(filename);
+            return;
+        }
+
+        try {
+            parse_text(text, text + length);
+        } catch (...) {
+            munmap(base, length);
+            throw;
+        }
+        munmap(base, length);
+    }
+
+    // Parses a text matrix held in [first, last).
+    // If the first line holds exactly two integers it is a "rows cols" header and
+    // rows*cols values follow in any whitespace layout. Otherwise every non-empty line
+    // is a row and must have as many values as the first one. The body is split into
+    // line-aligned chunks that are counted and then parsed with std::from_chars in
+    // parallel, straight into the final buffer. num_chunks = 0 picks one chunk per
+    // hardware thread, with at least 4 MiB per chunk.
+    void parse_text(const char* first, const char* last, size_t num_chunks = 0) {
+        release();
+        m = 0;
+        n = 0;
+        lda = 0;
+
+        const char* first_line_end = std::find(first, last, '\n');
+        const char* body = first_line_end == last ? last : first_line_end + 1;
+
         // Try to interpret the first line as a header containing m and n.
-        bool headerParsed = false;
-        {
-            std::istringstream iss(line);
-            int possible_m, possible_n;
-            if (iss >> possible_m >> possible_n) {
-                std::string extra;
-                if (!(iss >> extra)) { // Exactly two tokens found.
-                    headerParsed = true;
-                    m = possible_m;
-                    n = possible_n;
-                }
+        bool headerParsed = parse_header(first, first_line_end, m, n);
+
+        size_t first_row_values = 0;
+        if (!headerParsed) {
+            // No valid header found: the first line is the first row and sets the column count.
+            first_row_values = count_line_values(first, first_line_end);
+            if (first_row_values == 0) {
+                throw std::runtime_error("Error: first line does not contain any matrix data.");
             }
+            n = static_cast<int>(first_row_values);
         }
 
-        if (headerParsed) {
-            // Allocate memory for the matrix data.
-            if (m * n > 0) {
-                data = new T[m * n];
-            }
+        // Split the body into line-aligned chunks, one per parsing thread.
+        const size_t min_chunk_bytes = size_t(1) << 22;
+        size_t body_bytes = static_cast<size_t>(last - body);
+        if (num_chunks == 0) {
+            num_chunks = std::min<size_t>(std::max(1u, std::thread::hardware_concurrency()),
+                                          body_bytes / min_chunk_bytes);
+        }
+        num_chunks = std::max<size_t>(1, std::min(num_chunks, std::max<size_t>(body_bytes, 1)));
+        std::vector<const char*> bounds(num_chunks + 1, last);
+        bounds[0] = body;
+        for (size_t c = 1; c < num_chunks; ++c) {
+            const char* split = std::max(bounds[c - 1], body + body_bytes * c / num_chunks);
+            split = std::find(split, last, '\n');
+            bounds[c] = split == last ? last : split + 1;
+        }
 
-            // Read m*n values from the file.
-            for (int i = 0; i < m; ++i) {
-                for (int j = 0; j < n; ++j) {
-                    if (!(infile >> data[i * n + j])) {
-                        throw std::runtime_error("Error reading matrix value at (" +
-                                                 std::to_string(i) + ", " + std::to_string(j) + ").");
+        // Pass 1: count values (and, without a header, rows) per chunk and validate row widths.
+        std::vector<size_t> chunk_values(num_chunks, 0), chunk_rows(num_chunks, 0);
+        run_chunks(num_chunks, [&](size_t c) {
+            if (headerParsed) {
+                for_each_token(bounds[c], bounds[c + 1], [&](const char*, const char*) {
+                    ++chunk_values[c];
+                    return true;
+                });
+                return;
+            }
+            for (const char* line = bounds[c]; line < bounds[c + 1]; ) {
+                const char* line_end = std::find(line, bounds[c + 1], '\n');
+                size_t col_count = count_line_values(line, line_end);
+                if (col_count != 0) {
+                    if (col_count != static_cast<size_t>(n)) {
+                        throw std::runtime_error("Inconsistent number of columns in the matrix file. "
+                                                 "Expected " + std::to_string(n) + ", but got " +
+                                                 std::to_string(col_count) + ".");
                     }
+                    chunk_values[c] += col_count;
+                    ++chunk_rows[c];
                 }
+                line = line_end + 1;
             }
+        });
 
-            // Ensure there is no extra data.
-            T extra;
-            if (infile >> extra) {
+        std::vector<size_t> offsets(num_chunks + 1, first_row_values);
+        for (size_t c = 0; c < num_chunks; ++c) {
+            offsets[c + 1] = offsets[c] + chunk_values[c];
+        }
+        size_t total = offsets[num_chunks];
+
+        if (headerParsed) {
+            size_t expected = static_cast<size_t>(m) * n;
+            if (total < expected) {
+                throw std::runtime_error("Error reading matrix value at (" +
+                                         std::to_string(total / n) + ", " + std::to_string(total % n) + ").");
+            }
+            if (total > expected) {
                 throw std::runtime_error("Extra data found in the file after reading the matrix.");
             }
         } else {
-            // No valid header found: treat the file as pure matrix data.
-            std::vector<T> temp_data;
-            {
-                std::istringstream row_stream(line);
-                T value;
-                while (row_stream >> value) {
-                    temp_data.push_back(value);
-                }
+            m = 1;
+            for (size_t rows : chunk_rows) {
+                m += static_cast<int>(rows);
             }
-            if (temp_data.empty()) {
-                throw std::runtime_error("Error: first line does not contain any matrix data.");
-            }
-            // Determine number of columns from the first line.
-            n = temp_data.size();
-            m = 1; // One row has been read already.
+        }
 
-            // Process the rest of the file.
-            while (std::getline(infile, line)) {
-                if (line.empty()) {
-                    continue;
+        // Allocate memory for the matrix data.
+        allocate(m, n);
+
+        // Pass 2: parse every chunk into its slice of the buffer.
+        auto parse_range = [&](const char* b, const char* e, size_t offset) {
+            size_t row = n > 0 ? offset / n : 0;
+            int col = n > 0 ? static_cast<int>(offset % n) : 0;
+            for_each_token(b, e, [&](const char* tb, const char* te) {
+                if (!parse_token(tb, te, data[row * lda + col])) {
+                    throw std::runtime_error("Error reading matrix value at (" +
+                                             std::to_string(row) + ", " + std::to_string(col) + ").");
                 }
-                std::istringstream row_stream(line);
-                int col_count = 0;
-                T value;
-                while (row_stream >> value) {
-                    temp_data.push_back(value);
-                    ++col_count;
+                if (++col == n) {
+                    col = 0;
+                    ++row;
                 }
-                if (col_count != n) {
-                    throw std::runtime_error("Inconsistent number of columns in the matrix file. "
-                                             "Expected " + std::to_string(n) + ", but got " +
-                                             std::to_string(col_count) + ".");
-                }
-                ++m;
-            }
-            // Allocate memory and copy the temporary data.
-            if (m * n > 0) {
-                data = new T[m * n];
-            }
-            for (size_t i = 0; i < temp_data.size(); i++) {
-                data[i] = temp_data[i];
+                return true;
+            });
+        };
+        try {
+            if (!headerParsed) {
+                parse_range(first, first_line_end, 0);
             }
+            run_chunks(num_chunks, [&](size_t c) {
+                parse_range(bounds[c], bounds[c + 1], offsets[c]);
+            });
+        } catch (...) {
+            release();
+            m = 0;
+            n = 0;
+            lda = 0;
+            throw;
         }
-        infile.close();
     }
 
     // Accessor methods.
     int rows() const { return m; }
     int cols() const { return n; }
 
+    // Distance between consecutive rows in data_ptr(), in elements (>= cols()).
+    int ld() const { return lda; }
+
+    // Layout of this matrix's allocations, and the huge page backing it obtained.
+    const MatrixStorage& storage_policy() const { return storage; }
+    HugePages huge_pages() const { return huge; }
+
     // Element access operators.
     T& operator()(int row, int col) {
         if (row < 0 || row >= m || col < 0 || col >= n) {
             throw std::out_of_range("Matrix indices out of range");
         }
-        return data[row * n + col];
+        return data[offset(row, col)];
     }
 
     const T& operator()(int row, int col) const {
         if (row < 0 || row >= m || col < 0 || col >= n) {
             throw std::out_of_range("Matrix indices out of range");
         }
-        return data[row * n + col];
+        return data[offset(row, col)];
     }
 
     // Inline getter.
     inline T get(int row, int col) const {
-        return data[row * n + col];
+        return data[offset(row, col)];
     }
 
     // Inline setter.
     inline void set(int row, int col, T value) {
-        data[row * n + col] = value;
+        data[offset(row, col)] = value;
     }
 
     // Return raw pointer to data (non-const and const).
@@ -318,40 +939,543 @@ public:
             return;
         }
 
-        for (int i = 0; i < m; ++i) {
-            for (int j = 0; j < n; ++j) {
-                std::cout << data[i * n + j] << " ";
+        for (int i = 0; i < m; ++i) {
+            for (int j = 0; j < n; ++j) {
+                std::cout << data[offset(i, j)] << " ";
+            }
+            std::cout << "\n";
+        }
+    }
+
+    // Save the matrix to a file.
+    // part restricts the output to a triangle; elements outside it are written as zero.
+    void save(const std::string& filename, MatrixFormat format = MatrixFormat::Text,
+              MatrixPart part = MatrixPart::Full) const {
+        if (m == 0 || n == 0 || data == nullptr) {
+            std::cerr << "Matrix is not allocated.\n";
+            return;
+        }
+
+        if (format == MatrixFormat::Binary) {
+            save_binary(filename, part);
+            return;
+        }
+
+        int fd = ::open(filename.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644);
+        if (fd < 0) {
+            throw std::runtime_error("Error opening file for writing: " + filename);
+        }
+
+        // Rows are formatted in parallel, one block of rows per thread and batch, into
+        // per-thread buffers that are then written in order.
+        const size_t chunk_bytes = size_t(1) << 23;
+        size_t row_bytes = static_cast<size_t>(n) * 25 + 1;
+        size_t rows_per_chunk = std::max<size_t>(1, chunk_bytes / row_bytes);
+        size_t num_chunks = std::max<size_t>(1, std::min<size_t>(std::max(1u, std::thread::hardware_concurrency()),
+                                                                 (m + rows_per_chunk - 1) / rows_per_chunk));
+        std::vector<std::vector<char>> buffers(num_chunks);
+
+        try {
+            for (size_t batch = 0; batch < static_cast<size_t>(m); batch += num_chunks * rows_per_chunk) {
+                run_chunks(num_chunks, [&](size_t c) {
+                    size_t row_begin = std::min<size_t>(batch + c * rows_per_chunk, m);
+                    size_t row_end = std::min<size_t>(row_begin + rows_per_chunk, m);
+                    format_rows(buffers[c], row_begin, row_end, part);
+                });
+                for (const auto& buffer : buffers) {
+                    write_all(fd, buffer.data(), buffer.size(), filename);
+                }
+            }
+        } catch (...) {
+            ::close(fd);
+            throw;
+        }
+
+        if (::close(fd) != 0) {
+            throw std::runtime_error("Error writing matrix data to file: " + filename);
+        }
+    }
+
+    // Save the matrix in the binary format: a MatrixFileHeader, padding up to the
+    // data offset, then the rows as raw elements.
+    void save_binary(const std::string& filename, MatrixPart part = MatrixPart::Full) const {
+        static_assert(matrix_dtype<T>() != MatrixDType::Unknown, "No binary dtype code for this element type.");
+
+        std::ofstream outfile(filename, std::ios::binary | std::ios::trunc);
+        if (!outfile.is_open()) {
+            throw std::runtime_error("Error opening file for writing: " + filename);
+        }
+
+        MatrixFileHeader header = binary_header();
+        std::vector<char> padding(header.data_offset - sizeof(header), 0);
+        outfile.write(reinterpret_cast<const char*>(&header), sizeof(header));
+        outfile.write(padding.data(), padding.size());
+        if (part == MatrixPart::Full && lda == n) {
+            outfile.write(reinterpret_cast<const char*>(data), static_cast<std::streamsize>(sizeof(T)) * m * n);
+        } else {
+            std::vector<T> row(n);
+            for (int i = 0; i < m; ++i) {
+                for (int j = 0; j < n; ++j) {
+                    row[j] = in_part(part, i, j) ? data[static_cast<size_t>(i) * lda + j] : T(0);
+                }
+                outfile.write(reinterpret_cast<const char*>(row.data()), static_cast<std::streamsize>(sizeof(T)) * n);
+            }
+        }
+        if (outfile.fail()) {
+            throw std::runtime_error("Error writing matrix data to file: " + filename);
+        }
+        outfile.close();
+    }
+
+    // Header of this matrix in the binary format.
+    MatrixFileHeader binary_header() const {
+        MatrixFileHeader header{};
+        std::memcpy(header.magic, MatrixFileHeader::MAGIC, sizeof(header.magic));
+        header.version = MatrixFileHeader::VERSION;
+        header.dtype = static_cast<uint32_t>(matrix_dtype<T>());
+        header.layout = 0;
+        header.elem_size = sizeof(T);
+        header.rows = m;
+        header.cols = n;
+        header.ld = n;
+        header.alignment = MatrixFileHeader::ALIGNMENT;
+        header.data_offset = MatrixFileHeader::ALIGNMENT;
+        return header;
+    }
+
+    // Reads and validates the header of a binary matrix file open on fd.
+    // Throws if the file is not a binary matrix of element type T in a supported layout.
+    static MatrixFileHeader read_binary_header(int fd, const std::string& filename) {
+        struct stat st;
+        MatrixFileHeader header;
+        if (fstat(fd, &st) != 0 || static_cast<size_t>(st.st_size) < sizeof(header)
+            || ::pread(fd, &header, sizeof(header), 0) != static_cast<ssize_t>(sizeof(header))) {
+            throw std::runtime_error("Error reading binary matrix header: " + filename);
+        }
+
+        if (!MatrixFileHeader::matches(header.magic, sizeof(header.magic)) || header.version != MatrixFileHeader::VERSION) {
+            throw std::runtime_error("Error: " + filename + " is not a binary matrix file.");
+        }
+        if (header.dtype != static_cast<uint32_t>(matrix_dtype<T>()) || header.elem_size != sizeof(T)) {
+            throw std::runtime_error("Error: element type of " + filename + " does not match the matrix type.");
+        }
+        if (header.layout != 0 || header.ld < header.cols) {
+            throw std::runtime_error("Error: unsupported layout in " + filename + ".");
+        }
+        const uint64_t max_dim = static_cast<uint64_t>(std::numeric_limits<int>::max());
+        if (header.rows > max_dim || header.ld > max_dim) {
+            throw std::runtime_error("Error: dimensions of " + filename + " exceed " + std::to_string(max_dim) + ".");
+        }
+        if (header.data_offset % sizeof(T) != 0
+            || header.data_offset + header.rows * header.ld * sizeof(T) > static_cast<uint64_t>(st.st_size)) {
+            throw std::runtime_error("Error: " + filename + " is truncated.");
+        }
+        return header;
+    }
+
+    // Map a binary matrix file in place. No element is parsed or copied: data points
+    // into the mapping, which is released when the matrix is destroyed.
+    void map_binary(const std::string& filename, MapMode mode) {
+        release();
+        m = 0;
+        n = 0;
+        lda = 0;
+
+        int fd = ::open(filename.c_str(), O_RDONLY);
+        if (fd < 0) {
+            throw std::runtime_error("Error opening file: " + filename);
+        }
+
+        MatrixFileHeader header;
+        struct stat st;
+        try {
+            header = read_binary_header(fd, filename);
+        } catch (...) {
+            ::close(fd);
+            throw;
+        }
+        fstat(fd, &st);
+
+        size_t length = static_cast<size_t>(st.st_size);
+        void* base = mmap(nullptr, length,
+                          mode == MapMode::ReadOnly ? PROT_READ : PROT_READ | PROT_WRITE,
+                          mode == MapMode::ReadOnly ? MAP_SHARED : MAP_PRIVATE,
+                          fd, 0);
+        ::close(fd);
+        if (base == MAP_FAILED) {
+            throw std::runtime_error("Error mapping file: " + filename);
+        }
+
+        map_base = base;
+        map_length = length;
+        backing = Backing::File;
+        m = static_cast<int>(header.rows);
+        n = static_cast<int>(header.cols);
+        lda = static_cast<int>(header.ld);
+        data = reinterpret_cast<T*>(static_cast<char*>(base) + header.data_offset);
+    }
+
+    // Returns true if the elements live in a mapped file.
+    bool is_mapped() const { return backing == Backing::File; }
+
+    // Non-owning view of the whole matrix.
+    matrix_view_t<T> view() { return matrix_view_t<T>(data, m, n, lda); }
+    matrix_view_t<const T> view() const { return matrix_view_t<const T>(data, m, n, lda); }
+
+    // Non-owning view of the rows x cols block whose first element is (row, col).
+    matrix_view_t<T> block(int row, int col, int rows, int cols) { return view().block(row, col, rows, cols); }
+    matrix_view_t<const T> block(int row, int col, int rows, int cols) const {
+        return view().block(row, col, rows, cols);
+    }
+};
+
+// Non-owning view of a rows x cols matrix stored row-major with consecutive rows ld
+// elements apart, e.g. a column block or trailing sub-matrix of a larger matrix_t.
+// Views are cheap to copy and never allocate; the storage must outlive them.
+template <class T>
+class matrix_view_t {
+    T* data;    // Element (0, 0)
+    int m;      // Number of rows
+    int n;      // Number of columns
+    int lda;    // Leading dimension (>= n)
+
+public:
+    matrix_view_t() : data(nullptr), m(0), n(0), lda(0) {}
+
+    matrix_view_t(T* data, int rows, int cols, int ld) : data(data), m(rows), n(cols), lda(ld) {
+        if (rows < 0 || cols < 0 || ld < cols) {
+            throw std::invalid_argument("matrix_view_t: invalid shape " + std::to_string(rows) + " x "
+                                        + std::to_string(cols) + " with leading dimension " + std::to_string(ld));
+        }
+    }
+
+    // A view of mutable elements converts to a view of const ones.
+    template <class U, class = std::enable_if_t<std::is_same_v<const U, T>>>
+    matrix_view_t(const matrix_view_t<U>& other) : data(other.data_ptr()), m(other.rows()), n(other.cols()), lda(other.ld()) {}
+
+    int rows() const { return m; }
+    int cols() const { return n; }
+    int ld() const { return lda; }
+
+    inline T* data_ptr() const { return data; }
+
+    // First element of row r.
+    inline T* row(int r) const { return data + static_cast<size_t>(r) * lda; }
+
+    // Element access with bounds checking.
+    T& operator()(int row, int col) const {
+        if (row < 0 || row >= m || col < 0 || col >= n) {
+            throw std::out_of_range("Matrix indices out of range");
+        }
+        return data[static_cast<size_t>(row) * lda + col];
+    }
+
+    inline T get(int row, int col) const {
+        return data[static_cast<size_t>(row) * lda + col];
+    }
+
+    inline void set(int row, int col, T value) const {
+        data[static_cast<size_t>(row) * lda + col] = value;
+    }
+
+    // The rows x cols block whose first element is (row, col), sharing this view's storage.
+    matrix_view_t block(int row, int col, int rows, int cols) const {
+        if (row < 0 || col < 0 || rows < 0 || cols < 0 || row + rows > m || col + cols > n) {
+            throw std::out_of_range("matrix_view_t: block out of range");
+        }
+        return matrix_view_t(data + static_cast<size_t>(row) * lda + col, rows, cols, lda);
+    }
+};
+
+// Writes a matrix file block by block while the rest of the matrix is still being
+// computed. open() creates the file; a binary file is sized up front so every block
+// of rows goes straight to its final offset with pwrite, in any order. Text blocks are
+// formatted like save() and must arrive in row order, each one placed right after the
+// previous one. close() finishes the file and reports write errors.
+template <class T>
+class MatrixWriter {
+    int fd;
+    std::string filename;
+    const matrix_t<T>* mat;
+    MatrixFormat format;
+    MatrixPart part;
+    uint64_t data_offset;       // Binary: offset of row 0
+    uint64_t text_offset;       // Text: end of the rows written so far
+    int next_row;               // Text: first row not written yet
+    uint64_t bytes;             // Bytes written, header included
+    std::vector<char> text;     // Formatting buffer
+    std::vector<T> masked;      // Rows restricted to part
+
+    void pwrite_all(const char* buf, size_t length, uint64_t offset) {
+        while (length > 0) {
+            ssize_t written = ::pwrite(fd, buf, length, offset);
+            if (written < 0 && errno == EINTR) {
+                continue;
+            }
+            if (written <= 0) {
+                throw std::runtime_error("Error writing matrix data to file: " + filename);
+            }
+            buf += written;
+            offset += static_cast<uint64_t>(written);
+            length -= static_cast<size_t>(written);
+        }
+    }
+
+public:
+    MatrixWriter() : fd(-1), mat(nullptr), format(MatrixFormat::Text), part(MatrixPart::Full),
+                     data_offset(0), text_offset(0), next_row(0), bytes(0) {}
+
+    ~MatrixWriter() {
+        if (fd >= 0) {
+            ::close(fd);
+        }
+    }
+
+    MatrixWriter(const MatrixWriter&) = delete;
+    MatrixWriter& operator=(const MatrixWriter&) = delete;
+
+    // Creates filename for mat. Only the binary header is written here.
+    void open(const std::string& filename, const matrix_t<T>& mat,
+              MatrixFormat format = MatrixFormat::Text, MatrixPart part = MatrixPart::Full) {
+        if (fd >= 0) {
+            ::close(fd);
+        }
+        this->filename = filename;
+        this->mat = &mat;
+        this->format = format;
+        this->part = part;
+        text_offset = 0;
+        next_row = 0;
+        bytes = 0;
+
+        fd = ::open(filename.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644);
+        if (fd < 0) {
+            throw std::runtime_error("Error opening file for writing: " + filename);
+        }
+        if (format == MatrixFormat::Binary) {
+            static_assert(matrix_dtype<T>() != MatrixDType::Unknown, "No binary dtype code for this element type.");
+            MatrixFileHeader header = mat.binary_header();
+            data_offset = header.data_offset;
+            uint64_t size = data_offset + static_cast<uint64_t>(mat.m) * mat.n * sizeof(T);
+            if (::ftruncate(fd, static_cast<off_t>(size)) != 0) {
+                throw std::runtime_error("Error sizing file: " + filename);
+            }
+            posix_fallocate(fd, 0, static_cast<off_t>(size));   // Best effort; ftruncate already sized it.
+            pwrite_all(reinterpret_cast<const char*>(&header), sizeof(header), 0);
+            bytes += sizeof(header);
+        }
+    }
+
+    // Writes rows [row_begin, row_end), which must not change any more.
+    void write_rows(int row_begin, int row_end) {
+        const int n = mat->n;
+        if (row_begin >= row_end) {
+            return;
+        }
+        if (format == MatrixFormat::Binary) {
+            const int ld = mat->lda;
+            const T* rows = mat->data + static_cast<size_t>(row_begin) * ld;
+            size_t length = static_cast<size_t>(row_end - row_begin) * n * sizeof(T);
+            if (part != MatrixPart::Full || ld != n) {
+                // The file rows are packed: drop the padding and mask the part.
+                masked.resize(static_cast<size_t>(row_end - row_begin) * n);
+                for (int i = row_begin; i < row_end; ++i) {
+                    for (int j = 0; j < n; ++j) {
+                        masked[static_cast<size_t>(i - row_begin) * n + j] =
+                            matrix_t<T>::in_part(part, i, j) ? mat->data[static_cast<size_t>(i) * ld + j] : T(0);
+                    }
+                }
+                rows = masked.data();
+            }
+            pwrite_all(reinterpret_cast<const char*>(rows), length,
+                       data_offset + static_cast<uint64_t>(row_begin) * n * sizeof(T));
+            bytes += length;
+            return;
+        }
+
+        if (row_begin != next_row) {
+            throw std::logic_error("MatrixWriter: text rows must be written in order, expected row "
+                                   + std::to_string(next_row) + ", got " + std::to_string(row_begin));
+        }
+        mat->format_rows(text, row_begin, row_end, part);
+        pwrite_all(text.data(), text.size(), text_offset);
+        text_offset += text.size();
+        bytes += text.size();
+        next_row = row_end;
+    }
+
+    // Bytes written so far.
+    uint64_t bytesWritten() const { return bytes; }
+
+    // Closes the file, dropping anything past the rows written.
+    void close() {
+        if (fd < 0) {
+            return;
+        }
+        int result = 0;
+        if (format == MatrixFormat::Text) {
+            result = ::ftruncate(fd, static_cast<off_t>(text_offset));
+        }
+        result |= ::close(fd);
+        fd = -1;
+        if (result != 0) {
+            throw std::runtime_error("Error writing matrix data to file: " + filename);
+        }
+    }
+};
+
+// Loads a matrix file into a matrix_t incrementally, so work on the leading rows can
+// start while the rest of the file is still being read. open() maps the file and
+// sizes the matrix (from the header, or by counting the lines of a headerless file)
+// without parsing a value; parse() then reads the values in file order on the calling
+// thread, typically a dedicated reader, and calls on_rows(r) each time the first r
+// rows are complete. Binary files are mapped by open() and complete at once.
+// Values are parsed sequentially, so on its own this is slower than read_matrix();
+// it pays off when the parse overlaps with work on the rows already loaded.
+template <class T>
+class MatrixStreamLoader {
+    void* base;                 // Mapping of a text file, nullptr otherwise
+    size_t length;
+    const char* body;           // First value after the header, or the first line
+    bool header;                // Whether the file has a "rows cols" header
+    matrix_t<T>* mat;           // Matrix being filled
+
+public:
+    MatrixStreamLoader() : base(nullptr), length(0), body(nullptr), header(false), mat(nullptr) {}
+
+    ~MatrixStreamLoader() {
+        close();
+    }
+
+    MatrixStreamLoader(const MatrixStreamLoader&) = delete;
+    MatrixStreamLoader& operator=(const MatrixStreamLoader&) = delete;
+
+    // Maps filename and sizes mat for it. The elements are allocated but not read.
+    void open(const std::string& filename, matrix_t<T>& mat) {
+        close();
+        this->mat = &mat;
+        mat.release();
+        mat.m = 0;
+        mat.n = 0;
+        mat.lda = 0;
+
+        int fd = ::open(filename.c_str(), O_RDONLY);
+        struct stat st;
+        if (fd < 0 || fstat(fd, &st) != 0) {
+            if (fd >= 0) {
+                ::close(fd);
+            }
+            throw std::runtime_error("Error opening file: " + filename);
+        }
+        length = static_cast<size_t>(st.st_size);
+        if (length == 0) {
+            ::close(fd);
+            throw std::runtime_error("Error: file is empty.");
+        }
+        void* mapped = mmap(nullptr, length, PROT_READ, MAP_PRIVATE, fd, 0);
+        ::close(fd);
+        if (mapped == MAP_FAILED) {
+            throw std::runtime_error("Error mapping file: " + filename);
+        }
+        madvise(mapped, length, MADV_SEQUENTIAL);
+
+        const char* first = static_cast<const char*>(mapped);
+        const char* last = first + length;
+        if (MatrixFileHeader::matches(first, length)) {
+            munmap(mapped, length);
+            length = 0;
+            mat.load_binary(filename);
+            return;
+        }
+        base = mapped;
+
+        const char* first_line_end = std::find(first, last, '\n');
+        int m = 0, n = 0;
+        header = matrix_t<T>::parse_header(first, first_line_end, m, n);
+        if (header) {
+            body = first_line_end == last ? last : first_line_end + 1;
+        } else {
+            n = static_cast<int>(matrix_t<T>::count_line_values(first, first_line_end));
+            if (n == 0) {
+                close();
+                throw std::runtime_error("Error: first line does not contain any matrix data.");
             }
-            std::cout << "\n";
+            // One row per line that is not blank.
+            for (const char* line = first; line < last; ) {
+                const char* line_end = std::find(line, last, '\n');
+                if (std::find_if_not(line, line_end, matrix_t<T>::is_space) != line_end) {
+                    ++m;
+                }
+                line = line_end + 1;
+            }
+            body = first;
         }
+
+        mat.allocate(m, n);
     }
 
-    // Save the matrix to a file.
-    void save(const std::string& filename) const {
-        if (m == 0 || n == 0 || data == nullptr) {
-            std::cerr << "Matrix is not allocated.\n";
+    // Parses the values into the matrix, calling on_rows(r) whenever rows [0, r) are
+    // complete. Throws on malformed input like read_matrix().
+    void parse(const std::function<void(int)>& on_rows) {
+        if (base == nullptr) {
+            on_rows(mat->m);
             return;
         }
 
-        std::ofstream outfile(filename);
-        if (!outfile.is_open()) {
-            throw std::runtime_error("Error opening file for writing: " + filename);
-        }
-
-        // Write the matrix data.
-        for (int i = 0; i < m; ++i) {
-            for (int j = 0; j < n; ++j) {
-                outfile << data[i * n + j];
-                if (j < n - 1) {
-                    outfile << " ";
+        const char* last = static_cast<const char*>(base) + length;
+        const int n = mat->n;
+        const int ld = mat->lda;
+        const size_t total = static_cast<size_t>(mat->m) * n;
+        T* data = mat->data;
+        size_t offset = 0;
+        size_t row = 0;
+        int col = 0;
+        int rows_done = 0;
+
+        for (const char* line = body; line < last; ) {
+            const char* line_end = std::find(line, last, '\n');
+            size_t line_start = offset;
+            matrix_t<T>::for_each_token(line, line_end, [&](const char* tb, const char* te) {
+                if (offset == total) {
+                    throw std::runtime_error("Extra data found in the file after reading the matrix.");
+                }
+                if (!matrix_t<T>::parse_token(tb, te, data[row * ld + col])) {
+                    throw std::runtime_error("Error reading matrix value at (" +
+                                             std::to_string(row) + ", " + std::to_string(col) + ").");
+                }
+                ++offset;
+                if (++col == n) {
+                    col = 0;
+                    ++row;
                 }
+                return true;
+            });
+            if (!header && offset != line_start && offset - line_start != static_cast<size_t>(n)) {
+                throw std::runtime_error("Inconsistent number of columns in the matrix file. "
+                                         "Expected " + std::to_string(n) + ", but got " +
+                                         std::to_string(offset - line_start) + ".");
             }
-            outfile << "\n";
-            if (outfile.fail()) {
-                throw std::runtime_error("Error writing matrix data to file: " + filename);
+            if (static_cast<int>(row) > rows_done) {
+                rows_done = static_cast<int>(row);
+                on_rows(rows_done);
             }
+            line = line_end + 1;
         }
-        outfile.close();
+
+        if (offset < total) {
+            throw std::runtime_error("Error reading matrix value at (" +
+                                     std::to_string(offset / n) + ", " + std::to_string(offset % n) + ").");
+        }
+        close();
+    }
+
+    // Releases the text mapping; the matrix keeps its elements.
+    void close() {
+        if (base != nullptr) {
+            munmap(base, length);
+        }
+        base = nullptr;
+        length = 0;
     }
 };
 
@@ -583,27 +1707,46 @@ struct Task {
     size_t col_end;
     size_t chunk_idx_i;
     size_t chunk_idx_j;
+    uint64_t ready_ticks;      // When the scheduler made it runnable (tracing only)
+    int released_by;           // Thread that made it runnable (tracing only)
 };
 
 class TaskTable {
 private:
     int m;                     // number of task rows
     int n;                     // number of task columns
-    std::vector<Task*> data;      // vector holding pointers to Task objects
+    int alpha;                 // rows per pivot block
+    int beta;                  // rows per target block
+    int mat_rows;              // number of rows of the underlying matrix
+    bool lazy;                 // build task descriptors on demand instead of up front
+    std::vector<Task*> data;      // vector holding pointers to Task objects (eager mode only)
+
+    mutable std::atomic<size_t> live_tasks{0};  // tasks handed out and not yet released (lazy mode)
+    mutable std::atomic<size_t> peak_tasks{0};  // high-water mark of live_tasks (lazy mode)
+
+    // Position of cell (i, j) in data; 64-bit so grids past 2^31 cells index correctly.
+    inline size_t index(int i, int j) const { return static_cast<size_t>(i) * n + j; }
 
 public:
     TaskTable()
-        : m(0), n(0)
+        : m(0), n(0), alpha(0), beta(0), mat_rows(0), lazy(false)
     {
         // 'data' is initially empty.
     }
 
     // Parameterized constructor that calls init().
     template <typename T>
-    TaskTable(int total_task_rows, int total_task_cols, int alpha, int beta, matrix_t<T>& mat)
-        : m(0), n(0)
+    TaskTable(int total_task_rows, int total_task_cols, int alpha, int beta, matrix_t<T>& mat, bool lazy = false)
+        : m(0), n(0), alpha(0), beta(0), mat_rows(0), lazy(false)
+    {
+        init(total_task_rows, total_task_cols, alpha, beta, mat, lazy);
+    }
+
+    template <typename T>
+    TaskTable(int total_task_rows, int total_task_cols, int alpha, int beta, const matrix_view_t<T>& mat, bool lazy = false)
+        : m(0), n(0), alpha(0), beta(0), mat_rows(0), lazy(false)
     {
-        init(total_task_rows, total_task_cols, alpha, beta, mat);
+        init(total_task_rows, total_task_cols, alpha, beta, mat, lazy);
     }
 
     ~TaskTable() {
@@ -616,12 +1759,22 @@ public:
     TaskTable(const TaskTable&) = delete;
     TaskTable& operator=(const TaskTable&) = delete;
 
-    // (Optional) Use default move construction and move assignment.
-    TaskTable(TaskTable&&) noexcept = default;
-    TaskTable& operator=(TaskTable&&) noexcept = default;
+    // Initializes the table. In lazy mode nothing is allocated here: getTask() builds
+    // each descriptor from (i, j) when it is released and releaseTask() frees it.
+    template <typename T>
+    void init(int total_task_rows, int total_task_cols, int alpha, int beta, matrix_t<T>& mat, bool lazy = false) {
+        init(total_task_rows, total_task_cols, alpha, beta, mat.rows(), lazy);
+    }
 
+    // Tasks of the matrix seen through a view, e.g. a block of a larger matrix_t.
     template <typename T>
-    void init(int total_task_rows, int total_task_cols, int alpha, int beta, matrix_t<T>& mat) {
+    void init(int total_task_rows, int total_task_cols, int alpha, int beta, const matrix_view_t<T>& mat, bool lazy = false) {
+        init(total_task_rows, total_task_cols, alpha, beta, mat.rows(), lazy);
+    }
+
+    // Same as above for a matrix of mat_rows rows that is not held in a matrix_t,
+    // e.g. one that stays on disk in out-of-core runs.
+    void init(int total_task_rows, int total_task_cols, int alpha, int beta, int mat_rows, bool lazy = false) {
         // Delete any previously allocated tasks.
         for (Task* t : data) {
             delete t;
@@ -630,57 +1783,89 @@ public:
 
         m = total_task_rows;
         n = total_task_cols;
-        data.resize(m * n, nullptr);
+        this->alpha = alpha;
+        this->beta = beta;
+        this->mat_rows = mat_rows;
+        this->lazy = lazy;
+        live_tasks.store(0, std::memory_order_relaxed);
+        peak_tasks.store(0, std::memory_order_relaxed);
+
+        if (lazy) {
+            return;
+        }
 
-        int beta_div_alpha = beta / alpha;
+        data.resize(static_cast<size_t>(m) * n, nullptr);
 
-        int ctr = 1;
         for (int i = 0; i < m; ++i) {
             for (int j = 0; j < n; ++j) {
-                Task* new_task = new Task();
-
-                // Set the type and possibly the enq_nxt_t1 flag based on the indices and beta_by_alpha.
-                if (i * beta_div_alpha <= j && j < (i+1) * beta_div_alpha){
-                    new_task->type = 1;
-                    ctr = i + 1;
-                } else {
-                    new_task->type = 2;
-                    if (i == ctr && ((i-1) * beta_div_alpha <= j && j < i * beta_div_alpha)){
-                        new_task->enq_nxt_t1 = true;
-                    } else {
-                        new_task->enq_nxt_t1 = false;
-                    }
-                }
+                // Cells outside the designated range are left as nullptr.
+                data[index(i, j)] = makeTask(i, j);
+            }
+        }
+    }
 
-                // If j is outside the designated range, free new_task and leave the cell as nullptr.
-                if (j >= (i+1) * beta_div_alpha) {
-                    delete new_task;
-                    continue;
-                }
+    // Builds the descriptor of task (i, j) from its position alone.
+    // Returns nullptr if (i, j) lies outside the designated range.
+    Task* makeTask(int i, int j) const {
+        int beta_div_alpha = beta / alpha;
+
+        if (j >= (i+1) * beta_div_alpha) {
+            return nullptr;
+        }
 
-                // Set the boundaries for the task.
-                new_task->row_start   = alpha * j + 1;
-                new_task->row_end     = std::min(alpha *(j + 1) + 1, mat.rows());
-                new_task->col_start   = beta * i + 1;
-                new_task->col_end     = std::min(beta  *(i + 1) + 1, mat.rows());
-                new_task->chunk_idx_i = i;
-                new_task->chunk_idx_j = j;
+        Task* new_task = new Task();
 
-                // Store the task pointer in the vector.
-                data[i * n + j] = new_task;
-            }
+        // Set the type and possibly the enq_nxt_t1 flag based on the indices and beta_by_alpha.
+        // Type-2 tasks directly below the previous panel release the next type-1 task.
+        if (i * beta_div_alpha <= j && j < (i+1) * beta_div_alpha){
+            new_task->type = 1;
+            new_task->enq_nxt_t1 = false;
+        } else {
+            new_task->type = 2;
+            new_task->enq_nxt_t1 = (i >= 1 && (i-1) * beta_div_alpha <= j && j < i * beta_div_alpha);
         }
+
+        // Set the boundaries for the task.
+        new_task->row_start   = alpha * j + 1;
+        new_task->row_end     = std::min(alpha *(j + 1) + 1, mat_rows);
+        new_task->col_start   = beta * i + 1;
+        new_task->col_end     = std::min(beta  *(i + 1) + 1, mat_rows);
+        new_task->chunk_idx_i = i;
+        new_task->chunk_idx_j = j;
+
+        // Priority falls off with the distance below the panel that produced the task:
+        // panels get 255, the updates that release the next panel 254, and so on.
+        new_task->priority = static_cast<unsigned char>(255 - std::min(i - j / beta_div_alpha, 255));
+
+        return new_task;
     }
 
     inline Task* getTask(int i, int j) const {
-        return data[i * n + j];
+        if (lazy) {
+            size_t live = live_tasks.fetch_add(1, std::memory_order_relaxed) + 1;
+            size_t peak = peak_tasks.load(std::memory_order_relaxed);
+            while (live > peak && !peak_tasks.compare_exchange_weak(peak, live, std::memory_order_relaxed)) { }
+            return makeTask(i, j);
+        }
+        return data[index(i, j)];
+    }
+
+    // Hands a finished task back to the table. Frees it in lazy mode, no-op otherwise.
+    inline void releaseTask(Task* task) const {
+        if (lazy) {
+            live_tasks.fetch_sub(1, std::memory_order_relaxed);
+            delete task;
+        }
     }
 
     // Overloaded operator() for accessing the task at (i, j) with bounds checking.
+    // Not available in lazy mode, where no descriptor is stored.
     Task* operator()(int i, int j) const {
         if (i >= m || j >= n)
             throw std::out_of_range("Index out of bounds in TaskTable::operator()");
-        return data[i * n + j];
+        if (lazy)
+            throw std::logic_error("TaskTable::operator() is not available in lazy mode");
+        return data[index(i, j)];
     }
 
     // Prints the task table.
@@ -688,11 +1873,13 @@ public:
     void printTaskTable() const {
         for (int i = 0; i < m; ++i) {
             for (int j = 0; j < n; ++j) {
-                Task* t = data[i * n + j];
+                Task* t = lazy ? makeTask(i, j) : data[index(i, j)];
                 if (t)
                     std::cout << static_cast<int>(t->type) << " ";
                 else
                     std::cout << "N ";
+                if (lazy)
+                    delete t;
             }
             std::cout << "\n";
         }
@@ -701,8 +1888,321 @@ public:
     // Accessors for the number of rows and columns.
     int rows() const { return m; }
     int cols() const { return n; }
+
+    // Number of tasks in the table, i.e. the number of non-empty cells.
+    size_t taskCount() const {
+        int beta_div_alpha = beta / alpha;
+        size_t total = 0;
+        for (int i = 0; i < m; ++i) {
+            total += std::min((i+1) * beta_div_alpha, n);
+        }
+        return total;
+    }
+
+    // Block sizes and matrix height the table was built for.
+    int getAlpha() const { return alpha; }
+    int getBeta() const { return beta; }
+    int matrixRows() const { return mat_rows; }
+
+    // Matrix rows [targetRowBegin(i), targetRowEnd(i)) updated by the tasks of row i.
+    // Only those tasks write them, so they are final once the last task of row i is done.
+    int targetRowBegin(int i) const { return i == 0 ? 0 : beta * i + 1; }
+    int targetRowEnd(int i) const { return std::min(beta * (i + 1) + 1, mat_rows); }
+
+    // Lazy-mode bookkeeping: descriptors currently alive and the peak reached so far.
+    bool isLazy() const { return lazy; }
+    size_t liveTasks() const { return live_tasks.load(std::memory_order_relaxed); }
+    size_t peakLiveTasks() const { return peak_tasks.load(std::memory_order_relaxed); }
+};
+
+// Dependency tracking with one completion counter per task row instead of a full grid.
+// Tasks of a row complete strictly left to right (task (i, j) is only released once
+// (i, j-1) is done), so "(i, j) is done" is equivalent to "progress[i] > j". Memory is
+// O(rows), which keeps lazy runs bounded by the active wavefront.
+class DependencyFrontier {
+    size_t m;                       // Number of rows
+    size_t n;                       // Number of columns
+    std::atomic<size_t>* progress;  // Number of completed tasks per row
+
+public:
+    // Default constructor
+    DependencyFrontier() : m(0), n(0), progress(nullptr) {}
+
+    // Constructor: Initializes the frontier with given rows and columns
+    DependencyFrontier(size_t total_task_rows, size_t total_task_cols)
+        : m(0), n(0), progress(nullptr)
+    {
+        init(total_task_rows, total_task_cols);
+    }
+
+    // Destructor: Frees the dynamically allocated memory
+    ~DependencyFrontier() {
+        delete[] progress;
+    }
+
+    // Deleted copy constructor and copy assignment to prevent accidental copying
+    DependencyFrontier(const DependencyFrontier&) = delete;
+    DependencyFrontier& operator=(const DependencyFrontier&) = delete;
+
+    // Initializes the frontier with given rows and columns
+    void init(size_t total_task_rows, size_t total_task_cols) {
+        delete[] progress;
+
+        m = total_task_rows;
+        n = total_task_cols;
+        progress = new std::atomic<size_t>[m];
+
+        for (size_t i = 0; i < m; ++i) {
+            progress[i].store(0, std::memory_order_relaxed);
+        }
+    }
+
+    // Retrieves the dependency value at (i, j)
+    inline bool getDependency(size_t i, size_t j) const {
+        return progress[i].load(std::memory_order_acquire) > j;
+    }
+
+    // Marks (i, j) as done. Setting a cell back to false is not supported since
+    // completion within a row is monotone.
+    inline void setDependency(size_t i, size_t j, bool value) {
+        if (value) {
+            progress[i].store(j + 1, std::memory_order_release);
+        }
+    }
+
+    // Overloaded operator() for safe indexing (read)
+    bool operator()(size_t i, size_t j) const {
+        if (i >= m || j >= n) {
+            throw std::out_of_range("Index out of bounds: (" + std::to_string(i)
+                                    + ", " + std::to_string(j) + ")");
+        }
+        return getDependency(i, j);
+    }
+
+    // Number of completed tasks in row i.
+    inline size_t rowProgress(size_t i) const {
+        return progress[i].load(std::memory_order_acquire);
+    }
+
+    // Accessors for rows and columns
+    size_t rows() const { return m; }
+    size_t cols() const { return n; }
+};
+
+// Set QUEUE_STATS to 1 (e.g. make DEFINES=-DQUEUE_STATS=1) to collect contention
+// and occupancy counters inside the queue classes. When 0 the hooks compile away.
+#ifndef QUEUE_STATS
+#define QUEUE_STATS 0
+#endif
+
+// Contention and occupancy counters of a queue.
+struct QueueStats {
+    uint64_t pushes = 0;             // Successful pushes.
+    uint64_t push_failures = 0;      // Pushes rejected because the queue was full.
+    uint64_t pops = 0;               // Successful pops.
+    uint64_t empty_pops = 0;         // Pops that found the queue empty.
+    uint64_t lock_acquisitions = 0;  // Number of times the queue lock was taken.
+    uint64_t lock_wait_ns = 0;       // Total time spent waiting for the lock.
+    uint64_t max_lock_wait_ns = 0;   // Longest single wait for the lock.
+    uint64_t lock_hold_ns = 0;       // Total time the lock was held.
+    uint64_t cas_failures = 0;       // Failed compare-exchange attempts.
+    size_t high_water = 0;           // Largest number of elements observed.
+
+    QueueStats& operator+=(const QueueStats& other) {
+        pushes += other.pushes;
+        push_failures += other.push_failures;
+        pops += other.pops;
+        empty_pops += other.empty_pops;
+        lock_acquisitions += other.lock_acquisitions;
+        lock_wait_ns += other.lock_wait_ns;
+        max_lock_wait_ns = std::max(max_lock_wait_ns, other.max_lock_wait_ns);
+        lock_hold_ns += other.lock_hold_ns;
+        cas_failures += other.cas_failures;
+        high_water = std::max(high_water, other.high_water);
+        return *this;
+    }
+
+    // Prints a one-block summary of the counters.
+    void print(std::ostream &os, const std::string& name) const {
+        os << "Queue stats [" << name << "]\n"
+           << "  pushes: " << pushes << " (" << push_failures << " failed, full)\n"
+           << "  pops: " << pops << " (" << empty_pops << " found empty)\n"
+           << "  high-water mark: " << high_water << "\n";
+        if (lock_acquisitions > 0) {
+            os << "  lock acquisitions: " << lock_acquisitions
+               << ", avg wait " << lock_wait_ns / lock_acquisitions << " ns"
+               << ", max wait " << max_lock_wait_ns << " ns"
+               << ", avg hold " << lock_hold_ns / lock_acquisitions << " ns\n";
+        }
+        if (cas_failures > 0) {
+            os << "  CAS failures: " << cas_failures << "\n";
+        }
+    }
+};
+
+// Process-wide slot numbers for QueueStatsCollector. A thread takes the lowest free
+// number on its first queue operation and returns it when it exits, so threads alive at
+// the same time never share a slot and the numbers stay as small as the peak thread count.
+class QueueStatsSlots {
+    std::mutex mutex;
+    std::vector<size_t> free_slots;     // Returned numbers, as a min-heap
+    size_t next = 0;                    // Lowest number never handed out
+
+    struct Holder {
+        size_t slot;
+        Holder() : slot(instance().acquire()) {}
+        ~Holder() { instance().release(slot); }
+    };
+
+    static QueueStatsSlots& instance() {
+        static QueueStatsSlots slots;
+        return slots;
+    }
+
+    size_t acquire() {
+        std::lock_guard<std::mutex> lock(mutex);
+        if (free_slots.empty()) {
+            return next++;
+        }
+        std::pop_heap(free_slots.begin(), free_slots.end(), std::greater<size_t>());
+        size_t slot = free_slots.back();
+        free_slots.pop_back();
+        return slot;
+    }
+
+    void release(size_t slot) {
+        std::lock_guard<std::mutex> lock(mutex);
+        free_slots.push_back(slot);
+        std::push_heap(free_slots.begin(), free_slots.end(), std::greater<size_t>());
+    }
+
+public:
+    // Slot number of the calling thread.
+    static size_t current() {
+        thread_local Holder holder;
+        return holder.slot;
+    }
+};
+
+// Per-thread QueueStats slots for one queue. Every thread updates its own cache
+// line, so collecting statistics does not add contention between threads. Slots are
+// allocated in chunks as thread numbers grow, up to MAX_THREADS threads alive at once;
+// a slot reused by a later thread keeps adding to the same sums. summary() is meant to
+// be read after the threads using the queue have finished.
+class QueueStatsCollector {
+    static constexpr size_t CHUNK = 64;
+    static constexpr size_t MAX_CHUNKS = 64;
+    static constexpr size_t MAX_THREADS = CHUNK * MAX_CHUNKS;
+
+    struct alignas(64) Slot {
+        QueueStats stats;
+    };
+
+    std::atomic<Slot*> chunks[MAX_CHUNKS];
+
+    // Allocates chunk c, unless another thread got there first.
+    Slot* allocate(size_t c) {
+        if (c >= MAX_CHUNKS) {
+            std::cerr << "Error: queue stats support at most " << MAX_THREADS << " threads at once" << std::endl;
+            std::exit(EXIT_FAILURE);
+        }
+        Slot* chunk = new Slot[CHUNK];
+        Slot* expected = nullptr;
+        if (!chunks[c].compare_exchange_strong(expected, chunk, std::memory_order_acq_rel)) {
+            delete[] chunk;
+            return expected;
+        }
+        return chunk;
+    }
+
+public:
+    QueueStatsCollector() {
+        for (auto& chunk : chunks) {
+            chunk.store(nullptr, std::memory_order_relaxed);
+        }
+    }
+
+    ~QueueStatsCollector() {
+        for (auto& chunk : chunks) {
+            delete[] chunk.load(std::memory_order_relaxed);
+        }
+    }
+
+    QueueStatsCollector(const QueueStatsCollector&) = delete;
+    QueueStatsCollector& operator=(const QueueStatsCollector&) = delete;
+
+    // Counters of the calling thread.
+    inline QueueStats& local() {
+        size_t slot = QueueStatsSlots::current();
+        size_t c = slot / CHUNK;
+        Slot* chunk = c < MAX_CHUNKS ? chunks[c].load(std::memory_order_acquire) : nullptr;
+        if (chunk == nullptr) {
+            chunk = allocate(c);
+        }
+        return chunk[slot % CHUNK].stats;
+    }
+
+    // Counters summed over all threads.
+    QueueStats summary() const {
+        QueueStats total;
+        for (const auto& chunk : chunks) {
+            Slot* slots = chunk.load(std::memory_order_acquire);
+            for (size_t i = 0; slots != nullptr && i < CHUNK; ++i) {
+                total += slots[i].stats;
+            }
+        }
+        return total;
+    }
+
+    // Clears every slot.
+    void reset() {
+        for (auto& chunk : chunks) {
+            Slot* slots = chunk.load(std::memory_order_acquire);
+            for (size_t i = 0; slots != nullptr && i < CHUNK; ++i) {
+                slots[i].stats = QueueStats();
+            }
+        }
+    }
+};
+
+// Lock guard that records wait and hold times of a mutex into a QueueStats.
+class TimedLockGuard {
+    std::mutex& mutex;
+    QueueStats& stats;
+    std::chrono::steady_clock::time_point acquired;
+
+public:
+    TimedLockGuard(std::mutex& mutex, QueueStats& stats) : mutex(mutex), stats(stats) {
+        auto start = std::chrono::steady_clock::now();
+        mutex.lock();
+        acquired = std::chrono::steady_clock::now();
+        uint64_t wait_ns = std::chrono::duration_cast<std::chrono::nanoseconds>(acquired - start).count();
+        stats.lock_wait_ns += wait_ns;
+        stats.max_lock_wait_ns = std::max(stats.max_lock_wait_ns, wait_ns);
+        ++stats.lock_acquisitions;
+    }
+
+    ~TimedLockGuard() {
+        stats.lock_hold_ns += std::chrono::duration_cast<std::chrono::nanoseconds>(
+            std::chrono::steady_clock::now() - acquired).count();
+        mutex.unlock();
+    }
+
+    TimedLockGuard(const TimedLockGuard&) = delete;
+    TimedLockGuard& operator=(const TimedLockGuard&) = delete;
 };
 
+#if QUEUE_STATS
+    #define QUEUE_LOCK_GUARD(lock, mtx) TimedLockGuard lock(mtx, stats_collector.local())
+    #define QUEUE_STATS_INC(field) (++stats_collector.local().field)
+    #define QUEUE_STATS_MAX(field, value) \
+        (stats_collector.local().field = std::max<size_t>(stats_collector.local().field, (value)))
+#else
+    #define QUEUE_LOCK_GUARD(lock, mtx) std::lock_guard<std::mutex> lock(mtx)
+    #define QUEUE_STATS_INC(field) ((void)0)
+    #define QUEUE_STATS_MAX(field, value) ((void)0)
+#endif
+
 template <class T>
 class CircularQueueMtx {
     std::vector<T> buffer;      // Internal storage.
@@ -711,6 +2211,9 @@ class CircularQueueMtx {
     size_t rear;                // Index one past the last element.
     size_t count;               // Number of elements in the queue.
     mutable std::mutex mutex;   // Mutex for thread-safety.
+#if QUEUE_STATS
+    mutable QueueStatsCollector stats_collector;  // Per-thread contention counters.
+#endif
 
     public:
     // Construct a circular queue with fixed capacity.
@@ -721,39 +2224,43 @@ class CircularQueueMtx {
 
     // Returns true if the queue is empty.
     bool empty() const {
-        std::lock_guard<std::mutex> lock(mutex);
+        QUEUE_LOCK_GUARD(lock, mutex);
         return count == 0;
     }
 
     // Returns true if the queue is full.
     bool full() const {
-        std::lock_guard<std::mutex> lock(mutex);
+        QUEUE_LOCK_GUARD(lock, mutex);
         return count == capacity;
     }
 
     // Returns the current number of elements.
     size_t size() const {
-        std::lock_guard<std::mutex> lock(mutex);
+        QUEUE_LOCK_GUARD(lock, mutex);
         return count;
     }
 
     // Push an element at the front of the queue.
     // Returns true if the operation was successful (i.e. the queue wasn’t full).
     bool push_front(const T &value) {
-        std::lock_guard<std::mutex> lock(mutex);
+        QUEUE_LOCK_GUARD(lock, mutex);
         if (count == capacity) {
+            QUEUE_STATS_INC(push_failures);
             return false;  // Queue is full.
         }
         // Move front backward (circularly) and store the value.
         front = (front + capacity - 1) % capacity;
         buffer[front] = value;
         ++count;
+        QUEUE_STATS_INC(pushes);
+        QUEUE_STATS_MAX(high_water, count);
         return true;
     }
 
     bool push_rotated(const T &value) {
-        std::lock_guard<std::mutex> lock(mutex);
+        QUEUE_LOCK_GUARD(lock, mutex);
         if (count == capacity) {
+            QUEUE_STATS_INC(push_failures);
             return false;  // Queue is full.
         }
         buffer[rear] = value;
@@ -763,19 +2270,24 @@ class CircularQueueMtx {
         }
         rear = (rear + 1) % capacity;
         ++count;
+        QUEUE_STATS_INC(pushes);
+        QUEUE_STATS_MAX(high_water, count);
         return true;
     }
 
     // Push an element at the back of the queue.
     // Returns true if the operation was successful (i.e. the queue wasn’t full).
     bool push_back(const T &value) {
-        std::lock_guard<std::mutex> lock(mutex);
+        QUEUE_LOCK_GUARD(lock, mutex);
         if (count == capacity) {
+            QUEUE_STATS_INC(push_failures);
             return false;  // Queue is full.
         }
         buffer[rear] = value;
         rear = (rear + 1) % capacity;
         ++count;
+        QUEUE_STATS_INC(pushes);
+        QUEUE_STATS_MAX(high_water, count);
         return true;
     }
 
@@ -787,26 +2299,30 @@ class CircularQueueMtx {
     // Pop an element from the front.
     // If the queue is empty, returns std::nullopt.
     std::optional<T> pop_front() {
-        std::lock_guard<std::mutex> lock(mutex);
+        QUEUE_LOCK_GUARD(lock, mutex);
         if (count == 0) {
+            QUEUE_STATS_INC(empty_pops);
             return std::nullopt;  // Queue is empty.
         }
         T value = buffer[front];
         front = (front + 1) % capacity;
         --count;
+        QUEUE_STATS_INC(pops);
         return value;
     }
 
     // Pop an element from the back.
     // If the queue is empty, returns std::nullopt.
     std::optional<T> pop_back() {
-        std::lock_guard<std::mutex> lock(mutex);
+        QUEUE_LOCK_GUARD(lock, mutex);
         if (count == 0) {
+            QUEUE_STATS_INC(empty_pops);
             return std::nullopt;  // Queue is empty.
         }
         rear = (rear + capacity - 1) % capacity;
         T value = buffer[rear];
         --count;
+        QUEUE_STATS_INC(pops);
         return value;
     }
 
@@ -814,6 +2330,22 @@ class CircularQueueMtx {
     std::optional<T> pop() {
         return pop_front();
     }
+
+    // Contention counters summed over all threads (all zero unless built with QUEUE_STATS).
+    QueueStats stats() const {
+#if QUEUE_STATS
+        return stats_collector.summary();
+#else
+        return QueueStats();
+#endif
+    }
+
+    // Clears the contention counters.
+    void reset_stats() {
+#if QUEUE_STATS
+        stats_collector.reset();
+#endif
+    }
 };
 
 template<class T>
@@ -827,6 +2359,9 @@ class CircularQueueAtomic {
 
     // A mutex used only for query operations.
     mutable std::mutex query_mutex;
+#if QUEUE_STATS
+    mutable QueueStatsCollector stats_collector;  // Per-thread contention counters.
+#endif
     
 public:
     // Constructs the deque with the given capacity.
@@ -868,16 +2403,21 @@ public:
         while (true) {
             int64_t current_right = right.load(std::memory_order_relaxed);
             int64_t current_left  = left.load(std::memory_order_acquire);
-            if ((current_right - current_left) >= static_cast<int64_t>(capacity))
+            if ((current_right - current_left) >= static_cast<int64_t>(capacity)) {
+                QUEUE_STATS_INC(push_failures);
                 return false;  // full
+            }
 
             if (right.compare_exchange_weak(current_right, current_right + 1,
                                             std::memory_order_acq_rel, std::memory_order_relaxed))
             {
                 size_t index = static_cast<size_t>(current_right % capacity);
                 buffer[index] = value;
+                QUEUE_STATS_INC(pushes);
+                QUEUE_STATS_MAX(high_water, static_cast<size_t>(current_right + 1 - current_left));
                 return true;
             }
+            QUEUE_STATS_INC(cas_failures);
         }
     }
 
@@ -887,8 +2427,10 @@ public:
         while (true) {
             int64_t current_left  = left.load(std::memory_order_relaxed);
             int64_t current_right = right.load(std::memory_order_acquire);
-            if ((current_right - current_left) >= static_cast<int64_t>(capacity))
+            if ((current_right - current_left) >= static_cast<int64_t>(capacity)) {
+                QUEUE_STATS_INC(push_failures);
                 return false;  // full
+            }
 
             int64_t new_left = current_left - 1;
             if (left.compare_exchange_weak(current_left, new_left,
@@ -896,8 +2438,11 @@ public:
             {
                 size_t index = static_cast<size_t>(((new_left % capacity) + capacity) % capacity);
                 buffer[index] = value;
+                QUEUE_STATS_INC(pushes);
+                QUEUE_STATS_MAX(high_water, static_cast<size_t>(current_right - new_left));
                 return true;
             }
+            QUEUE_STATS_INC(cas_failures);
         }
     }
 
@@ -907,16 +2452,20 @@ public:
         while (true) {
             int64_t current_left  = left.load(std::memory_order_relaxed);
             int64_t current_right = right.load(std::memory_order_acquire);
-            if (current_left == current_right)
+            if (current_left == current_right) {
+                QUEUE_STATS_INC(empty_pops);
                 return std::nullopt;  // empty
+            }
 
             if (left.compare_exchange_weak(current_left, current_left + 1,
                                            std::memory_order_acq_rel, std::memory_order_relaxed))
             {
                 size_t index = static_cast<size_t>(((current_left % capacity) + capacity) % capacity);
                 T value = buffer[index];
+                QUEUE_STATS_INC(pops);
                 return value;
             }
+            QUEUE_STATS_INC(cas_failures);
         }
     }
 
@@ -926,8 +2475,10 @@ public:
         while (true) {
             int64_t current_right = right.load(std::memory_order_relaxed);
             int64_t current_left  = left.load(std::memory_order_acquire);
-            if (current_left == current_right)
+            if (current_left == current_right) {
+                QUEUE_STATS_INC(empty_pops);
                 return std::nullopt;  // empty
+            }
 
             int64_t new_right = current_right - 1;
             if (right.compare_exchange_weak(current_right, new_right,
@@ -935,8 +2486,10 @@ public:
             {
                 size_t index = static_cast<size_t>(((new_right % capacity) + capacity) % capacity);
                 T value = buffer[index];
+                QUEUE_STATS_INC(pops);
                 return value;
             }
+            QUEUE_STATS_INC(cas_failures);
         }
     }
 
@@ -949,4 +2502,233 @@ public:
     inline std::optional<T> pop() {
         return pop_front();
     }
+
+    // Contention counters summed over all threads (all zero unless built with QUEUE_STATS).
+    QueueStats stats() const {
+#if QUEUE_STATS
+        return stats_collector.summary();
+#else
+        return QueueStats();
+#endif
+    }
+
+    // Clears the contention counters.
+    void reset_stats() {
+#if QUEUE_STATS
+        stats_collector.reset();
+#endif
+    }
+};
+
+// Global termination detection for a run with a known number of tasks.
+// Workers call complete() once per finished task; the call that brings the
+// outstanding count to zero records the finish time and wakes every thread
+// blocked in wait() or wait_for(). finished() only reads a flag that is written
+// once, so idle workers can check it without bouncing a hot cache line.
+class TerminationDetector {
+    alignas(64) std::atomic<int64_t> outstanding;   // Tasks not yet completed.
+    alignas(64) std::atomic<bool> done;             // Set once outstanding reaches zero.
+    std::chrono::steady_clock::time_point finish_time;
+    mutable std::mutex mutex;
+    mutable std::condition_variable cv;
+
+    public:
+    TerminationDetector() : outstanding(0), done(false) {}
+
+    explicit TerminationDetector(int64_t total_tasks) : outstanding(0), done(false) {
+        init(total_tasks);
+    }
+
+    // Deleted copy constructor and copy assignment to prevent accidental copying
+    TerminationDetector(const TerminationDetector&) = delete;
+    TerminationDetector& operator=(const TerminationDetector&) = delete;
+
+    // Resets the detector for a run of total_tasks tasks.
+    void init(int64_t total_tasks) {
+        std::lock_guard<std::mutex> lock(mutex);
+        outstanding.store(total_tasks, std::memory_order_relaxed);
+        done.store(total_tasks <= 0, std::memory_order_release);
+        finish_time = std::chrono::steady_clock::now();
+    }
+
+    // Marks count tasks as completed.
+    // Returns true for the call that completed the last outstanding task.
+    bool complete(int64_t count = 1) {
+        if (outstanding.fetch_sub(count, std::memory_order_acq_rel) != count) {
+            return false;
+        }
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            finish_time = std::chrono::steady_clock::now();
+            done.store(true, std::memory_order_release);
+        }
+        cv.notify_all();
+        return true;
+    }
+
+    // Returns true once every task has completed.
+    inline bool finished() const {
+        return done.load(std::memory_order_acquire);
+    }
+
+    // Returns the number of tasks not yet completed.
+    int64_t remaining() const {
+        return outstanding.load(std::memory_order_relaxed);
+    }
+
+    // Blocks until every task has completed.
+    void wait() const {
+        std::unique_lock<std::mutex> lock(mutex);
+        cv.wait(lock, [this] { return finished(); });
+    }
+
+    // Blocks until every task has completed or the timeout expires.
+    // Returns finished().
+    template <class Rep, class Period>
+    bool wait_for(const std::chrono::duration<Rep, Period>& timeout) const {
+        std::unique_lock<std::mutex> lock(mutex);
+        return cv.wait_for(lock, timeout, [this] { return finished(); });
+    }
+
+    // Time at which the last task completed. Only meaningful once finished().
+    std::chrono::steady_clock::time_point finishTime() const {
+        std::lock_guard<std::mutex> lock(mutex);
+        return finish_time;
+    }
+};
+
+// Default priority of a MultiQueue element: the element itself.
+template <class T>
+struct IdentityPriority {
+    int64_t operator()(const T& value) const { return static_cast<int64_t>(value); }
+};
+
+// Priority of a task pointer: the priority TaskTable derived from its position.
+struct TaskPriority {
+    int64_t operator()(const Task* task) const { return task->priority; }
+};
+
+// Relaxed concurrent priority queue (MultiQueue).
+// Elements live in several independently locked binary heaps. push() inserts into a
+// random shard and pop() removes the top of the better of two random shards, so pops
+// return high-priority elements without serializing all threads on one lock. Use
+// about two shards per worker thread. Higher Priority(value) is popped first.
+template <class T, class Priority = IdentityPriority<T>>
+class MultiQueue {
+    static constexpr int64_t EMPTY = std::numeric_limits<int64_t>::min();
+
+    struct alignas(64) Shard {
+        std::mutex mutex;                           // Protects heap.
+        std::vector<std::pair<int64_t, T>> heap;    // Max-heap on priority.
+        std::atomic<int64_t> top{EMPTY};            // Cached priority of the top element.
+        std::atomic<size_t> count{0};               // Cached heap size.
+    };
+
+    const size_t num_shards;             // Number of shards.
+    std::unique_ptr<Shard[]> shards;     // Shard storage.
+    Priority priority;                   // Priority extractor.
+
+    static bool heap_less(const std::pair<int64_t, T>& a, const std::pair<int64_t, T>& b) {
+        return a.first < b.first;
+    }
+
+    // Per-thread xorshift generator used to pick shards.
+    static size_t random_index(size_t bound) {
+        static std::atomic<uint64_t> seed_counter{0x9E3779B97F4A7C15ull};
+        thread_local uint64_t state = seed_counter.fetch_add(0x9E3779B97F4A7C15ull, std::memory_order_relaxed) | 1;
+        state ^= state >> 12;
+        state ^= state << 25;
+        state ^= state >> 27;
+        return static_cast<size_t>((state * 0x2545F4914F6CDD1Dull) >> 32) % bound;
+    }
+
+    // Removes the top of shard s. The shard lock must be held and the shard non-empty.
+    T pop_locked(Shard& shard) {
+        std::pop_heap(shard.heap.begin(), shard.heap.end(), heap_less);
+        T value = shard.heap.back().second;
+        shard.heap.pop_back();
+        shard.top.store(shard.heap.empty() ? EMPTY : shard.heap.front().first, std::memory_order_relaxed);
+        shard.count.store(shard.heap.size(), std::memory_order_relaxed);
+        return value;
+    }
+
+    public:
+    // Construct a queue with the given number of shards (at least one).
+    explicit MultiQueue(size_t num_shards, Priority priority = Priority())
+        : num_shards(std::max<size_t>(num_shards, 1)),
+          shards(new Shard[std::max<size_t>(num_shards, 1)]),
+          priority(priority)
+    { }
+
+    // Returns true if every shard is empty.
+    bool empty() const {
+        return size() == 0;
+    }
+
+    // Returns the current number of elements (approximate under concurrent updates).
+    size_t size() const {
+        size_t total = 0;
+        for (size_t s = 0; s < num_shards; ++s) {
+            total += shards[s].count.load(std::memory_order_relaxed);
+        }
+        return total;
+    }
+
+    // Returns the number of shards.
+    size_t shard_count() const {
+        return num_shards;
+    }
+
+    // Push an element into a random shard. The queue is unbounded, so this always succeeds.
+    bool push(const T &value) {
+        int64_t key = priority(value);
+        while (true) {
+            Shard& shard = shards[random_index(num_shards)];
+            std::unique_lock<std::mutex> lock(shard.mutex, std::try_to_lock);
+            if (!lock.owns_lock()) {
+                continue;   // Shard busy, try another one.
+            }
+            shard.heap.emplace_back(key, value);
+            std::push_heap(shard.heap.begin(), shard.heap.end(), heap_less);
+            shard.top.store(shard.heap.front().first, std::memory_order_relaxed);
+            shard.count.store(shard.heap.size(), std::memory_order_relaxed);
+            return true;
+        }
+    }
+
+    // Priorities already move critical tasks forward, so this is an alias for push.
+    inline bool push_rotated(const T &value) {
+        return push(value);
+    }
+
+    // Pop the top of the better of two random shards.
+    // Falls back to a sweep over all shards, so std::nullopt means every shard looked empty.
+    std::optional<T> pop() {
+        for (int attempt = 0; attempt < 4; ++attempt) {
+            size_t a = random_index(num_shards);
+            size_t b = random_index(num_shards);
+            int64_t top_a = shards[a].top.load(std::memory_order_relaxed);
+            int64_t top_b = shards[b].top.load(std::memory_order_relaxed);
+            Shard& shard = shards[top_b > top_a ? b : a];
+            if (std::max(top_a, top_b) == EMPTY) {
+                continue;
+            }
+            std::unique_lock<std::mutex> lock(shard.mutex, std::try_to_lock);
+            if (lock.owns_lock() && !shard.heap.empty()) {
+                return pop_locked(shard);
+            }
+        }
+
+        for (size_t s = 0; s < num_shards; ++s) {
+            Shard& shard = shards[s];
+            if (shard.top.load(std::memory_order_relaxed) == EMPTY) {
+                continue;
+            }
+            std::lock_guard<std::mutex> lock(shard.mutex);
+            if (!shard.heap.empty()) {
+                return pop_locked(shard);
+            }
+        }
+        return std::nullopt;
+    }
 };
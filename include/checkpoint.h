@@ -0,0 +1,323 @@
+#pragma once
+
+#include <filesystem>
+
+#include "bn2.h"
+
+// Fixed part of a checkpoint state file. It is followed by the completed task count of
+// every task row (int32) and by the up and b reflector arrays (rows doubles each).
+struct CheckpointHeader {
+    static constexpr char MAGIC[8] = {'B', 'N', '2', 'C', 'K', 'P', 'T', '\0'};
+    static constexpr uint32_t VERSION = 1;
+
+    char magic[8];          // MAGIC
+    uint32_t version;       // VERSION
+    uint32_t slot;          // Matrix file (0 or 1) this state describes
+    uint64_t sequence;      // Checkpoints taken before this one
+    int32_t rows;           // Matrix shape
+    int32_t cols;
+    int32_t alpha;          // Block sizes of the task table
+    int32_t beta;
+    int32_t task_rows;      // Number of task rows
+    int32_t reserved;
+};
+
+// State restored from a checkpoint.
+struct CheckpointData {
+    std::string matrix_file;        // Binary matrix file holding the tiles
+    std::vector<int> progress;      // Completed tasks per task row
+    std::vector<double> up;         // Reflector arrays
+    std::vector<double> b;
+    uint64_t sequence;
+};
+
+// Periodic, incremental checkpoints of a running factorization.
+//
+// Each task row completes its tasks in column order, so the state is one counter per
+// task row plus the rows it owns (TaskTable::targetRowBegin/End). Workers run the tasks
+// of row i under rowLock(i) and call taskDone(i) before releasing it; save() takes each
+// row's lock only long enough to copy its rows. Rows are captured from the last task row
+// up: a task reads data only from tasks of its own or earlier rows, so whatever an
+// earlier-captured row has seen completed is still complete when its predecessors are
+// captured, and the counters form a consistent cut of the data dependencies. (The one
+// later-row edge, an update releasing the panel above it, is pure scheduling; the
+// scheduler skips releasing a panel that a resumed run already has.)
+//
+// Two matrix files are used alternately and only rows whose counter moved since that
+// file was last written are rewritten. The state file (counters and reflector arrays)
+// is replaced atomically once its matrix file is synced, so a crash while saving leaves
+// the previous checkpoint intact.
+class Checkpointer {
+    std::string dir;
+    const matrix_t<double>* mat;
+    const TaskTable* table;
+    int task_rows;
+    std::unique_ptr<std::mutex[]> row_locks;
+    std::unique_ptr<std::atomic<int>[]> progress;
+    std::vector<int> written[2];        // Counters each matrix file holds, -1 if unknown
+    int slot;                           // Matrix file of the last checkpoint, -1 if none
+    uint64_t sequence;
+    uint64_t taken;                     // Checkpoints taken by this run
+    std::vector<double> tile;           // Copy of one task row's rows
+    uint64_t bytes;                     // Bytes written by save()
+    double last_ms;                     // Duration of the last save()
+
+    std::string matrixFile(int s) const { return dir + "/matrix." + std::to_string(s) + ".bin"; }
+    std::string stateFile() const { return dir + "/state"; }
+
+    static void pwriteAll(int fd, const void* buf, size_t length, uint64_t offset, const std::string& filename) {
+        const char* bytes = static_cast<const char*>(buf);
+        while (length > 0) {
+            ssize_t written = ::pwrite(fd, bytes, length, offset);
+            if (written < 0 && errno == EINTR) {
+                continue;
+            }
+            if (written <= 0) {
+                throw std::runtime_error("Error writing checkpoint file: " + filename);
+            }
+            bytes += written;
+            offset += static_cast<uint64_t>(written);
+            length -= static_cast<size_t>(written);
+        }
+    }
+
+public:
+    Checkpointer() : mat(nullptr), table(nullptr), task_rows(0), slot(-1), sequence(0), taken(0), bytes(0), last_ms(0.0) {}
+
+    Checkpointer(const Checkpointer&) = delete;
+    Checkpointer& operator=(const Checkpointer&) = delete;
+
+    // Prepares checkpoints of mat, factored with the tasks of table, into dir.
+    // A resumed run passes the restored state so the next checkpoint stays incremental.
+    void init(const std::string& dir, const matrix_t<double>& mat, const TaskTable& table,
+              const CheckpointData* resumed = nullptr) {
+        this->dir = dir;
+        this->mat = &mat;
+        this->table = &table;
+        task_rows = table.rows();
+        std::filesystem::create_directories(dir);
+
+        row_locks.reset(new std::mutex[task_rows]);
+        progress.reset(new std::atomic<int>[task_rows]);
+        for (int i = 0; i < task_rows; ++i) {
+            progress[i].store(resumed ? resumed->progress[i] : 0, std::memory_order_relaxed);
+        }
+        written[0].assign(task_rows, -1);
+        written[1].assign(task_rows, -1);
+        slot = -1;
+        sequence = 0;
+        if (resumed) {
+            slot = resumed->matrix_file == matrixFile(1) ? 1 : 0;
+            written[slot] = resumed->progress;
+            sequence = resumed->sequence + 1;
+        }
+        taken = 0;
+        bytes = 0;
+        last_ms = 0.0;
+    }
+
+    // Lock held while a task of task row i runs.
+    std::mutex& rowLock(int i) { return row_locks[i]; }
+
+    // Records that the next task of task row i completed; call with rowLock(i) held.
+    void taskDone(int i) { progress[i].fetch_add(1, std::memory_order_relaxed); }
+
+    // Completed tasks of task row i.
+    int rowProgress(int i) const { return progress[i].load(std::memory_order_relaxed); }
+
+    // Takes a checkpoint of the current state, including the reflector arrays up and b
+    // (global_up_array and global_b_array): only the entries of panels in the cut are read,
+    // each under the lock of the task row that writes it. Runs alongside the workers; only
+    // one save() may run at a time.
+    void save(const std::vector<double>& up, const std::vector<double>& b) {
+        auto start = std::chrono::steady_clock::now();
+        int target = slot == 0 ? 1 : 0;
+        std::string filename = matrixFile(target);
+        const int n = mat->cols();
+        const int beta_div_alpha = table->getBeta() / table->getAlpha();
+
+        int fd = ::open(filename.c_str(), O_RDWR | O_CREAT, 0644);
+        if (fd < 0) {
+            throw std::runtime_error("Error opening checkpoint file: " + filename);
+        }
+        MatrixFileHeader header = mat->binary_header();
+        std::vector<int> cut(task_rows);
+        std::vector<double> up_copy(up.size(), 0.0), b_copy(b.size(), 0.0);
+        try {
+            if (written[target][0] < 0) {
+                // Never written (or unknown after a restart): lay out the whole file.
+                uint64_t size = header.data_offset + static_cast<uint64_t>(mat->rows()) * n * sizeof(double);
+                if (::ftruncate(fd, static_cast<off_t>(size)) != 0) {
+                    throw std::runtime_error("Error sizing checkpoint file: " + filename);
+                }
+                pwriteAll(fd, &header, sizeof(header), 0, filename);
+                std::fill(written[target].begin(), written[target].end(), -1);
+            }
+
+            for (int i = task_rows - 1; i >= 0; --i) {
+                int row_begin = table->targetRowBegin(i);
+                int row_end = table->targetRowEnd(i);
+                size_t count = static_cast<size_t>(row_end - row_begin) * n;
+                {
+                    std::lock_guard<std::mutex> lock(row_locks[i]);
+                    cut[i] = progress[i].load(std::memory_order_relaxed);
+                    // The panels of row i store the reflectors of its own rows, under
+                    // this lock; entries of panels past the cut stay zero.
+                    int pivot_end = cut[i] > i * beta_div_alpha ? std::min(table->getAlpha() * cut[i] + 1, row_end) : row_begin;
+                    std::copy(up.begin() + row_begin, up.begin() + pivot_end, up_copy.begin() + row_begin);
+                    std::copy(b.begin() + row_begin, b.begin() + pivot_end, b_copy.begin() + row_begin);
+                    if (cut[i] == written[target][i]) {
+                        continue;
+                    }
+                    const int ld = mat->ld();
+                    tile.resize(count);
+                    for (int r = row_begin; r < row_end; ++r) {
+                        const double* row = mat->data_ptr() + static_cast<size_t>(r) * ld;
+                        std::copy(row, row + n, tile.data() + static_cast<size_t>(r - row_begin) * n);
+                    }
+                }
+                pwriteAll(fd, tile.data(), count * sizeof(double),
+                          header.data_offset + static_cast<uint64_t>(row_begin) * n * sizeof(double), filename);
+                written[target][i] = cut[i];
+                bytes += count * sizeof(double);
+            }
+            if (::fdatasync(fd) != 0) {
+                throw std::runtime_error("Error syncing checkpoint file: " + filename);
+            }
+        } catch (...) {
+            ::close(fd);
+            throw;
+        }
+        ::close(fd);
+
+        CheckpointHeader state{};
+        std::memcpy(state.magic, CheckpointHeader::MAGIC, sizeof(state.magic));
+        state.version = CheckpointHeader::VERSION;
+        state.slot = static_cast<uint32_t>(target);
+        state.sequence = sequence;
+        state.rows = mat->rows();
+        state.cols = n;
+        state.alpha = table->getAlpha();
+        state.beta = table->getBeta();
+        state.task_rows = task_rows;
+
+        std::string tmp = stateFile() + ".tmp";
+        int sfd = ::open(tmp.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644);
+        if (sfd < 0) {
+            throw std::runtime_error("Error opening checkpoint file: " + tmp);
+        }
+        try {
+            uint64_t offset = 0;
+            pwriteAll(sfd, &state, sizeof(state), offset, tmp);
+            offset += sizeof(state);
+            std::vector<int32_t> counters(cut.begin(), cut.end());
+            pwriteAll(sfd, counters.data(), counters.size() * sizeof(int32_t), offset, tmp);
+            offset += counters.size() * sizeof(int32_t);
+            pwriteAll(sfd, up_copy.data(), up_copy.size() * sizeof(double), offset, tmp);
+            offset += up_copy.size() * sizeof(double);
+            pwriteAll(sfd, b_copy.data(), b_copy.size() * sizeof(double), offset, tmp);
+            if (::fsync(sfd) != 0) {
+                throw std::runtime_error("Error syncing checkpoint file: " + tmp);
+            }
+        } catch (...) {
+            ::close(sfd);
+            throw;
+        }
+        ::close(sfd);
+        std::filesystem::rename(tmp, stateFile());
+
+        slot = target;
+        sequence++;
+        taken++;
+        last_ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+    }
+
+    // Reads the latest checkpoint in dir. Returns false if there is none; throws if it
+    // does not match the given shape and block sizes.
+    static bool load(const std::string& dir, int alpha, int beta, CheckpointData& data) {
+        std::string filename = dir + "/state";
+        std::ifstream in(filename, std::ios::binary);
+        if (!in.is_open()) {
+            return false;
+        }
+        CheckpointHeader state;
+        in.read(reinterpret_cast<char*>(&state), sizeof(state));
+        if (!in || std::memcmp(state.magic, CheckpointHeader::MAGIC, sizeof(state.magic)) != 0
+            || state.version != CheckpointHeader::VERSION || state.slot > 1) {
+            throw std::runtime_error("Error: " + filename + " is not a checkpoint.");
+        }
+        if (state.alpha != alpha || state.beta != beta) {
+            throw std::runtime_error("Error: checkpoint in " + dir + " was taken with ALPHA " + std::to_string(state.alpha)
+                                     + " and BETA " + std::to_string(state.beta) + ".");
+        }
+
+        std::vector<int32_t> counters(state.task_rows);
+        data.up.assign(state.rows, 0.0);
+        data.b.assign(state.rows, 0.0);
+        in.read(reinterpret_cast<char*>(counters.data()), counters.size() * sizeof(int32_t));
+        in.read(reinterpret_cast<char*>(data.up.data()), data.up.size() * sizeof(double));
+        in.read(reinterpret_cast<char*>(data.b.data()), data.b.size() * sizeof(double));
+        if (!in) {
+            throw std::runtime_error("Error: " + filename + " is truncated.");
+        }
+        data.progress.assign(counters.begin(), counters.end());
+        data.matrix_file = dir + "/matrix." + std::to_string(state.slot) + ".bin";
+        data.sequence = state.sequence;
+        return true;
+    }
+
+    // Deletes the checkpoint files, e.g. after a run completed.
+    void remove() {
+        std::filesystem::remove(stateFile());
+        std::filesystem::remove(matrixFile(0));
+        std::filesystem::remove(matrixFile(1));
+        std::error_code ec;
+        std::filesystem::remove(dir, ec);   // Only if empty
+    }
+
+    // Checkpoints taken by this run, bytes of rows written and duration of the last one.
+    uint64_t checkpointCount() const { return taken; }
+    uint64_t bytesWritten() const { return bytes; }
+    double lastSaveMs() const { return last_ms; }
+};
+
+// Rebuilds the dynamic scheduler state at a checkpoint cut: marks the completed tasks in
+// deps and passes every task the scheduler had queued at that point to ready() (runnable
+// now) or wait() (parked in the wait queue). The next task of a row is ready once its
+// panel (updates) or the update that releases it (panels) is done; later updates whose
+// panel is done were parked by the panel's fan-out. A cut that leaves lower rows behind
+// parks a lot of them. Returns the number of completed tasks.
+template <class Dependencies, class Ready, class Wait>
+int64_t resume_tasks(const std::vector<int>& progress, const TaskTable& table, Dependencies& deps, Ready ready, Wait wait) {
+    const int task_rows = table.rows();
+    const int task_cols = table.cols();
+    const int beta_div_alpha = table.getBeta() / table.getAlpha();
+    int64_t completed = 0;
+    for (int i = 0; i < task_rows; ++i) {
+        for (int j = 0; j < progress[i]; ++j) {
+            deps.setDependency(i, j, true);
+            completed++;
+        }
+    }
+
+    for (int i = 0; i < task_rows; ++i) {
+        int row_tasks = std::min((i + 1) * beta_div_alpha, task_cols);
+        for (int j = progress[i]; j < row_tasks; ++j) {
+            if (j < i * beta_div_alpha) {
+                if (deps.getDependency(j / beta_div_alpha, j)) {
+                    if (j == progress[i]) {
+                        ready(table.getTask(i, j));
+                    } else {
+                        wait(table.getTask(i, j));
+                    }
+                }
+            } else if (j == progress[i]) {
+                int release_row = std::min((j - 1) / beta_div_alpha + 1, task_rows - 1);
+                if (j == 0 || deps.getDependency(release_row, j - 1)) {
+                    ready(table.getTask(i, j));
+                }
+            }
+        }
+    }
+    return completed;
+}
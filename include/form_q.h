@@ -0,0 +1,102 @@
+#pragma once
+
+#include <stdexcept>
+
+#include "kernels.h"
+
+// One task of a QFormation: the reflectors of pivot block j applied to target block i.
+struct QFormNode {
+    int i;      // Target block: rows [i*beta, (i+1)*beta) of Q as stored (columns of Q)
+    int j;      // Pivot block: reflectors [j*alpha, (j+1)*alpha)
+};
+
+// Explicit Q of a finished factorization (the equivalent of LAPACK's orgqr), built from R's
+// companions in the stored matrix: the reflector tails above its diagonal and
+// global_up_array / global_b_array. The stored matrix has m rows (columns of A) of length n,
+// m <= n, and holds m reflectors; Q is stored the same way, so row c of q() is column c of Q.
+// The thin Q has m such rows, the full Q n of them.
+// Column c of Q is H(0) ... H(m-1) e_c, which only involves the reflectors up to c. The
+// tasks follow the tiling of the factorization: task (i, j) applies the reflectors of pivot
+// block j (alpha of them) to the columns of target block i (beta of them). The columns of a
+// block start as the identity and take the pivot blocks last to first, so (i, j) waits for
+// (i, j+1) only; blocks are independent of each other and run in parallel.
+class QFormation {
+    matrix_view_t<const double> factored;
+    int alpha;
+    int beta;
+    int reflectors;
+    matrix_t<double> q;
+    std::vector<QFormNode> nodes;
+
+    int targetBegin(int i) const { return i * beta; }
+    int targetEnd(int i) const { return std::min((i + 1) * beta, q.rows()); }
+
+    // Pivot block of the last reflector that changes a column of target block i.
+    int lastPivotBlock(int i) const { return (std::min(targetEnd(i), reflectors) - 1) / alpha; }
+
+public:
+    QFormation() : alpha(0), beta(0), reflectors(0) {}
+
+    // Prepares the tasks for the thin (full = false) or full Q; q is allocated with the given
+    // storage. Throws std::invalid_argument if the matrix has more rows than columns.
+    void init(matrix_view_t<const double> factored, bool full, int alpha, int beta,
+              const MatrixStorage& storage = MatrixStorage()) {
+        if (factored.rows() > factored.cols() || factored.rows() < 1 || alpha < 1 || beta < 1) {
+            throw std::invalid_argument("QFormation: needs at least one row and at most as many rows as columns");
+        }
+        this->factored = factored;
+        this->alpha = alpha;
+        this->beta = beta;
+        reflectors = factored.rows();
+        q = matrix_t<double>(full ? factored.cols() : factored.rows(), factored.cols(), storage);
+
+        // Each block's chain in execution order, so ids are a topological order.
+        nodes.clear();
+        int blocks = (q.rows() + beta - 1) / beta;
+        for (int i = 0; i < blocks; ++i) {
+            for (int j = lastPivotBlock(i); j >= 0; --j) {
+                nodes.push_back({i, j});
+            }
+        }
+    }
+
+    size_t size() const { return nodes.size(); }
+
+    inline const QFormNode& node(size_t id) const { return nodes[id]; }
+
+    size_t predecessorCount(size_t id) const { return nodes[id].j == lastPivotBlock(nodes[id].i) ? 0 : 1; }
+
+    // Calls f(succ_id) for every direct successor of task id.
+    template <class F>
+    void forEachSuccessor(size_t id, F f) const {
+        if (nodes[id].j > 0) {
+            f(id + 1);
+        }
+    }
+
+    // Runs task id. Tasks may run concurrently once their predecessors have finished.
+    void run(size_t id) {
+        const QFormNode& t = nodes[id];
+        int begin = targetBegin(t.i), end = targetEnd(t.i), n = q.cols();
+        matrix_view_t<double> block = q.block(begin, 0, end - begin, n);
+        if (t.j == lastPivotBlock(t.i)) {
+            identity_columns(block, n, begin, end);
+        }
+        apply_reflectors_backward(factored, block, n, t.j * alpha, std::min((t.j + 1) * alpha, reflectors),
+                                  begin, end);
+    }
+
+    // Floating point operations of task id, following apply_reflectors_backward.
+    double flops(size_t id) const {
+        const QFormNode& t = nodes[id];
+        double total = 0;
+        int n = q.cols();
+        for (int lpivot = t.j * alpha; lpivot < std::min((t.j + 1) * alpha, reflectors); ++lpivot) {
+            total += std::max(targetEnd(t.i) - std::max(targetBegin(t.i), lpivot), 0) * (4.0 * (n - lpivot - 1) + 4);
+        }
+        return total;
+    }
+
+    // The explicit Q, column c in row c, once every task has run.
+    const matrix_t<double>& result() const { return q; }
+};
@@ -0,0 +1,171 @@
+#pragma once
+
+#include <cmath>
+
+#include "bn2.h"
+
+// Householder reflector of every pivot row, written by the panel that produces it and
+// read by the updates that apply it.
+inline std::vector<double> global_up_array, global_b_array;
+
+// The kernels reach the matrix through rows.row(r), the first element of row r: a
+// matrix_view_t<double>, which may be a block of a larger allocation, or the out-of-core
+// TileRows of main.cpp.
+template <class Rows>
+void complete_task1(Rows rows, int m, int n, int row_start, int row_end, int col_start, int col_end){
+
+    double sm, sm1, cl, clinv, up, b;
+    int _row_start = row_start == 1 ? 0 : row_start;
+
+    for (int lpivot = _row_start; lpivot < row_end; lpivot++){
+        double* pivot = rows.row(lpivot);
+        cl = fabs(pivot[lpivot]);
+        sm1 = 0;
+
+        for (int k = lpivot+1; k < n; k++){
+            sm = fabs(pivot[k]);
+            sm1 += sm * sm;
+            cl = fmax(sm, cl);
+        }
+
+        if (cl <= 0.0) { return; } clinv = 1.0/cl;
+
+        double d__1 = pivot[lpivot] * clinv;
+        sm = d__1 * d__1;
+        sm += sm1 * clinv * clinv;
+
+        cl *= sqrt(sm);
+
+        if (pivot[lpivot] > 0.0) { cl = -cl; }
+
+        up = pivot[lpivot] - cl;
+        pivot[lpivot] = cl;
+
+        if (row_end - lpivot < 0) { return; }
+
+        b = up * pivot[lpivot];
+
+        if (b >= 0.0) { return; }
+
+        b = 1.0/b;
+
+        global_up_array[lpivot] = up;
+        global_b_array[lpivot] = b;
+
+        for (int j = lpivot+1; j < col_end; j++){
+            double* target = rows.row(j);
+            sm = target[lpivot] * up;
+
+            for (int i__ = lpivot+1; i__ < n; i__++){
+                sm += target[i__] * pivot[i__];
+            }
+
+            if (sm == 0.0) { continue; }
+
+            sm *= b;
+            target[lpivot] += sm * up;
+
+            for (int i__ = lpivot+1; i__ < n; i__++){
+                target[i__] += sm * pivot[i__];
+            }
+        }
+    }
+}
+
+template <class Rows>
+void complete_task2(Rows rows, int m, int n, int row_start, int row_end, int col_start, int col_end){
+    
+    int _row_start = row_start == 1 ? 0 : row_start;
+    int _col_start = col_start == 1 ? 0 : col_start;
+
+    double up = 0.0, b = 0.0, sm = 0.0;
+
+    for (int lpivot = _row_start; lpivot < row_end; lpivot++){
+        up = global_up_array[lpivot];
+        b  = global_b_array[lpivot];
+        double* pivot = rows.row(lpivot);
+
+        for (int j = _col_start; j < col_end; j++){
+            double* target = rows.row(j);
+            sm = target[lpivot] * up;
+
+            for (int i__ = lpivot+1; i__ < n; i__++){
+                sm += target[i__] * pivot[i__];
+            }
+
+            if (sm == 0.0) { continue; }
+
+            sm *= b;
+            target[lpivot] += sm * up;
+
+            for (int i__ = lpivot+1; i__ < n; i__++){
+                target[i__] += sm * pivot[i__];
+            }
+        }
+    }
+}
+
+// Floating point operations of a task of the given type and bounds on a matrix with n
+// columns, following the loops of complete_task1 and complete_task2.
+inline double task_flops(int type, int n, int row_start, int row_end, int col_start, int col_end){
+    double flops = 0;
+    int first_target = col_start == 1 ? 0 : col_start;
+    for (int lpivot = row_start == 1 ? 0 : row_start; lpivot < row_end; lpivot++){
+        double len = n - lpivot - 1;
+        if (type == 1){
+            flops += 2 * len + 10;                                          // Norm and reflector
+            flops += std::max(col_end - lpivot - 1, 0) * (4 * len + 4);     // Rows below the pivot
+        }
+        else{
+            flops += (col_end - first_target) * (4 * len + 4);
+        }
+    }
+    return flops;
+}
+
+// Sets the rows of targets, vectors target_begin..target_end-1, to the matching columns of
+// the identity: the start of forming those columns of Q with apply_reflectors_backward.
+template <class Targets>
+void identity_columns(Targets targets, int n, int target_begin, int target_end){
+    for (int c = target_begin; c < target_end; c++){
+        double* target = targets.row(c - target_begin);
+        std::fill(target, target + n, 0.0);
+        target[c] = 1.0;
+    }
+}
+
+// Multiplies rows target_begin..target_end-1 of a vector set by Q restricted to the stored
+// reflectors pivot_begin..pivot_end-1: x <- H(pivot_begin) ... H(pivot_end-1) x, the last
+// reflector first (complete_task2 applies them first to last, which is Q^T). targets.row(k)
+// is the vector of index target_begin + k, of length n. A vector of index r must be zero
+// past element r on entry, as the columns of R and of the identity are, so the reflectors
+// after r leave it unchanged and are skipped.
+template <class Pivots, class Targets>
+void apply_reflectors_backward(Pivots pivots, Targets targets, int n, int pivot_begin, int pivot_end,
+                               int target_begin, int target_end){
+
+    for (int lpivot = pivot_end - 1; lpivot >= pivot_begin; lpivot--){
+        double up = global_up_array[lpivot];
+        double b = global_b_array[lpivot];
+        if (b == 0.0) { continue; }     // No reflector: the panel stopped at a zero column
+        const double* pivot = pivots.row(lpivot);
+
+        for (int j = std::max(target_begin, lpivot); j < target_end; j++){
+            double* target = targets.row(j - target_begin);
+            double sm = target[lpivot] * up;
+
+            for (int i__ = lpivot+1; i__ < n; i__++){
+                sm += target[i__] * pivot[i__];
+            }
+
+            if (sm == 0.0) { continue; }
+
+            sm *= b;
+            target[lpivot] += sm * up;
+
+            for (int i__ = lpivot+1; i__ < n; i__++){
+                target[i__] += sm * pivot[i__];
+            }
+        }
+    }
+}
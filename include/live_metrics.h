@@ -0,0 +1,198 @@
+#pragma once
+
+#include <array>
+#include <csignal>
+#include <iomanip>
+#include <pthread.h>
+
+#include "bn2.h"
+
+// Queues whose depth the live metrics follow.
+enum class MetricsQueue : int { Ready, Wait, Count };
+
+// Counters of one thread. Only the owner writes them, so a count goes up with a relaxed
+// load and store of its own cache line: no read-modify-write, no lock. The sampler reads
+// them with relaxed loads, so a sample may lag the workers by a few tasks.
+class alignas(64) ThreadMetrics {
+    static constexpr size_t QUEUES = static_cast<size_t>(MetricsQueue::Count);
+
+    std::array<std::atomic<uint64_t>, 2> tasks;           // Completed panels, updates
+    std::atomic<double> flops;                            // Flops of the completed tasks
+    std::array<std::atomic<uint64_t>, QUEUES> pushed;
+    std::array<std::atomic<uint64_t>, QUEUES> popped;
+    std::atomic<bool> busy;                               // Running a kernel
+
+    static inline void bump(std::atomic<uint64_t>& counter) {
+        counter.store(counter.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+    }
+
+    friend class LiveMetrics;
+
+public:
+    ThreadMetrics() : flops(0), busy(false) {
+        for (auto& c : tasks) c.store(0, std::memory_order_relaxed);
+        for (auto& c : pushed) c.store(0, std::memory_order_relaxed);
+        for (auto& c : popped) c.store(0, std::memory_order_relaxed);
+    }
+
+    inline void push(MetricsQueue queue) { bump(pushed[static_cast<size_t>(queue)]); }
+    inline void pop(MetricsQueue queue) { bump(popped[static_cast<size_t>(queue)]); }
+
+    inline void taskStart() { busy.store(true, std::memory_order_relaxed); }
+
+    // Task of the given type (1: panel, 2: update) finished.
+    inline void taskDone(int type, double task_flops) {
+        bump(tasks[type == 1 ? 0 : 1]);
+        flops.store(flops.load(std::memory_order_relaxed) + task_flops, std::memory_order_relaxed);
+        busy.store(false, std::memory_order_relaxed);
+    }
+};
+
+// Sums of the counters at one point of the run.
+struct MetricsSample {
+    double seconds;                 // Since LiveMetrics::init
+    std::array<uint64_t, 2> tasks;  // Completed panels, updates
+    double flops;
+    std::array<int64_t, 2> depth;   // Per MetricsQueue
+    int busy;                       // Workers running a kernel
+};
+
+// Live progress of a run. Workers count their own tasks and queue operations in
+// ThreadMetrics; a sampler thread running run() prints a line every interval and a
+// per-worker dump when the process receives SIGUSR1. The signal is taken with
+// sigtimedwait, so blockSignal() must run before any thread is created: a thread that
+// does not block SIGUSR1 would be killed by it.
+class LiveMetrics {
+    std::unique_ptr<ThreadMetrics[]> threads;
+    int workers;
+    uint64_t total_tasks;
+    double total_flops;
+    std::array<const char*, 2> queue_names;     // nullptr: the queue does not exist
+    std::chrono::steady_clock::time_point start;
+    std::atomic<bool> stopping;
+    std::atomic<bool> sampling;
+    pthread_t sampler;
+
+public:
+    LiveMetrics() : workers(0), total_tasks(0), total_flops(0), queue_names{}, stopping(false), sampling(false) {}
+
+    // Blocks SIGUSR1 in the calling thread and the threads it creates afterwards.
+    static void blockSignal() {
+        sigset_t set;
+        sigemptyset(&set);
+        sigaddset(&set, SIGUSR1);
+        pthread_sigmask(SIG_BLOCK, &set, nullptr);
+    }
+
+    // Prepares counters for `workers` workers plus one slot shared by the other threads
+    // (main, I/O), which must not update it concurrently. Progress is measured against
+    // total_flops; queue names label the depths, nullptr for a queue the run does not use.
+    void init(int workers, uint64_t total_tasks, double total_flops, const char* ready_queue, const char* wait_queue) {
+        threads.reset(new ThreadMetrics[workers + 1]);
+        this->workers = workers;
+        this->total_tasks = total_tasks;
+        this->total_flops = total_flops;
+        queue_names = {ready_queue, wait_queue};
+        start = std::chrono::steady_clock::now();
+        stopping.store(false);
+        sampling.store(false);
+    }
+
+    // Counters of worker tid; any other tid (-1 for main) gets the shared slot.
+    inline ThreadMetrics& thread(int tid) { return threads[tid >= 0 && tid < workers ? tid : workers]; }
+
+    MetricsSample sample() const {
+        MetricsSample s{};
+        s.seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+        for (int t = 0; t <= workers; ++t) {
+            const ThreadMetrics& m = threads[t];
+            for (size_t k = 0; k < 2; ++k) {
+                s.tasks[k] += m.tasks[k].load(std::memory_order_relaxed);
+                s.depth[k] += static_cast<int64_t>(m.pushed[k].load(std::memory_order_relaxed))
+                              - static_cast<int64_t>(m.popped[k].load(std::memory_order_relaxed));
+            }
+            s.flops += m.flops.load(std::memory_order_relaxed);
+            if (t < workers && m.busy.load(std::memory_order_relaxed)) {
+                s.busy++;
+            }
+        }
+        // Pushes and pops are read at slightly different times.
+        for (auto& d : s.depth) {
+            d = std::max<int64_t>(d, 0);
+        }
+        return s;
+    }
+
+    // One progress line: rates over the interval since prev, the rest since init().
+    void writeSample(std::ostream& out, const MetricsSample& now, const MetricsSample& prev) const {
+        std::ios state(nullptr);
+        state.copyfmt(out);
+        double dt = now.seconds - prev.seconds;
+        double done = total_flops > 0 ? std::min(now.flops / total_flops, 1.0) : 0.0;
+        out << std::fixed << std::setprecision(1) << "[metrics] " << now.seconds << " s: " << 100.0 * done
+            << " % done (" << now.tasks[0] + now.tasks[1] << "/" << total_tasks << " tasks), "
+            << (dt > 0 ? (now.tasks[0] - prev.tasks[0]) / dt : 0.0) << " panels/s, "
+            << (dt > 0 ? (now.tasks[1] - prev.tasks[1]) / dt : 0.0) << " updates/s";
+        for (size_t k = 0; k < 2; ++k) {
+            if (queue_names[k]) {
+                out << ", " << queue_names[k] << " queue " << now.depth[k];
+            }
+        }
+        out << ", " << now.busy << " busy / " << workers - now.busy << " idle workers";
+        if (done > 0 && done < 1) {
+            out << ", ETA " << now.seconds * (1 - done) / done << " s";
+        }
+        out << std::endl;
+        out.copyfmt(state);
+    }
+
+    // The progress line followed by the state and task counts of every worker.
+    void writeDump(std::ostream& out, const MetricsSample& now, const MetricsSample& prev) const {
+        writeSample(out, now, prev);
+        for (int t = 0; t < workers; ++t) {
+            const ThreadMetrics& m = threads[t];
+            out << "[metrics]   worker " << t << ": " << (m.busy.load(std::memory_order_relaxed) ? "busy" : "idle")
+                << ", " << m.tasks[0].load(std::memory_order_relaxed) << " panels, "
+                << m.tasks[1].load(std::memory_order_relaxed) << " updates" << std::endl;
+        }
+    }
+
+    // Samples on the calling thread until stop(): a line to out every interval, a dump on
+    // SIGUSR1 and a last line when stopped.
+    void run(std::ostream& out, std::chrono::milliseconds interval) {
+        sampler = pthread_self();
+        sampling.store(true);
+        sigset_t set;
+        sigemptyset(&set);
+        sigaddset(&set, SIGUSR1);
+
+        MetricsSample prev = sample();
+        auto next = std::chrono::steady_clock::now() + interval;
+        while (!stopping.load()) {
+            auto wait = std::chrono::duration_cast<std::chrono::nanoseconds>(next - std::chrono::steady_clock::now());
+            if (wait.count() > 0) {
+                timespec ts{static_cast<time_t>(wait.count() / 1000000000), static_cast<long>(wait.count() % 1000000000)};
+                if (sigtimedwait(&set, nullptr, &ts) == SIGUSR1 && !stopping.load()) {
+                    writeDump(out, sample(), prev);
+                }
+                continue;
+            }
+            MetricsSample now = sample();
+            writeSample(out, now, prev);
+            prev = now;
+            next += interval;
+            if (next <= std::chrono::steady_clock::now()) {
+                next = std::chrono::steady_clock::now() + interval;     // Skip the intervals missed
+            }
+        }
+        writeSample(out, sample(), prev);
+    }
+
+    // Ends run() on the sampler thread, which wakes up immediately.
+    void stop() {
+        stopping.store(true);
+        if (sampling.load()) {
+            pthread_kill(sampler, SIGUSR1);
+        }
+    }
+};
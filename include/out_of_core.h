@@ -0,0 +1,286 @@
+#pragma once
+
+#include "task_graph.h"
+
+// Row-block tiles of a binary matrix file, read and written in place with pread/pwrite.
+// Tile t holds the target rows of task row t: [beta*t + 1, beta*(t+1) + 1), with
+// tile 0 also taking row 0, so a task (i, j) only touches tile i and the tile of its
+// pivot rows, j / (beta/alpha). A tile buffer keeps the file's leading dimension.
+class TileStore {
+    int fd;                         // Open matrix file
+    MatrixFileHeader header;        // Its validated header
+    int beta;                       // Rows per tile
+    int tiles;                      // Number of tiles
+    std::atomic<uint64_t> bytes_read;
+    std::atomic<uint64_t> bytes_written;
+
+    // Byte offset of the first element of row r.
+    uint64_t rowOffset(int r) const {
+        return header.data_offset + static_cast<uint64_t>(r) * header.ld * sizeof(double);
+    }
+
+public:
+    TileStore(const std::string& filename, int beta)
+        : fd(-1), beta(beta), tiles(0), bytes_read(0), bytes_written(0) {
+        fd = ::open(filename.c_str(), O_RDWR);
+        if (fd < 0) {
+            throw std::runtime_error("Error opening file: " + filename);
+        }
+        try {
+            header = matrix_t<double>::read_binary_header(fd, filename);
+        } catch (...) {
+            ::close(fd);
+            throw;
+        }
+        tiles = static_cast<int>((header.rows + beta - 1) / beta);
+    }
+
+    // Throws std::runtime_error if filename is not a binary matrix file a TileStore can page.
+    static void check(const std::string& filename) {
+        int fd = ::open(filename.c_str(), O_RDONLY);
+        if (fd < 0) {
+            throw std::runtime_error("Error opening file: " + filename);
+        }
+        try {
+            matrix_t<double>::read_binary_header(fd, filename);
+        } catch (...) {
+            ::close(fd);
+            throw;
+        }
+        ::close(fd);
+    }
+
+    ~TileStore() {
+        if (fd >= 0) {
+            ::close(fd);
+        }
+    }
+
+    TileStore(const TileStore&) = delete;
+    TileStore& operator=(const TileStore&) = delete;
+
+    int rows() const { return static_cast<int>(header.rows); }
+    int cols() const { return static_cast<int>(header.cols); }
+    int ld() const { return static_cast<int>(header.ld); }
+    int tileCount() const { return tiles; }
+
+    // First and one-past-last matrix row of tile t.
+    int tileBegin(int t) const { return t == 0 ? 0 : beta * t + 1; }
+    int tileEnd(int t) const { return std::min(beta * (t + 1) + 1, rows()); }
+
+    // Tile holding matrix row r.
+    int tileOf(int r) const { return r == 0 ? 0 : (r - 1) / beta; }
+
+    // Elements in the largest tile; the size of one tile buffer.
+    size_t maxTileElements() const {
+        return static_cast<size_t>(std::min(beta + 1, rows())) * ld();
+    }
+
+    // Reads tile t into buf (at least maxTileElements() elements).
+    void read(int t, double* buf) {
+        transfer(t, reinterpret_cast<char*>(buf), false);
+    }
+
+    // Writes tile t from buf back to the file.
+    void write(int t, const double* buf) {
+        transfer(t, reinterpret_cast<char*>(const_cast<double*>(buf)), true);
+    }
+
+    uint64_t bytesRead() const { return bytes_read.load(std::memory_order_relaxed); }
+    uint64_t bytesWritten() const { return bytes_written.load(std::memory_order_relaxed); }
+
+private:
+    void transfer(int t, char* buf, bool writing) {
+        uint64_t offset = rowOffset(tileBegin(t));
+        size_t length = (static_cast<size_t>(tileEnd(t) - tileBegin(t) - 1) * ld() + cols()) * sizeof(double);
+        size_t done = 0;
+        while (done < length) {
+            ssize_t r = writing ? ::pwrite(fd, buf + done, length - done, offset + done)
+                                : ::pread(fd, buf + done, length - done, offset + done);
+            if (r < 0 && errno == EINTR) {
+                continue;
+            }
+            if (r <= 0) {
+                throw std::runtime_error(std::string("Error ") + (writing ? "writing" : "reading")
+                                         + " tile " + std::to_string(t));
+            }
+            done += static_cast<size_t>(r);
+        }
+        (writing ? bytes_written : bytes_read).fetch_add(length, std::memory_order_relaxed);
+    }
+};
+
+// One node of an out-of-core plan: a tile transfer or a compute task.
+struct OocNode {
+    enum Kind : unsigned char { Load, Store, Compute };
+
+    Kind kind;
+    int tile;           // Load/Store: tile moved. Compute: target tile.
+    int slot;           // Buffer of `tile`
+    int pivot_tile;     // Compute: tile holding the pivot rows
+    int pivot_slot;     // Compute: buffer of pivot_tile
+    size_t task;        // Compute: TaskGraph id
+};
+
+// Task DAG of an out-of-core factorization under a fixed number of tile buffers.
+// Target tiles are processed in groups that stay resident in target_slots buffers.
+// For each group, every finished pivot tile above it is streamed through
+// prefetch_slots buffers in order: loading tile p+1 only waits for the buffer last
+// used by tile p+1-prefetch_slots, so it overlaps the updates against tile p.
+// The tasks inside the group then run with the usual data dependencies, and each
+// tile is stored back once the last task reading or writing it has finished.
+// Edges are data dependencies only (row order and panel before update); the release
+// edges of TaskGraph that mirror the dynamic queues are not needed here.
+class OutOfCorePlan {
+    std::vector<OocNode> nodes;
+    std::vector<size_t> pred_count;     // Direct predecessors per node
+    std::vector<size_t> succ_offset;    // CSR successor lists
+    std::vector<size_t> succ;
+    int target_slots;
+    int prefetch_slots;
+    int groups;
+    size_t loads;
+    size_t stores;
+
+public:
+    OutOfCorePlan() : target_slots(0), prefetch_slots(0), groups(0), loads(0), stores(0) {}
+
+    // Builds the plan for graph with `slots` tile buffers, prefetch_slots of which
+    // stream pivot tiles. Throws std::invalid_argument if no target buffer is left.
+    void build(const TaskGraph& graph, int slots, int prefetch_slots) {
+        int tiles = graph.rows();
+        int bda = graph.getBeta() / graph.getAlpha();
+        if (prefetch_slots < 1 || slots < prefetch_slots + 1) {
+            throw std::invalid_argument("OutOfCorePlan: need at least " + std::to_string(prefetch_slots + 1)
+                                        + " tile buffers, have " + std::to_string(slots));
+        }
+        target_slots = std::min(slots - prefetch_slots, tiles);
+        groups = (tiles + target_slots - 1) / target_slots;
+        this->prefetch_slots = groups > 1 ? prefetch_slots : 0;    // Nothing to stream if all tiles fit
+
+        nodes.clear();
+        loads = 0;
+        stores = 0;
+        std::vector<std::pair<size_t, size_t>> edges;
+        auto add = [&](OocNode node) { nodes.push_back(node); return nodes.size() - 1; };
+        const size_t none = std::numeric_limits<size_t>::max();
+
+        std::vector<size_t> compute_node(graph.size(), none);
+        std::vector<size_t> store_node(tiles, none);
+        std::vector<size_t> slot_store(target_slots, none);           // Store of the last tile in a target slot
+        std::vector<std::vector<size_t>> stream_readers(prefetch_slots);
+
+        for (int g = 0; g < groups; ++g) {
+            int a = g * target_slots;
+            int b = std::min(a + target_slots, tiles);
+            auto slot_of = [&](int t) { return t - a; };
+
+            // Resident target tiles.
+            std::vector<size_t> load_node(b - a);
+            std::vector<size_t> last(b - a, none);      // Last compute of each task row so far
+            for (int t = a; t < b; ++t) {
+                load_node[t - a] = add({OocNode::Load, t, slot_of(t), -1, -1, 0});
+                if (slot_store[slot_of(t)] != none) {
+                    edges.emplace_back(slot_store[slot_of(t)], load_node[t - a]);
+                }
+            }
+            auto chain = [&](int i, size_t node) {
+                edges.emplace_back(last[i - a] != none ? last[i - a] : load_node[i - a], node);
+                last[i - a] = node;
+            };
+
+            // Stream the finished pivot tiles above the group.
+            for (int p = 0; p < a; ++p) {
+                int s = p % prefetch_slots;
+                int slot = target_slots + s;
+                size_t load = add({OocNode::Load, p, slot, -1, -1, 0});
+                edges.emplace_back(store_node[p], load);
+                for (size_t reader : stream_readers[s]) {
+                    edges.emplace_back(reader, load);
+                }
+                stream_readers[s].clear();
+
+                for (int i = a; i < b; ++i) {
+                    for (int j = p * bda; j < (p + 1) * bda && graph.contains(i, j); ++j) {
+                        size_t id = graph.id(i, j);
+                        compute_node[id] = add({OocNode::Compute, i, slot_of(i), p, slot, id});
+                        edges.emplace_back(load, compute_node[id]);
+                        chain(i, compute_node[id]);
+                    }
+                    stream_readers[s].push_back(last[i - a]);
+                }
+            }
+
+            // Tasks whose pivot rows lie inside the group, row by row.
+            for (int i = a; i < b; ++i) {
+                for (int j = a * bda; graph.contains(i, j); ++j) {
+                    size_t id = graph.id(i, j);
+                    int p = j / bda;
+                    compute_node[id] = add({OocNode::Compute, i, slot_of(i), p, slot_of(p), id});
+                    chain(i, compute_node[id]);
+                }
+            }
+            for (int i = a; i < b; ++i) {
+                for (int j = a * bda; graph.contains(i, j); ++j) {
+                    const TaskNode& task = graph.node(graph.id(i, j));
+                    if (task.type == 2) {
+                        edges.emplace_back(compute_node[graph.id(j / bda, j)], compute_node[graph.id(i, j)]);
+                    }
+                }
+            }
+
+            // Write each tile back after its own last task and the last update reading it.
+            for (int t = a; t < b; ++t) {
+                size_t store = add({OocNode::Store, t, slot_of(t), -1, -1, 0});
+                for (int i = t; i < b; ++i) {
+                    int j = std::min((t + 1) * bda, graph.cols()) - 1;
+                    edges.emplace_back(compute_node[graph.id(i, j)], store);
+                }
+                store_node[t] = store;
+                slot_store[slot_of(t)] = store;
+            }
+            loads += (b - a) + a;
+            stores += b - a;
+        }
+
+        pred_count.assign(nodes.size(), 0);
+        succ_offset.assign(nodes.size() + 1, 0);
+        for (const auto& e : edges) {
+            ++pred_count[e.second];
+            ++succ_offset[e.first + 1];
+        }
+        for (size_t k = 0; k < nodes.size(); ++k) {
+            succ_offset[k + 1] += succ_offset[k];
+        }
+        succ.assign(edges.size(), 0);
+        std::vector<size_t> fill(succ_offset.begin(), succ_offset.end() - 1);
+        for (const auto& e : edges) {
+            succ[fill[e.first]++] = e.second;
+        }
+    }
+
+    // Number of nodes (transfers and compute tasks).
+    size_t size() const { return nodes.size(); }
+
+    inline const OocNode& node(size_t id) const { return nodes[id]; }
+
+    size_t predecessorCount(size_t id) const { return pred_count[id]; }
+
+    // Calls f(succ_id) for every direct successor of node id.
+    template <class F>
+    void forEachSuccessor(size_t id, F f) const {
+        for (size_t k = succ_offset[id]; k < succ_offset[id + 1]; ++k) {
+            f(succ[k]);
+        }
+    }
+
+    // Buffers used, in total and for streamed pivot tiles.
+    int slots() const { return target_slots + prefetch_slots; }
+    int targetSlots() const { return target_slots; }
+    int prefetchSlots() const { return prefetch_slots; }
+
+    // Number of resident groups, tile loads and tile stores.
+    int groupCount() const { return groups; }
+    size_t loadCount() const { return loads; }
+    size_t storeCount() const { return stores; }
+};
@@ -0,0 +1,352 @@
+#pragma once
+
+#include <array>
+#include <cerrno>
+#include <cstring>
+#include <iomanip>
+#include <linux/perf_event.h>
+#include <sys/syscall.h>
+
+#include "bn2.h"
+
+// An event for perf_event_open.
+struct PerfEventSpec {
+    const char* name;
+    uint32_t type;
+    uint64_t config;
+};
+
+constexpr size_t PERF_MAX_EVENTS = 8;
+
+// Events attributed to tasks: cycles, instructions, last-level cache misses and data TLB
+// misses, all counted in user space only.
+inline const std::vector<PerfEventSpec>& perf_task_events() {
+    static const std::vector<PerfEventSpec> events = {
+        {"cycles", PERF_TYPE_HARDWARE, PERF_COUNT_HW_CPU_CYCLES},
+        {"instructions", PERF_TYPE_HARDWARE, PERF_COUNT_HW_INSTRUCTIONS},
+        {"llc_misses", PERF_TYPE_HW_CACHE, PERF_COUNT_HW_CACHE_LL | (PERF_COUNT_HW_CACHE_OP_READ << 8)
+                                               | (PERF_COUNT_HW_CACHE_RESULT_MISS << 16)},
+        {"dtlb_misses", PERF_TYPE_HW_CACHE, PERF_COUNT_HW_CACHE_DTLB | (PERF_COUNT_HW_CACHE_OP_READ << 8)
+                                                | (PERF_COUNT_HW_CACHE_RESULT_MISS << 16)},
+    };
+    return events;
+}
+
+// Counter values, indexed like the event list; events that could not be opened read 0.
+using PerfSample = std::array<uint64_t, PERF_MAX_EVENTS>;
+
+// One counter group on the calling thread. Events the kernel refuses (no PMU in a VM,
+// perf_event_paranoid, seccomp) are left out individually; all the others are read
+// together with one read() of the group, along with the time the group was enabled and
+// the time it was actually on the PMU, which differ when the kernel multiplexes it.
+class PerfCounters {
+    std::vector<int> fds;           // Per event, -1 if unavailable
+    std::vector<int> slots;         // Position of each event in the group read, -1 if unavailable
+    int leader;
+    int opened;
+    std::string reason;             // Why the first unavailable event failed
+    std::vector<uint64_t> buf;
+
+public:
+    PerfCounters() : leader(-1), opened(0) {}
+    ~PerfCounters() { close(); }
+
+    PerfCounters(const PerfCounters&) = delete;
+    PerfCounters& operator=(const PerfCounters&) = delete;
+
+    // Opens the events for the calling thread. Returns false if none could be opened.
+    bool open(const std::vector<PerfEventSpec>& events) {
+        close();
+        reason.clear();
+        if (events.size() > PERF_MAX_EVENTS) {
+            throw std::invalid_argument("PerfCounters: at most " + std::to_string(PERF_MAX_EVENTS) + " events");
+        }
+        fds.assign(events.size(), -1);
+        slots.assign(events.size(), -1);
+        for (size_t k = 0; k < events.size(); ++k) {
+            perf_event_attr attr;
+            std::memset(&attr, 0, sizeof(attr));
+            attr.size = sizeof(attr);
+            attr.type = events[k].type;
+            attr.config = events[k].config;
+            attr.exclude_kernel = 1;
+            attr.exclude_hv = 1;
+            attr.read_format = PERF_FORMAT_GROUP | PERF_FORMAT_TOTAL_TIME_ENABLED | PERF_FORMAT_TOTAL_TIME_RUNNING;
+            int fd = static_cast<int>(::syscall(SYS_perf_event_open, &attr, 0, -1, leader, 0));
+            if (fd < 0) {
+                if (reason.empty()) {
+                    reason = std::string(events[k].name) + ": " + std::strerror(errno);
+                }
+                continue;
+            }
+            if (leader < 0) {
+                leader = fd;
+            }
+            fds[k] = fd;
+            slots[k] = opened++;
+        }
+        buf.assign(opened + 3, 0);
+        return opened > 0;
+    }
+
+    void close() {
+        for (int fd : fds) {
+            if (fd >= 0) {
+                ::close(fd);
+            }
+        }
+        fds.clear();
+        slots.clear();
+        leader = -1;
+        opened = 0;
+    }
+
+    bool isOpen() const { return opened > 0; }
+    bool available(size_t event) const { return event < slots.size() && slots[event] >= 0; }
+
+    // Why an event could not be opened, empty if all were.
+    const std::string& unavailableReason() const { return reason; }
+
+    // Reads the current raw values of the group into sample, and the nanoseconds the group
+    // has been enabled and running.
+    inline void read(PerfSample& sample, uint64_t& enabled, uint64_t& running) {
+        sample.fill(0);
+        enabled = 0;
+        running = 0;
+        if (leader < 0 || ::read(leader, buf.data(), buf.size() * sizeof(uint64_t)) <= 0) {
+            return;
+        }
+        enabled = buf[1];
+        running = buf[2];
+        for (size_t k = 0; k < slots.size(); ++k) {
+            if (slots[k] >= 0) {
+                sample[k] = buf[3 + slots[k]];
+            }
+        }
+    }
+};
+
+// Counter deltas of one executed task, scaled up by enabled/running time when the group
+// was multiplexed. Not measured if the group never reached the PMU during the task.
+struct PerfTaskRecord {
+    int i;
+    int j;
+    int type;
+    double flops;
+    bool measured;
+    PerfSample delta;
+};
+
+// Counters of one worker thread and the tasks it ran.
+class alignas(64) PerfThread {
+    PerfCounters counters;
+    std::array<bool, PERF_MAX_EVENTS> counted{};    // Events its counters opened
+    PerfSample before;
+    uint64_t before_enabled = 0;
+    uint64_t before_running = 0;
+    std::vector<PerfTaskRecord> records;
+
+    friend class PerfProfiler;
+
+public:
+    // Samples the counters as a task starts.
+    inline void start() {
+        if (counters.isOpen()) {
+            counters.read(before, before_enabled, before_running);
+        }
+    }
+
+    // Attributes the counts since start() to task (i, j).
+    inline void stop(int type, int i, int j, double flops) {
+        if (!counters.isOpen()) {
+            return;
+        }
+        PerfSample after;
+        uint64_t enabled, running;
+        counters.read(after, enabled, running);
+        uint64_t enabled_delta = enabled - before_enabled;
+        uint64_t running_delta = running - before_running;
+        PerfTaskRecord record{i, j, type, flops, running_delta > 0, {}};
+        double scale = running_delta > 0 && running_delta < enabled_delta
+                     ? static_cast<double>(enabled_delta) / running_delta : 1.0;
+        for (size_t k = 0; k < PERF_MAX_EVENTS; ++k) {
+            uint64_t delta = record.measured ? after[k] - before[k] : 0;
+            record.delta[k] = scale == 1.0 ? delta : static_cast<uint64_t>(std::llround(delta * scale));
+        }
+        records.push_back(record);
+    }
+
+    const std::vector<PerfTaskRecord>& tasks() const { return records; }
+};
+
+// Per-task hardware counters of a run. Each worker opens its own counters (open() on the
+// thread itself) and brackets its tasks with start()/stop(); report() aggregates the
+// deltas per task type, writeCsv() lists them per task.
+class PerfProfiler {
+    std::vector<PerfEventSpec> events;
+    std::unique_ptr<PerfThread[]> threads;
+    int thread_count;
+    size_t reserve;
+    std::atomic<int> opened;
+    std::string reason;
+    std::mutex reason_mutex;
+
+    // Index of the named event, -1 if it is not profiled.
+    int eventIndex(const char* name) const {
+        for (size_t k = 0; k < events.size(); ++k) {
+            if (std::strcmp(events[k].name, name) == 0) {
+                return static_cast<int>(k);
+            }
+        }
+        return -1;
+    }
+
+public:
+    PerfProfiler() : thread_count(0), reserve(0), opened(0) {}
+
+    // Prepares counters for `threads` threads with room for tasks_per_thread records each.
+    void init(int threads, size_t tasks_per_thread, const std::vector<PerfEventSpec>& events = perf_task_events()) {
+        this->events = events;
+        this->threads.reset(new PerfThread[threads]);
+        thread_count = threads;
+        reserve = tasks_per_thread;
+        opened.store(0);
+        reason.clear();
+    }
+
+    // Opens the counters of thread tid; call on that thread. Returns false (and keeps the
+    // reason) if the kernel refused every event.
+    bool open(int tid) {
+        PerfThread& thread = threads[tid];
+        thread.records.reserve(reserve);
+        bool ok = thread.counters.open(events);
+        for (size_t k = 0; k < events.size(); ++k) {
+            thread.counted[k] = thread.counters.available(k);
+        }
+        if (ok) {
+            opened.fetch_add(1);
+        }
+        if (!thread.counters.unavailableReason().empty()) {
+            std::lock_guard<std::mutex> lock(reason_mutex);
+            if (reason.empty()) {
+                reason = thread.counters.unavailableReason();
+            }
+        }
+        return ok;
+    }
+
+    // Closes the counters of thread tid, keeping its records.
+    void close(int tid) { threads[tid].counters.close(); }
+
+    inline PerfThread& thread(int tid) { return threads[tid]; }
+
+    // Threads whose counters opened, and why an event was unavailable.
+    int openedThreads() const { return opened.load(); }
+    const std::string& unavailableReason() const { return reason; }
+
+    // Sum of the deltas of every task of the given type (0: all types). Given events, only
+    // the measured tasks of threads that counted all of them are summed, so tasks and flops
+    // describe the same tasks as the counts.
+    PerfSample total(int type, size_t& tasks, double& flops, std::initializer_list<int> needed = {}) const {
+        PerfSample sum{};
+        tasks = 0;
+        flops = 0;
+        for (int t = 0; t < thread_count; ++t) {
+            bool counted = true;
+            for (int event : needed) {
+                counted = counted && event >= 0 && threads[t].counted[event];
+            }
+            if (!counted) {
+                continue;
+            }
+            for (const PerfTaskRecord& r : threads[t].records) {
+                if ((type != 0 && r.type != type) || (needed.size() > 0 && !r.measured)) {
+                    continue;
+                }
+                for (size_t k = 0; k < PERF_MAX_EVENTS; ++k) {
+                    sum[k] += r.delta[k];
+                }
+                flops += r.flops;
+                tasks++;
+            }
+        }
+        return sum;
+    }
+
+    // Per task type: IPC, cache and TLB misses per flop, and the DRAM traffic the LLC
+    // misses imply (64 bytes each) per flop, each over the threads that counted its events.
+    // Events that no thread counted print n/a.
+    void report(std::ostream& out) const {
+        if (opened.load() == 0) {
+            out << "Perf counters: unavailable (" << (reason.empty() ? "not opened" : reason) << ")" << std::endl;
+            return;
+        }
+        int cycles = eventIndex("cycles"), instructions = eventIndex("instructions");
+        int llc = eventIndex("llc_misses"), dtlb = eventIndex("dtlb_misses");
+        out << "Perf counters (" << opened.load() << " of " << thread_count << " threads";
+        if (!reason.empty()) {
+            out << ", unavailable: " << reason;
+        }
+        out << "):" << std::endl;
+        std::ios state(nullptr);
+        state.copyfmt(out);
+        out << std::fixed << std::setprecision(4);
+        static const char* const names[] = {"all", "panel", "update"};
+        for (int type : {1, 2}) {
+            size_t tasks;
+            double flops;
+            total(type, tasks, flops);
+            out << "  " << std::left << std::setw(7) << names[type] << std::right << tasks << " tasks, "
+                << flops / 1e9 << " GFLOP";
+            // num per den events, or per flop without den, times scale.
+            auto ratio = [&](const char* label, int num, int den, double scale) {
+                size_t counted_tasks;
+                double counted_flops;
+                PerfSample counts = den >= 0 ? total(type, counted_tasks, counted_flops, {num, den})
+                                             : total(type, counted_tasks, counted_flops, {num});
+                double denominator = den >= 0 ? static_cast<double>(counts[den]) : counted_flops;
+                out << ", " << label << " ";
+                if (num < 0 || counted_tasks == 0 || denominator <= 0) {
+                    out << "n/a";
+                } else {
+                    out << scale * counts[num] / denominator;
+                }
+            };
+            ratio("IPC", instructions, cycles, 1.0);
+            ratio("LLC misses/flop", llc, -1, 1.0);
+            ratio("dTLB misses/flop", dtlb, -1, 1.0);
+            ratio("DRAM bytes/flop", llc, -1, 64.0);
+            out << std::endl;
+        }
+        out.copyfmt(state);
+    }
+
+    // Writes one line per task: position, type, flops and the counter deltas, empty where the
+    // thread did not count the event or the task was not measured.
+    void writeCsv(const std::string& filename) const {
+        std::ofstream out(filename, std::ios::trunc);
+        if (!out.is_open()) {
+            throw std::runtime_error("Error opening file for writing: " + filename);
+        }
+        out << "thread,i,j,type,flops";
+        for (const auto& event : events) {
+            out << "," << event.name;
+        }
+        out << "\n";
+        for (int t = 0; t < thread_count; ++t) {
+            for (const PerfTaskRecord& r : threads[t].records) {
+                out << t << "," << r.i << "," << r.j << "," << r.type << "," << static_cast<uint64_t>(r.flops);
+                for (size_t k = 0; k < events.size(); ++k) {
+                    out << ",";
+                    if (threads[t].counted[k] && r.measured) {
+                        out << r.delta[k];
+                    }
+                }
+                out << "\n";
+            }
+        }
+        if (out.fail()) {
+            throw std::runtime_error("Error writing perf counters to file: " + filename);
+        }
+    }
+};
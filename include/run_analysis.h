@@ -0,0 +1,217 @@
+#pragma once
+
+#include <array>
+#include <iomanip>
+#include <numeric>
+
+#include "task_graph.h"
+#include "trace.h"
+
+// What a worker thread is doing.
+enum class WorkerPhase : int {
+    Compute,        // Running a kernel
+    Queue,          // Popping and pushing ready tasks
+    Dependency,     // Checking and recording dependencies, releasing successors
+    Idle,           // Spinning or sleeping without work
+    Count
+};
+
+// Splits a worker's lifetime into phases: enter() charges the time since the previous
+// switch to the phase that was running, with one TSC read per switch.
+class alignas(64) PhaseTimer {
+    std::array<uint64_t, static_cast<size_t>(WorkerPhase::Count)> ticks;
+    WorkerPhase current;
+    uint64_t since;
+
+public:
+    PhaseTimer() : ticks{}, current(WorkerPhase::Idle), since(0) {}
+
+    void start(WorkerPhase phase) {
+        ticks.fill(0);
+        current = phase;
+        since = trace_ticks();
+    }
+
+    inline void enter(WorkerPhase phase) {
+        enter(phase, current);
+    }
+
+    // Like enter(), but charges the time since the previous switch to `charged` instead
+    // of the phase that was running, e.g. a pop that turned out to find no work.
+    inline void enter(WorkerPhase phase, WorkerPhase charged) {
+        uint64_t now = trace_ticks();
+        ticks[static_cast<size_t>(charged)] += now - since;
+        since = now;
+        current = phase;
+    }
+
+    // Charges the running phase up to now.
+    void stop() { enter(current); }
+
+    uint64_t get(WorkerPhase phase) const { return ticks[static_cast<size_t>(phase)]; }
+};
+
+// CPU time of the calling thread in nanoseconds. Unlike wall time it leaves out the time
+// the thread was preempted, so task durations stay meaningful when workers outnumber cores.
+inline uint64_t thread_cpu_ns() {
+    timespec ts;
+    clock_gettime(CLOCK_THREAD_CPUTIME_ID, &ts);
+    return static_cast<uint64_t>(ts.tv_sec) * 1000000000ull + static_cast<uint64_t>(ts.tv_nsec);
+}
+
+// Post-run analysis of a factorization: the critical path and total work of the task
+// DAG under the measured task durations, set against the observed makespan and the
+// workers' phase breakdown, to tell which bound limited the run.
+class RunAnalysis {
+public:
+    enum class Bound { CriticalPath, Work, Scheduler, Imbalance };
+
+    using PhaseMs = std::array<double, static_cast<size_t>(WorkerPhase::Count)>;
+
+private:
+    double work_ms = 0;
+    double critical_path_ms = 0;
+    size_t path_tasks = 0;
+    size_t path_panels = 0;
+    double path_panel_ms = 0;
+    double makespan_ms = 0;
+    int workers = 0;
+    int cores = 0;
+    PhaseMs phase_ms{};                 // Summed over the workers
+    double compute_max_ms = 0;          // Busiest worker's compute time
+    Bound verdict = Bound::Work;
+
+    static const char* phaseName(size_t phase) {
+        static const char* const names[] = {"compute", "queue", "dependency checks", "idle/spinning"};
+        return names[phase];
+    }
+
+public:
+    // task_ms holds the measured (CPU) duration of every task by TaskGraph id (0 for tasks
+    // that did not run, e.g. restored from a checkpoint), worker_ms the phase times of
+    // each worker. hardware_threads caps the parallelism the work bound assumes.
+    void analyze(const TaskGraph& graph, const std::vector<double>& task_ms, double makespan_ms,
+                 const std::vector<PhaseMs>& worker_ms, int hardware_threads) {
+        this->makespan_ms = makespan_ms;
+        workers = static_cast<int>(worker_ms.size());
+        cores = std::max(1, std::min(workers, hardware_threads > 0 ? hardware_threads : workers));
+
+        work_ms = std::accumulate(task_ms.begin(), task_ms.end(), 0.0);
+        std::vector<double> level = graph.topLevels([&](size_t id) { return task_ms[id]; });
+
+        // Walk the critical path back from its last task.
+        path_tasks = path_panels = 0;
+        path_panel_ms = critical_path_ms = 0;
+        if (!level.empty()) {
+            size_t id = static_cast<size_t>(std::max_element(level.begin(), level.end()) - level.begin());
+            critical_path_ms = level[id];
+            while (true) {
+                path_tasks++;
+                if (graph.node(id).type == 1) {
+                    path_panels++;
+                    path_panel_ms += task_ms[id];
+                }
+                size_t next = id;
+                double best = -1.0;
+                graph.forEachPredecessor(id, [&](size_t pred) {
+                    if (level[pred] > best) {
+                        best = level[pred];
+                        next = pred;
+                    }
+                });
+                if (next == id) {
+                    break;
+                }
+                id = next;
+            }
+        }
+
+        phase_ms.fill(0);
+        compute_max_ms = 0;
+        for (const PhaseMs& w : worker_ms) {
+            for (size_t p = 0; p < phase_ms.size(); ++p) {
+                phase_ms[p] += w[p];
+            }
+            compute_max_ms = std::max(compute_max_ms, w[static_cast<size_t>(WorkerPhase::Compute)]);
+        }
+
+        // The lower bound that is closer to the makespan explains it, unless the
+        // workers spent their time elsewhere: in the scheduler or waiting for work
+        // the DAG could have provided. With more workers than cores the phase times
+        // mostly measure preemption, so they are not consulted: a run the critical
+        // path does not explain is work bound.
+        double work_bound = work_ms / cores;
+        double overhead = share(WorkerPhase::Queue) + share(WorkerPhase::Dependency);
+        double idle = share(WorkerPhase::Idle);
+        if (critical_path_ms >= work_bound && critical_path_ms >= 0.5 * makespan_ms) {
+            verdict = Bound::CriticalPath;
+        } else if (workers > cores || (work_bound >= 0.5 * makespan_ms && share(WorkerPhase::Compute) >= 0.5)) {
+            verdict = Bound::Work;
+        } else if (overhead >= idle) {
+            verdict = Bound::Scheduler;
+        } else {
+            verdict = Bound::Imbalance;
+        }
+    }
+
+    // Fraction of all worker time spent in phase.
+    double share(WorkerPhase phase) const {
+        double total = std::accumulate(phase_ms.begin(), phase_ms.end(), 0.0);
+        return total > 0 ? phase_ms[static_cast<size_t>(phase)] / total : 0.0;
+    }
+
+    double workMs() const { return work_ms; }
+    double criticalPathMs() const { return critical_path_ms; }
+    size_t criticalPathTasks() const { return path_tasks; }
+    size_t criticalPathPanels() const { return path_panels; }
+    double parallelism() const { return critical_path_ms > 0 ? work_ms / critical_path_ms : 0.0; }
+    double lowerBoundMs() const { return std::max(critical_path_ms, work_ms / cores); }
+    Bound bound() const { return verdict; }
+
+    void report(std::ostream& out) const {
+        std::ios state(nullptr);
+        state.copyfmt(out);
+        out << std::fixed << std::setprecision(2);
+        out << "Analysis: work " << work_ms << " ms, critical path " << critical_path_ms << " ms ("
+            << path_tasks << " tasks, " << path_panels << " panels taking " << path_panel_ms
+            << " ms), parallelism " << parallelism() << std::endl;
+        out << "  Makespan " << makespan_ms << " ms vs lower bound " << lowerBoundMs()
+            << " ms (critical path, or work over " << cores << " cores for " << workers << " workers): "
+            << (lowerBoundMs() > 0 ? makespan_ms / lowerBoundMs() : 0.0) << "x" << std::endl;
+        out << "  Worker time:";
+        for (size_t p = 0; p < phase_ms.size(); ++p) {
+            out << (p ? ", " : " ") << phaseName(p) << " " << 100.0 * share(static_cast<WorkerPhase>(p)) << " %";
+        }
+        double compute_mean = workers ? phase_ms[static_cast<size_t>(WorkerPhase::Compute)] / workers : 0.0;
+        out << "; busiest worker computes " << (compute_mean > 0 ? compute_max_ms / compute_mean : 0.0)
+            << "x the mean" << std::endl;
+        if (workers > cores) {
+            out << "  (" << workers << " workers share " << cores << " hardware threads: task durations are CPU time, "
+                << "phase times include preemption)" << std::endl;
+        }
+
+        out << "  Bound: ";
+        switch (verdict) {
+            case Bound::CriticalPath:
+                out << "critical path. The panel chain allows " << parallelism() << "-way parallelism; "
+                    << "shorten the panels (smaller ALPHA) or prioritize them.";
+                break;
+            case Bound::Work:
+                out << "work. The kernels need " << work_ms << " ms of CPU time over " << cores << " cores, "
+                    << (makespan_ms > 0 ? 100.0 * work_ms / cores / makespan_ms : 0.0)
+                    << " % of the makespan; faster kernels or more cores are needed.";
+                break;
+            case Bound::Scheduler:
+                out << "scheduler. Queue operations and dependency checks take "
+                    << 100.0 * (share(WorkerPhase::Queue) + share(WorkerPhase::Dependency))
+                    << " % of worker time; use larger tiles or a cheaper queue.";
+                break;
+            case Bound::Imbalance:
+                out << "load imbalance. Workers idle " << 100.0 * share(WorkerPhase::Idle)
+                    << " % of the time although the DAG has " << parallelism() << "-way parallelism.";
+                break;
+        }
+        out << std::endl;
+        out.copyfmt(state);
+    }
+};
@@ -0,0 +1,319 @@
+#pragma once
+
+#include <iomanip>
+
+#include "task_graph.h"
+#include "trace.h"
+
+// One task as a worker ran it, with times in microseconds since the start of the run.
+struct ScheduleEntry {
+    int i;
+    int j;
+    double start_us;
+    double end_us;
+};
+
+// Per-worker task order of a run: the tasks each worker took, in the order it took them.
+// Written by ScheduleRecorder, replayed through StaticSchedule::assign(), compared with
+// ScheduleDiff.
+class ScheduleLog {
+    int mat_rows;
+    int mat_cols;
+    int alpha;
+    int beta;
+    std::vector<std::vector<ScheduleEntry>> workers;
+
+public:
+    ScheduleLog() : mat_rows(0), mat_cols(0), alpha(0), beta(0) {}
+
+    ScheduleLog(int mat_rows, int mat_cols, int alpha, int beta, int threads)
+        : mat_rows(mat_rows), mat_cols(mat_cols), alpha(alpha), beta(beta), workers(threads) {}
+
+    void add(int tid, const ScheduleEntry& entry) { workers[tid].push_back(entry); }
+
+    int threads() const { return static_cast<int>(workers.size()); }
+    const std::vector<ScheduleEntry>& tasks(int tid) const { return workers[tid]; }
+
+    int matrixRows() const { return mat_rows; }
+    int matrixCols() const { return mat_cols; }
+    int getAlpha() const { return alpha; }
+    int getBeta() const { return beta; }
+
+    size_t taskCount() const {
+        size_t count = 0;
+        for (const auto& list : workers) {
+            count += list.size();
+        }
+        return count;
+    }
+
+    // End of the last task.
+    double makespanUs() const {
+        double end = 0.0;
+        for (const auto& list : workers) {
+            for (const ScheduleEntry& e : list) {
+                end = std::max(end, e.end_us);
+            }
+        }
+        return end;
+    }
+
+    // Whether the log was recorded for the shape of graph.
+    bool matches(const TaskGraph& graph) const {
+        return mat_rows == graph.matrixRows() && mat_cols == graph.matrixCols()
+               && alpha == graph.getAlpha() && beta == graph.getBeta();
+    }
+
+    // TaskGraph ids of every worker's tasks in order. Throws if the log was recorded for
+    // another shape or does not hold every task of graph exactly once.
+    std::vector<std::vector<size_t>> threadLists(const TaskGraph& graph) const {
+        if (!matches(graph)) {
+            throw std::runtime_error("ScheduleLog: recorded for " + std::to_string(mat_rows) + " x "
+                                     + std::to_string(mat_cols) + " with ALPHA " + std::to_string(alpha)
+                                     + ", BETA " + std::to_string(beta) + ", not this matrix");
+        }
+        std::vector<std::vector<size_t>> lists(workers.size());
+        std::vector<bool> seen(graph.size(), false);
+        for (size_t t = 0; t < workers.size(); ++t) {
+            for (const ScheduleEntry& e : workers[t]) {
+                if (!graph.contains(e.i, e.j) || seen[graph.id(e.i, e.j)]) {
+                    throw std::runtime_error("ScheduleLog: task (" + std::to_string(e.i) + ", " + std::to_string(e.j)
+                                             + ") is not a task of the graph or appears twice");
+                }
+                seen[graph.id(e.i, e.j)] = true;
+                lists[t].push_back(graph.id(e.i, e.j));
+            }
+        }
+        if (taskCount() != graph.size()) {
+            throw std::runtime_error("ScheduleLog: holds " + std::to_string(taskCount()) + " of "
+                                     + std::to_string(graph.size()) + " tasks (a resumed run?)");
+        }
+        return lists;
+    }
+
+    // Text format: a header with the shape and the number of workers, then per worker a
+    // line with its task count followed by one "i j start_us end_us" line per task.
+    void save(const std::string& filename) const {
+        std::ofstream out(filename, std::ios::trunc);
+        if (!out.is_open()) {
+            throw std::runtime_error("Error opening file for writing: " + filename);
+        }
+        out << "schedule_log 1\n" << mat_rows << " " << mat_cols << " " << alpha << " " << beta << " "
+            << workers.size() << "\n";
+        out << std::fixed << std::setprecision(3);
+        for (const auto& list : workers) {
+            out << list.size() << "\n";
+            for (const ScheduleEntry& e : list) {
+                out << e.i << " " << e.j << " " << e.start_us << " " << e.end_us << "\n";
+            }
+        }
+        if (out.fail()) {
+            throw std::runtime_error("Error writing schedule log to file: " + filename);
+        }
+    }
+
+    static ScheduleLog load(const std::string& filename) {
+        std::ifstream in(filename);
+        if (!in.is_open()) {
+            throw std::runtime_error("Error opening file: " + filename);
+        }
+        std::string magic;
+        int version = 0, threads = 0;
+        ScheduleLog log;
+        if (!(in >> magic >> version >> log.mat_rows >> log.mat_cols >> log.alpha >> log.beta >> threads)
+            || magic != "schedule_log" || version != 1 || threads < 0) {
+            throw std::runtime_error("Error: " + filename + " is not a schedule log.");
+        }
+        log.workers.resize(threads);
+        for (auto& list : log.workers) {
+            size_t count = 0;
+            if (!(in >> count)) {
+                throw std::runtime_error("Error reading schedule log: " + filename);
+            }
+            list.resize(count);
+            for (ScheduleEntry& e : list) {
+                if (!(in >> e.i >> e.j >> e.start_us >> e.end_us)) {
+                    throw std::runtime_error("Error reading schedule log: " + filename);
+                }
+            }
+        }
+        return log;
+    }
+};
+
+// Collects the schedule of a run. Every worker appends to its own preallocated buffer
+// with TSC timestamps; log() converts them after the run.
+class ScheduleRecorder {
+    struct Raw {
+        int i;
+        int j;
+        uint64_t start;
+        uint64_t end;
+    };
+    struct alignas(64) Buffer {
+        std::vector<Raw> entries;
+    };
+    std::vector<Buffer> buffers;
+    TraceClock clock;
+
+public:
+    void init(int threads, size_t tasks_per_thread) {
+        buffers = std::vector<Buffer>(threads);
+        for (auto& buffer : buffers) {
+            buffer.entries.reserve(tasks_per_thread);
+        }
+    }
+
+    // Bracket the recorded run.
+    void start() { clock.start(); }
+    void stop() { clock.stop(); }
+
+    // Worker tid ran task (i, j) from trace ticks start to end.
+    inline void record(int tid, int i, int j, uint64_t start, uint64_t end) {
+        buffers[tid].entries.push_back({i, j, start, end});
+    }
+
+    ScheduleLog log(int mat_rows, int mat_cols, int alpha, int beta) const {
+        ScheduleLog log(mat_rows, mat_cols, alpha, beta, static_cast<int>(buffers.size()));
+        for (size_t t = 0; t < buffers.size(); ++t) {
+            for (const Raw& r : buffers[t].entries) {
+                log.add(static_cast<int>(t), {r.i, r.j, clock.toMicros(r.start), clock.toMicros(r.end)});
+            }
+        }
+        return log;
+    }
+};
+
+// Task-by-task comparison of two logs of the same matrix, e.g. a slow run against a
+// normal one: whether the kernels themselves got slower or the tasks ran on other
+// workers, in another order or after longer waits.
+class ScheduleDiff {
+public:
+    struct TaskDelta {
+        int i;
+        int j;
+        double duration_us[2];
+        double start_us[2];
+        int worker[2];
+    };
+
+private:
+    double makespan_us[2] = {0, 0};
+    double task_us[2][2] = {{0, 0}, {0, 0}};    // [log][panel, update]: summed durations
+    size_t moved = 0;                           // Tasks on another worker
+    size_t reordered = 0;                       // Tasks at another position of the same worker
+    int threads[2] = {0, 0};
+    std::vector<TaskDelta> deltas;
+
+public:
+    // Compares log a with log b. Throws if they were recorded for different matrices or
+    // do not hold the same tasks.
+    void compare(const ScheduleLog& a, const ScheduleLog& b) {
+        if (a.matrixRows() != b.matrixRows() || a.matrixCols() != b.matrixCols()
+            || a.getAlpha() != b.getAlpha() || a.getBeta() != b.getBeta()) {
+            throw std::runtime_error("ScheduleDiff: the logs were recorded for different matrices");
+        }
+        int bda = a.getBeta() / a.getAlpha();
+        int rows = (a.matrixRows() + a.getBeta() - 1) / a.getBeta();
+        int cols = (a.matrixRows() + a.getAlpha() - 1) / a.getAlpha();
+        auto index = [&](int i, int j) { return static_cast<size_t>(i) * cols + j; };
+
+        const size_t NONE = std::numeric_limits<size_t>::max();
+        std::vector<size_t> slot(static_cast<size_t>(rows) * cols, NONE);
+        std::vector<size_t> position(static_cast<size_t>(rows) * cols, 0);
+        deltas.clear();
+        moved = reordered = 0;
+        const ScheduleLog* logs[2] = {&a, &b};
+        for (int k = 0; k < 2; ++k) {
+            makespan_us[k] = logs[k]->makespanUs();
+            threads[k] = logs[k]->threads();
+            task_us[k][0] = task_us[k][1] = 0;
+            for (int t = 0; t < logs[k]->threads(); ++t) {
+                const auto& list = logs[k]->tasks(t);
+                for (size_t p = 0; p < list.size(); ++p) {
+                    const ScheduleEntry& e = list[p];
+                    if (e.i < 0 || e.i >= rows || e.j < 0 || e.j >= cols) {
+                        throw std::runtime_error("ScheduleDiff: task outside the matrix");
+                    }
+                    size_t cell = index(e.i, e.j);
+                    bool panel = e.i * bda <= e.j && e.j < (e.i + 1) * bda;
+                    task_us[k][panel ? 0 : 1] += e.end_us - e.start_us;
+                    if (k == 0) {
+                        if (slot[cell] != NONE) {
+                            throw std::runtime_error("ScheduleDiff: task appears twice");
+                        }
+                        slot[cell] = deltas.size();
+                        position[cell] = p;
+                        deltas.push_back({e.i, e.j, {e.end_us - e.start_us, 0}, {e.start_us, 0}, {t, -1}});
+                    } else {
+                        if (slot[cell] == NONE || deltas[slot[cell]].worker[1] >= 0) {
+                            throw std::runtime_error("ScheduleDiff: the logs do not hold the same tasks");
+                        }
+                        TaskDelta& d = deltas[slot[cell]];
+                        d.duration_us[1] = e.end_us - e.start_us;
+                        d.start_us[1] = e.start_us;
+                        d.worker[1] = t;
+                        if (d.worker[0] != t) {
+                            moved++;
+                        } else if (position[cell] != p) {
+                            reordered++;
+                        }
+                    }
+                }
+            }
+        }
+        if (a.taskCount() != b.taskCount()) {
+            throw std::runtime_error("ScheduleDiff: the logs do not hold the same tasks");
+        }
+    }
+
+    double makespanUs(int log) const { return makespan_us[log]; }
+    double taskUs(int log, int type) const { return task_us[log][type == 1 ? 0 : 1]; }
+    size_t movedTasks() const { return moved; }
+    size_t reorderedTasks() const { return reordered; }
+    const std::vector<TaskDelta>& tasks() const { return deltas; }
+
+    // Summary, then the `top` tasks whose duration grew the most and those whose start
+    // moved the most relative to the makespan.
+    void report(std::ostream& out, size_t top = 10) const {
+        std::ios state(nullptr);
+        state.copyfmt(out);
+        out << std::fixed << std::setprecision(3);
+        out << "Makespan: " << makespan_us[0] / 1e3 << " ms vs " << makespan_us[1] / 1e3 << " ms ("
+            << (makespan_us[1] > 0 ? makespan_us[0] / makespan_us[1] : 0.0) << "x)" << std::endl;
+        static const char* const names[] = {"Panel", "Update"};
+        for (int k = 0; k < 2; ++k) {
+            out << names[k] << " time: " << task_us[0][k] / 1e3 << " ms vs " << task_us[1][k] / 1e3 << " ms ("
+                << (task_us[1][k] > 0 ? task_us[0][k] / task_us[1][k] : 0.0) << "x)" << std::endl;
+        }
+        double busy[2] = {task_us[0][0] + task_us[0][1], task_us[1][0] + task_us[1][1]};
+        for (int k = 0; k < 2; ++k) {
+            out << "Run " << (k ? "B" : "A") << ": " << threads[k] << " workers, utilization "
+                << (makespan_us[k] > 0 && threads[k] ? 100.0 * busy[k] / (threads[k] * makespan_us[k]) : 0.0) << " %"
+                << std::endl;
+        }
+        out << "Placement: " << moved << " of " << deltas.size() << " tasks on another worker, " << reordered
+            << " more at another position on the same worker" << std::endl;
+
+        std::vector<const TaskDelta*> sorted;
+        for (const TaskDelta& d : deltas) {
+            sorted.push_back(&d);
+        }
+        auto list = [&](const char* title, auto key) {
+            std::sort(sorted.begin(), sorted.end(), [&](const TaskDelta* x, const TaskDelta* y) { return key(*x) > key(*y); });
+            out << title << std::endl;
+            for (size_t k = 0; k < std::min(top, sorted.size()); ++k) {
+                const TaskDelta& d = *sorted[k];
+                out << "  (" << d.i << ", " << d.j << "): " << d.duration_us[0] << " us on worker " << d.worker[0]
+                    << " at " << d.start_us[0] / 1e3 << " ms vs " << d.duration_us[1] << " us on worker " << d.worker[1]
+                    << " at " << d.start_us[1] / 1e3 << " ms" << std::endl;
+            }
+        };
+        list("Largest duration increases (A vs B):",
+             [](const TaskDelta& d) { return d.duration_us[0] - d.duration_us[1]; });
+        double scale = makespan_us[1] > 0 ? makespan_us[0] / makespan_us[1] : 1.0;
+        list("Largest start delays after scaling B to A's makespan:",
+             [scale](const TaskDelta& d) { return d.start_us[0] - scale * d.start_us[1]; });
+        out.copyfmt(state);
+    }
+};
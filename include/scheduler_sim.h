@@ -0,0 +1,308 @@
+#pragma once
+
+#include <array>
+#include <deque>
+#include <numeric>
+#include <queue>
+#include <random>
+
+#include "task_graph.h"
+
+// Scheduling policies the simulator can run.
+enum class SimPolicy {
+    Fifo,           // One shared FIFO, like main_queue
+    Rotation,       // Shared FIFO with push_rotated for critical tasks (PRIORITIZE_CRITICAL_NODES)
+    CriticalPath,   // Shared priority queue on the bottom level (longest path to the exit)
+    WorkStealing    // Per-worker deques: LIFO for the owner, FIFO for random thieves
+};
+
+inline const char* simPolicyName(SimPolicy policy) {
+    switch (policy) {
+        case SimPolicy::Fifo: return "fifo";
+        case SimPolicy::Rotation: return "rotation";
+        case SimPolicy::CriticalPath: return "critical";
+        case SimPolicy::WorkStealing: return "stealing";
+    }
+    return "unknown";
+}
+
+inline SimPolicy parseSimPolicy(const std::string& name) {
+    for (SimPolicy policy : {SimPolicy::Fifo, SimPolicy::Rotation, SimPolicy::CriticalPath, SimPolicy::WorkStealing}) {
+        if (name == simPolicyName(policy)) {
+            return policy;
+        }
+    }
+    throw std::invalid_argument("Unknown scheduling policy: " + name);
+}
+
+// Task durations and scheduler costs in nanoseconds. A task of type t takes
+// ns_per_flop[t-1] * cost + task_ns[t-1], cost being the TaskGraph flop estimate.
+// Operations on a shared queue hold its lock for queue_ns each and are serialized;
+// operations on a worker's own deque take queue_ns without contention, a steal steal_ns.
+struct SimCostModel {
+    std::array<double, 2> ns_per_flop = {0.5, 0.5};     // Panel, update
+    std::array<double, 2> task_ns = {0.0, 0.0};
+    double queue_ns = 50.0;
+    double steal_ns = 100.0;
+
+    double duration(const TaskNode& task) const {
+        size_t k = task.type == 1 ? 0 : 1;
+        return ns_per_flop[k] * task.cost + task_ns[k];
+    }
+};
+
+// Predicted run of one policy on one worker count.
+struct SimResult {
+    SimPolicy policy;
+    int workers;
+    double makespan_ns;
+    double work_ns;             // Sum of the task durations
+    double critical_path_ns;    // Longest chain of task durations
+    double queue_ns;            // Worker time spent in queue operations, waiting for the lock included
+    size_t steals;
+
+    double utilization() const { return makespan_ns > 0 ? work_ns / (workers * makespan_ns) : 0.0; }
+    double speedup() const { return makespan_ns > 0 ? work_ns / makespan_ns : 0.0; }
+};
+
+// Ready tasks under a policy. Implement a new policy by deriving from it and adding it to
+// SchedulerSimulator::makeQueue().
+class SimReadyQueue {
+public:
+    virtual ~SimReadyQueue() = default;
+
+    // Queues task id, made ready by worker (-1 for the tasks ready at the start).
+    // critical marks the tasks the dynamic scheduler pushes with push_rotated.
+    virtual void push(size_t id, int worker, bool critical) = 0;
+
+    // Takes a task for worker; false if there is none. Sets stolen if it came from
+    // another worker.
+    virtual bool pop(int worker, size_t& id, bool& stolen) = 0;
+
+    // Whether all workers share one lock.
+    virtual bool shared() const = 0;
+};
+
+// main_queue: a FIFO, optionally with the rotation of CircularQueueMtx::push_rotated,
+// which moves the previous tail to the second slot when a critical task is queued.
+class SimFifoQueue : public SimReadyQueue {
+    std::deque<size_t> tasks;
+    bool rotate;
+
+public:
+    explicit SimFifoQueue(bool rotate) : rotate(rotate) {}
+
+    void push(size_t id, int, bool critical) override {
+        tasks.push_back(id);
+        if (rotate && critical && tasks.size() > 3) {
+            std::swap(tasks[1], tasks[tasks.size() - 2]);
+        }
+    }
+
+    bool pop(int, size_t& id, bool& stolen) override {
+        if (tasks.empty()) {
+            return false;
+        }
+        id = tasks.front();
+        tasks.pop_front();
+        stolen = false;
+        return true;
+    }
+
+    bool shared() const override { return true; }
+};
+
+// Shared priority queue: the task with the longest remaining path first, ties by id.
+class SimPriorityQueue : public SimReadyQueue {
+    const std::vector<double>& rank;
+    std::priority_queue<std::pair<double, size_t>> tasks;
+
+public:
+    explicit SimPriorityQueue(const std::vector<double>& rank) : rank(rank) {}
+
+    void push(size_t id, int, bool) override {
+        tasks.emplace(rank[id], std::numeric_limits<size_t>::max() - id);
+    }
+
+    bool pop(int, size_t& id, bool& stolen) override {
+        if (tasks.empty()) {
+            return false;
+        }
+        id = std::numeric_limits<size_t>::max() - tasks.top().second;
+        tasks.pop();
+        stolen = false;
+        return true;
+    }
+
+    bool shared() const override { return true; }
+};
+
+// A deque per worker. Released tasks go to the releasing worker's deque (the initial
+// ones to worker 0's); a worker takes its newest task, and with an empty deque steals
+// the oldest task of a random non-empty victim.
+class SimStealingQueues : public SimReadyQueue {
+    std::vector<std::deque<size_t>> deques;
+    std::mt19937 rng;
+    size_t queued;
+
+public:
+    SimStealingQueues(int workers, unsigned seed) : deques(workers), rng(seed), queued(0) {}
+
+    void push(size_t id, int worker, bool) override {
+        deques[worker < 0 ? 0 : worker].push_back(id);
+        queued++;
+    }
+
+    bool pop(int worker, size_t& id, bool& stolen) override {
+        if (queued == 0) {
+            return false;
+        }
+        std::deque<size_t>& own = deques[worker];
+        if (!own.empty()) {
+            id = own.back();
+            own.pop_back();
+            stolen = false;
+        } else {
+            int victims = static_cast<int>(deques.size());
+            int start = std::uniform_int_distribution<int>(0, victims - 1)(rng);
+            int victim = start;
+            while (deques[victim].empty()) {
+                victim = (victim + 1) % victims;
+            }
+            id = deques[victim].front();
+            deques[victim].pop_front();
+            stolen = true;
+        }
+        queued--;
+        return true;
+    }
+
+    bool shared() const override { return false; }
+};
+
+// Discrete-event simulation of the dynamic scheduler on a TaskGraph: P workers take
+// tasks from the policy's ready queue, run them for the cost model's duration and queue
+// the successors they make ready. An idle worker is woken by the next push. Wait-queue
+// polling and the spinning of idle workers are not modelled.
+class SchedulerSimulator {
+    const TaskGraph& graph;
+    SimCostModel model;
+    std::vector<double> duration;
+    std::vector<double> rank;           // Bottom levels under the durations
+    std::vector<char> critical;         // Pushed with push_rotated by the dynamic scheduler
+    double work_ns;
+    double critical_path_ns;
+
+    std::unique_ptr<SimReadyQueue> makeQueue(SimPolicy policy, int workers, unsigned seed) const {
+        switch (policy) {
+            case SimPolicy::Fifo: return std::unique_ptr<SimReadyQueue>(new SimFifoQueue(false));
+            case SimPolicy::Rotation: return std::unique_ptr<SimReadyQueue>(new SimFifoQueue(true));
+            case SimPolicy::CriticalPath: return std::unique_ptr<SimReadyQueue>(new SimPriorityQueue(rank));
+            case SimPolicy::WorkStealing: return std::unique_ptr<SimReadyQueue>(new SimStealingQueues(workers, seed));
+        }
+        throw std::invalid_argument("SchedulerSimulator: unknown policy");
+    }
+
+public:
+    SchedulerSimulator(const TaskGraph& graph, const SimCostModel& model) : graph(graph), model(model) {
+        duration.resize(graph.size());
+        critical.resize(graph.size());
+        int bda = graph.getBeta() / graph.getAlpha();
+        for (size_t id = 0; id < graph.size(); ++id) {
+            const TaskNode& t = graph.node(id);
+            duration[id] = model.duration(t);
+            // Panels, and the updates directly below the previous panel (enq_nxt_t1).
+            critical[id] = t.type == 1 || ((t.i - 1) * bda <= t.j && t.j < t.i * bda);
+        }
+        work_ns = std::accumulate(duration.begin(), duration.end(), 0.0);
+        rank = graph.bottomLevels([&](size_t id) { return duration[id]; });
+        critical_path_ns = rank.empty() ? 0.0 : *std::max_element(rank.begin(), rank.end());
+    }
+
+    double workNs() const { return work_ns; }
+    double criticalPathNs() const { return critical_path_ns; }
+
+    // Simulates the run on `workers` workers; seed drives the victim choice of work stealing.
+    SimResult run(SimPolicy policy, int workers, unsigned seed = 1) const {
+        if (workers < 1) {
+            throw std::invalid_argument("SchedulerSimulator: need at least one worker");
+        }
+        std::unique_ptr<SimReadyQueue> ready = makeQueue(policy, workers, seed);
+        SimResult result{policy, workers, 0.0, work_ns, critical_path_ns, 0.0, 0};
+
+        // Events in time order: a task finishing on a worker, or a worker looking for work.
+        // seq keeps simultaneous events in the order they were scheduled.
+        struct Event {
+            double time;
+            uint64_t seq;
+            int worker;
+            size_t task;        // NONE: the worker looks for work
+            bool operator>(const Event& other) const {
+                return time != other.time ? time > other.time : seq > other.seq;
+            }
+        };
+        const size_t NONE = std::numeric_limits<size_t>::max();
+        std::priority_queue<Event, std::vector<Event>, std::greater<Event>> events;
+        uint64_t seq = 0;
+
+        double lock_free = 0.0;         // When the shared queue's lock is next available
+        auto queue_op = [&](double t, bool steal) {
+            double cost = steal ? model.steal_ns : model.queue_ns;
+            double end = ready->shared() ? std::max(t, lock_free) + cost : t + cost;
+            if (ready->shared()) {
+                lock_free = end;
+            }
+            result.queue_ns += end - t;
+            return end;
+        };
+
+        std::vector<size_t> pending(graph.size());
+        std::vector<int> idle;
+        for (size_t id = 0; id < graph.size(); ++id) {
+            pending[id] = graph.predecessorCount(id);
+            if (pending[id] == 0) {
+                ready->push(id, -1, critical[id]);
+            }
+        }
+        for (int w = 0; w < workers; ++w) {
+            events.push({0.0, seq++, w, NONE});
+        }
+
+        size_t done = 0;
+        while (!events.empty()) {
+            Event e = events.top();
+            events.pop();
+            double t = e.time;
+            if (e.task != NONE) {
+                result.makespan_ns = std::max(result.makespan_ns, t);
+                done++;
+                graph.forEachSuccessor(e.task, [&](size_t next) {
+                    if (--pending[next] == 0) {
+                        t = queue_op(t, false);
+                        ready->push(next, e.worker, critical[next]);
+                        if (!idle.empty()) {
+                            events.push({t, seq++, idle.back(), NONE});
+                            idle.pop_back();
+                        }
+                    }
+                });
+                events.push({t, seq++, e.worker, NONE});
+                continue;
+            }
+
+            size_t id;
+            bool stolen;
+            if (ready->pop(e.worker, id, stolen)) {
+                result.steals += stolen;
+                double start = queue_op(t, stolen);
+                events.push({start + duration[id], seq++, e.worker, id});
+            } else {
+                idle.push_back(e.worker);
+            }
+        }
+        if (done != graph.size()) {
+            throw std::logic_error("SchedulerSimulator: not every task ran");
+        }
+        return result;
+    }
+};
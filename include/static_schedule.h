@@ -0,0 +1,213 @@
+#pragma once
+
+#include <filesystem>
+
+#include "task_graph.h"
+
+// Precomputed schedule of a TaskGraph: one ordered task list per worker thread.
+// build() runs critical-path list scheduling (HEFT on identical workers): tasks are
+// taken by decreasing bottom level (cost of the longest path to the exit) and each
+// is placed on the worker where it can finish earliest. Every worker's list follows
+// one global topological order, so executing the lists while waiting on per-task
+// ready flags cannot deadlock.
+class StaticSchedule {
+    int num_threads;                                 // Number of worker lists
+    std::vector<std::vector<size_t>> thread_tasks;   // Task ids per worker, in execution order
+    double makespan;                                 // Predicted makespan in cost units
+
+public:
+    StaticSchedule() : num_threads(0), makespan(0.0) {}
+
+    // Builds the schedule for the given number of workers.
+    void build(const TaskGraph& graph, int num_threads) {
+        this->num_threads = num_threads;
+        thread_tasks.assign(num_threads, {});
+
+        auto cost = [&](size_t id) { return graph.node(id).cost; };
+        std::vector<double> rank = graph.bottomLevels(cost);
+
+        // Decreasing rank; ties keep the topological order so zero-cost chains stay valid.
+        const std::vector<size_t>& topo = graph.topologicalOrder();
+        std::vector<size_t> position(graph.size());
+        for (size_t k = 0; k < topo.size(); ++k) {
+            position[topo[k]] = k;
+        }
+        std::vector<size_t> order(topo);
+        std::sort(order.begin(), order.end(), [&](size_t a, size_t b) {
+            return rank[a] != rank[b] ? rank[a] > rank[b] : position[a] < position[b];
+        });
+
+        std::vector<double> finish(graph.size(), 0.0);
+        std::vector<double> available(num_threads, 0.0);
+        makespan = 0.0;
+
+        for (size_t id : order) {
+            double ready = 0.0;
+            graph.forEachPredecessor(id, [&](size_t pred) { ready = std::max(ready, finish[pred]); });
+
+            int best = 0;
+            for (int p = 1; p < num_threads; ++p) {
+                if (std::max(available[p], ready) < std::max(available[best], ready)) {
+                    best = p;
+                }
+            }
+
+            finish[id] = std::max(available[best], ready) + cost(id);
+            available[best] = finish[id];
+            makespan = std::max(makespan, finish[id]);
+            thread_tasks[best].push_back(id);
+        }
+    }
+
+    // Takes given worker lists, e.g. the order of a recorded run, instead of building them.
+    // Throws if they do not cover the graph or their orders would deadlock.
+    void assign(const TaskGraph& graph, std::vector<std::vector<size_t>> lists) {
+        num_threads = static_cast<int>(lists.size());
+        thread_tasks = std::move(lists);
+        makespan = simulate(graph);
+    }
+
+    // Replays the worker lists with the graph's cost model and returns the predicted
+    // makespan. Throws if the lists cannot be executed (missing tasks or an order
+    // that would deadlock).
+    double simulate(const TaskGraph& graph) const {
+        std::vector<double> finish(graph.size(), -1.0);
+        std::vector<double> available(num_threads, 0.0);
+        std::vector<size_t> next(num_threads, 0);
+        size_t done = 0;
+        double end = 0.0;
+
+        bool progress = true;
+        while (progress) {
+            progress = false;
+            for (int p = 0; p < num_threads; ++p) {
+                while (next[p] < thread_tasks[p].size()) {
+                    size_t id = thread_tasks[p][next[p]];
+                    double ready = 0.0;
+                    bool runnable = true;
+                    graph.forEachPredecessor(id, [&](size_t pred) {
+                        if (finish[pred] < 0.0) runnable = false;
+                        else ready = std::max(ready, finish[pred]);
+                    });
+                    if (!runnable) {
+                        break;
+                    }
+                    finish[id] = std::max(available[p], ready) + graph.node(id).cost;
+                    available[p] = finish[id];
+                    end = std::max(end, finish[id]);
+                    ++next[p];
+                    ++done;
+                    progress = true;
+                }
+            }
+        }
+        if (done != graph.size()) {
+            throw std::runtime_error("StaticSchedule: worker lists do not cover the task graph");
+        }
+        return end;
+    }
+
+    // Writes the schedule as text: a header identifying the shape, then one line per
+    // worker holding its task count followed by the task ids.
+    void save(const std::string& filename, const TaskGraph& graph) const {
+        std::ofstream outfile(filename);
+        if (!outfile.is_open()) {
+            throw std::runtime_error("Error opening file for writing: " + filename);
+        }
+        outfile << "static_schedule 1\n"
+                << graph.matrixRows() << " " << graph.matrixCols() << " "
+                << graph.getAlpha() << " " << graph.getBeta() << " "
+                << num_threads << " " << graph.size() << "\n";
+        for (const auto& tasks : thread_tasks) {
+            outfile << tasks.size();
+            for (size_t id : tasks) {
+                outfile << " " << id;
+            }
+            outfile << "\n";
+        }
+        if (outfile.fail()) {
+            throw std::runtime_error("Error writing schedule to file: " + filename);
+        }
+    }
+
+    // Reads a schedule written by save(). Returns false if the file does not exist or
+    // was made for a different shape; throws if it is corrupt.
+    bool load(const std::string& filename, const TaskGraph& graph, int num_threads) {
+        std::ifstream infile(filename);
+        if (!infile.is_open()) {
+            return false;
+        }
+
+        std::string magic;
+        int version = 0, rows = 0, cols = 0, alpha = 0, beta = 0, threads = 0;
+        size_t tasks = 0;
+        if (!(infile >> magic >> version >> rows >> cols >> alpha >> beta >> threads >> tasks)
+            || magic != "static_schedule" || version != 1) {
+            throw std::runtime_error("Error: " + filename + " is not a static schedule.");
+        }
+        if (rows != graph.matrixRows() || cols != graph.matrixCols() || alpha != graph.getAlpha()
+            || beta != graph.getBeta() || threads != num_threads || tasks != graph.size()) {
+            return false;
+        }
+
+        std::vector<std::vector<size_t>> lists(num_threads);
+        std::vector<bool> seen(graph.size(), false);
+        for (auto& list : lists) {
+            size_t count = 0;
+            if (!(infile >> count)) {
+                throw std::runtime_error("Error reading schedule file: " + filename);
+            }
+            list.resize(count);
+            for (size_t& id : list) {
+                if (!(infile >> id) || id >= graph.size() || seen[id]) {
+                    throw std::runtime_error("Error reading schedule file: " + filename);
+                }
+                seen[id] = true;
+            }
+        }
+
+        this->num_threads = num_threads;
+        thread_tasks = std::move(lists);
+        makespan = simulate(graph);
+        return true;
+    }
+
+    // Cache file for a shape: <dir>/plan_r<rows>_c<cols>_a<alpha>_b<beta>_t<threads>.txt
+    static std::string cacheFileName(const std::string& dir, const TaskGraph& graph, int num_threads) {
+        return dir + "/plan_r" + std::to_string(graph.matrixRows()) + "_c" + std::to_string(graph.matrixCols())
+             + "_a" + std::to_string(graph.getAlpha()) + "_b" + std::to_string(graph.getBeta())
+             + "_t" + std::to_string(num_threads) + ".txt";
+    }
+
+    // Loads the cached schedule for this shape, or builds it and stores it in the cache.
+    // A corrupt cache file is rebuilt and a cache that cannot be written is skipped, with a
+    // warning to warnings. Returns true if the schedule came from the cache.
+    bool loadOrBuild(const std::string& cache_dir, const TaskGraph& graph, int num_threads, std::ostream& warnings) {
+        std::string filename = cacheFileName(cache_dir, graph, num_threads);
+        try {
+            if (load(filename, graph, num_threads)) {
+                return true;
+            }
+        } catch (const std::exception& e) {
+            warnings << "Warning: " << e.what() << " (rebuilding the schedule)" << std::endl;
+        }
+        build(graph, num_threads);
+        try {
+            std::filesystem::create_directories(cache_dir);
+            save(filename, graph);
+        } catch (const std::exception& e) {
+            warnings << "Warning: " << e.what() << " (the schedule is not cached)" << std::endl;
+        }
+        return false;
+    }
+
+    // Ordered task ids of worker tid.
+    const std::vector<size_t>& threadTasks(int tid) const {
+        return thread_tasks[tid];
+    }
+
+    int threads() const { return num_threads; }
+
+    // Predicted makespan in cost units (flops of the slowest worker, including waits).
+    double predictedMakespan() const { return makespan; }
+};
@@ -0,0 +1,226 @@
+#pragma once
+
+#include "bn2.h"
+
+// One task of the factorization DAG.
+struct TaskNode {
+    int i;                  // Task row (target block).
+    int j;                  // Task column (pivot block).
+    unsigned char type;     // 1 = panel factorization, 2 = update.
+    int row_start;          // Pivot rows [row_start, row_end).
+    int row_end;
+    int col_start;          // Target rows [col_start, col_end).
+    int col_end;
+    double cost;            // Estimated flops.
+};
+
+// Explicit form of the task DAG described by a TaskTable.
+// Tasks get dense ids in row-major order over the non-empty cells, and edges follow
+// the release rules of the dynamic scheduler: an update (k, j) waits for the panel
+// of column j and for (k, j-1); a panel (i, j) waits for (i, j-1) and for the update
+// directly below the previous panel that releases it.
+class TaskGraph {
+    int m;                              // Number of task rows
+    int n;                              // Number of task columns
+    int alpha;                          // Rows per pivot block
+    int beta;                           // Rows per target block
+    int beta_div_alpha;
+    int mat_rows;                       // Matrix dimensions the graph was built for
+    int mat_cols;
+    std::vector<size_t> row_offset;     // Id of task (i, 0); row_offset[m] == size()
+    std::vector<TaskNode> nodes;        // Nodes indexed by id
+    std::vector<size_t> succ_offset;    // CSR successor lists
+    std::vector<size_t> succ;
+    std::vector<size_t> topo_order;     // Ids in a topological order
+
+public:
+    TaskGraph() : m(0), n(0), alpha(0), beta(0), beta_div_alpha(0), mat_rows(0), mat_cols(0) {}
+
+    TaskGraph(const TaskTable& table, int mat_cols) : TaskGraph() {
+        build(table, mat_cols);
+    }
+
+    // Estimated flops of a task; the inner loops of both kernels touch (mat_cols - lpivot)
+    // elements twice per (pivot, target) pair.
+    static double estimateFlops(unsigned char type, int row_start, int row_end,
+                                int col_start, int col_end, int mat_cols) {
+        int _row_start = row_start == 1 ? 0 : row_start;
+        int _col_start = col_start == 1 ? 0 : col_start;
+        double flops = 0.0;
+        for (int lpivot = _row_start; lpivot < row_end; ++lpivot) {
+            double len = std::max(mat_cols - lpivot, 0);
+            int targets = type == 1 ? std::max(col_end - lpivot - 1, 0) : std::max(col_end - _col_start, 0);
+            flops += 4.0 * len * targets + (type == 1 ? 3.0 * len : 0.0);
+        }
+        return flops;
+    }
+
+    // Builds the graph for the given table and matrix width.
+    void build(const TaskTable& table, int mat_cols) {
+        m = table.rows();
+        n = table.cols();
+        alpha = table.getAlpha();
+        beta = table.getBeta();
+        beta_div_alpha = beta / alpha;
+        mat_rows = table.matrixRows();
+        this->mat_cols = mat_cols;
+
+        row_offset.assign(m + 1, 0);
+        for (int i = 0; i < m; ++i) {
+            row_offset[i + 1] = row_offset[i] + std::min((i+1) * beta_div_alpha, n);
+        }
+
+        nodes.clear();
+        nodes.reserve(row_offset[m]);
+        for (int i = 0; i < m; ++i) {
+            for (int j = 0; j < std::min((i+1) * beta_div_alpha, n); ++j) {
+                Task* t = table.makeTask(i, j);
+                TaskNode node;
+                node.i = i;
+                node.j = j;
+                node.type = t->type;
+                node.row_start = t->row_start;
+                node.row_end = t->row_end;
+                node.col_start = t->col_start;
+                node.col_end = t->col_end;
+                node.cost = estimateFlops(t->type, node.row_start, node.row_end,
+                                          node.col_start, node.col_end, mat_cols);
+                nodes.push_back(node);
+                delete t;
+            }
+        }
+
+        // Successor lists in CSR form.
+        succ_offset.assign(nodes.size() + 1, 0);
+        for (size_t id = 0; id < nodes.size(); ++id) {
+            forEachPredecessor(id, [&](size_t pred) { ++succ_offset[pred + 1]; });
+        }
+        for (size_t id = 0; id < nodes.size(); ++id) {
+            succ_offset[id + 1] += succ_offset[id];
+        }
+        succ.assign(succ_offset.back(), 0);
+        std::vector<size_t> fill(succ_offset.begin(), succ_offset.end() - 1);
+        for (size_t id = 0; id < nodes.size(); ++id) {
+            forEachPredecessor(id, [&](size_t pred) { succ[fill[pred]++] = id; });
+        }
+
+        // Topological order (Kahn). Ids alone are not one: with BETA > ALPHA a panel
+        // depends on the update in the task row below it.
+        std::vector<size_t> pending(nodes.size());
+        topo_order.clear();
+        topo_order.reserve(nodes.size());
+        for (size_t id = 0; id < nodes.size(); ++id) {
+            pending[id] = predecessorCount(id);
+            if (pending[id] == 0) {
+                topo_order.push_back(id);
+            }
+        }
+        for (size_t k = 0; k < topo_order.size(); ++k) {
+            forEachSuccessor(topo_order[k], [&](size_t next) {
+                if (--pending[next] == 0) {
+                    topo_order.push_back(next);
+                }
+            });
+        }
+        if (topo_order.size() != nodes.size()) {
+            throw std::logic_error("TaskGraph: task dependencies contain a cycle");
+        }
+    }
+
+    // Number of tasks.
+    size_t size() const { return nodes.size(); }
+
+    // Returns true if (i, j) is a task of the graph.
+    bool contains(int i, int j) const {
+        return i >= 0 && i < m && j >= 0 && j < std::min((i+1) * beta_div_alpha, n);
+    }
+
+    // Id of task (i, j), which must exist.
+    inline size_t id(int i, int j) const {
+        return row_offset[i] + j;
+    }
+
+    inline const TaskNode& node(size_t id) const {
+        return nodes[id];
+    }
+
+    // Calls f(pred_id) for every direct predecessor of task id.
+    template <class F>
+    void forEachPredecessor(size_t id, F f) const {
+        const TaskNode& t = nodes[id];
+        if (t.j > 0) {
+            f(this->id(t.i, t.j - 1));
+        }
+        if (t.type == 2) {
+            int panel_row = t.j / beta_div_alpha;
+            f(this->id(panel_row, t.j));
+        } else if (t.j > 0) {
+            int release_row = (t.j - 1) / beta_div_alpha + 1;
+            if (release_row != t.i && release_row < m) {
+                f(this->id(release_row, t.j - 1));
+            }
+        }
+    }
+
+    // Calls f(succ_id) for every direct successor of task id.
+    template <class F>
+    void forEachSuccessor(size_t id, F f) const {
+        for (size_t k = succ_offset[id]; k < succ_offset[id + 1]; ++k) {
+            f(succ[k]);
+        }
+    }
+
+    // Number of direct predecessors of task id.
+    size_t predecessorCount(size_t id) const {
+        size_t count = 0;
+        forEachPredecessor(id, [&](size_t) { ++count; });
+        return count;
+    }
+
+    // Sum of all task costs.
+    double totalCost() const {
+        double total = 0.0;
+        for (const TaskNode& t : nodes) {
+            total += t.cost;
+        }
+        return total;
+    }
+
+    // Task ids in a topological order.
+    const std::vector<size_t>& topologicalOrder() const {
+        return topo_order;
+    }
+
+    // Length of the longest cost-weighted path ending at each task (inclusive).
+    template <class CostFn>
+    std::vector<double> topLevels(CostFn cost) const {
+        std::vector<double> level(nodes.size(), 0.0);
+        for (size_t id : topo_order) {
+            double start = 0.0;
+            forEachPredecessor(id, [&](size_t pred) { start = std::max(start, level[pred]); });
+            level[id] = start + cost(id);
+        }
+        return level;
+    }
+
+    // Length of the longest cost-weighted path starting at each task (inclusive).
+    template <class CostFn>
+    std::vector<double> bottomLevels(CostFn cost) const {
+        std::vector<double> level(nodes.size(), 0.0);
+        for (auto it = topo_order.rbegin(); it != topo_order.rend(); ++it) {
+            size_t id = *it;
+            double tail = 0.0;
+            forEachSuccessor(id, [&](size_t next) { tail = std::max(tail, level[next]); });
+            level[id] = tail + cost(id);
+        }
+        return level;
+    }
+
+    // Shape the graph was built for.
+    int rows() const { return m; }
+    int cols() const { return n; }
+    int getAlpha() const { return alpha; }
+    int getBeta() const { return beta; }
+    int matrixRows() const { return mat_rows; }
+    int matrixCols() const { return mat_cols; }
+};
@@ -0,0 +1,165 @@
+#pragma once
+
+#include <iomanip>
+
+#include "bn2.h"
+
+#if defined(__x86_64__) || defined(__i386__)
+    #include <x86intrin.h>
+#endif
+
+// Raw trace timestamp: the TSC where available (a few cycles, no system call),
+// steady_clock nanoseconds elsewhere. TraceClock converts ticks to microseconds.
+inline uint64_t trace_ticks() {
+#if defined(__x86_64__) || defined(__i386__)
+    return __rdtsc();
+#else
+    return static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::steady_clock::now().time_since_epoch()).count());
+#endif
+}
+
+// Maps trace ticks to microseconds since start(), calibrated against steady_clock
+// over the interval between start() and stop().
+class TraceClock {
+    uint64_t tick0;
+    uint64_t tick1;
+    std::chrono::steady_clock::time_point time0;
+    std::chrono::steady_clock::time_point time1;
+    double us_per_tick;
+
+public:
+    TraceClock() : tick0(0), tick1(0), us_per_tick(0.0) {}
+
+    void start() {
+        time0 = std::chrono::steady_clock::now();
+        tick0 = trace_ticks();
+    }
+
+    void stop() {
+        time1 = std::chrono::steady_clock::now();
+        tick1 = trace_ticks();
+        double us = std::chrono::duration<double, std::micro>(time1 - time0).count();
+        us_per_tick = tick1 > tick0 ? us / static_cast<double>(tick1 - tick0) : 0.0;
+    }
+
+    uint64_t startTicks() const { return tick0; }
+
+    double toMicros(uint64_t ticks) const {
+        return ticks > tick0 ? static_cast<double>(ticks - tick0) * us_per_tick : 0.0;
+    }
+
+    // Length of an interval of the given number of ticks.
+    double durationMicros(uint64_t ticks) const { return static_cast<double>(ticks) * us_per_tick; }
+};
+
+// One traced unit of work.
+struct TraceEvent {
+    enum Kind : unsigned char { Panel = 1, Update = 2, TileLoad = 3, TileStore = 4 };
+
+    uint64_t ready;         // Ticks when it became runnable
+    uint64_t start;         // Ticks when it started running
+    uint64_t end;           // Ticks when it finished
+    int i;                  // Tasks: chunk_idx_i. Tile transfers: tile.
+    int j;                  // Tasks: chunk_idx_j. Tile transfers: buffer slot.
+    int released_by;        // Thread that made it runnable, -1 for the main thread
+    unsigned char kind;     // Kind
+};
+
+// Append-only event buffer of one thread. Only the owner records into it, so an event
+// is a store into memory reserved up front; it grows if the reservation runs out.
+class alignas(64) TraceBuffer {
+    std::vector<TraceEvent> events;
+
+public:
+    void reserve(size_t n) { events.reserve(n); }
+
+    inline void record(const TraceEvent& event) { events.push_back(event); }
+
+    const std::vector<TraceEvent>& all() const { return events; }
+};
+
+// Per-thread trace buffers of a run, exported as Chrome trace-event JSON (chrome://tracing,
+// ui.perfetto.dev). Every event becomes a complete ("X") slice on its thread's track with
+// the queue wait and the releasing thread as arguments.
+class Tracer {
+    std::vector<TraceBuffer> buffers;
+    TraceClock clock;
+
+    static const char* kindName(unsigned char kind) {
+        switch (kind) {
+            case TraceEvent::Panel: return "panel";
+            case TraceEvent::Update: return "update";
+            case TraceEvent::TileLoad: return "load";
+            case TraceEvent::TileStore: return "store";
+            default: return "task";
+        }
+    }
+
+public:
+    // Prepares one buffer per thread with room for events_per_thread events.
+    void init(int threads, size_t events_per_thread) {
+        buffers = std::vector<TraceBuffer>(threads);
+        for (auto& buffer : buffers) {
+            buffer.reserve(events_per_thread);
+        }
+    }
+
+    // Brackets the traced run; timestamps are reported relative to start().
+    void start() { clock.start(); }
+    void stop() { clock.stop(); }
+
+    // Ticks at start(), used as the ready time of work that was runnable from the beginning.
+    uint64_t startTicks() const { return clock.startTicks(); }
+
+    inline TraceBuffer& buffer(int tid) { return buffers[tid]; }
+
+    size_t eventCount() const {
+        size_t count = 0;
+        for (const auto& buffer : buffers) {
+            count += buffer.all().size();
+        }
+        return count;
+    }
+
+    // Writes the events to filename. thread_names labels the tracks (buffer index order);
+    // missing names default to "thread <tid>".
+    void writeChromeJson(const std::string& filename, const std::vector<std::string>& thread_names = {}) const {
+        std::ofstream out(filename, std::ios::trunc);
+        if (!out.is_open()) {
+            throw std::runtime_error("Error opening file for writing: " + filename);
+        }
+        out << std::fixed << std::setprecision(3);
+        out << "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[\n";
+        bool first = true;
+        auto separator = [&]() -> std::ostream& {
+            if (!first) {
+                out << ",\n";
+            }
+            first = false;
+            return out;
+        };
+        for (size_t tid = 0; tid < buffers.size(); ++tid) {
+            std::string name = tid < thread_names.size() ? thread_names[tid] : "thread " + std::to_string(tid);
+            separator() << "{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":0,\"tid\":" << tid
+                        << ",\"args\":{\"name\":\"" << name << "\"}}";
+        }
+        for (size_t tid = 0; tid < buffers.size(); ++tid) {
+            for (const TraceEvent& e : buffers[tid].all()) {
+                double start = clock.toMicros(e.start);
+                double end = clock.toMicros(e.end);
+                double ready = clock.toMicros(e.ready);
+                separator() << "{\"name\":\"" << kindName(e.kind) << " (" << e.i << "," << e.j << ")\""
+                            << ",\"cat\":\"" << kindName(e.kind) << "\",\"ph\":\"X\",\"pid\":0,\"tid\":" << tid
+                            << ",\"ts\":" << start << ",\"dur\":" << std::max(end - start, 0.0)
+                            << ",\"args\":{\"i\":" << e.i << ",\"j\":" << e.j
+                            << ",\"queue_wait_us\":" << std::max(start - ready, 0.0)
+                            << ",\"released_by\":" << e.released_by << "}}";
+            }
+        }
+        out << "\n]}\n";
+        if (out.fail()) {
+            throw std::runtime_error("Error writing trace to file: " + filename);
+        }
+    }
+};
@@ -0,0 +1,199 @@
+#pragma once
+
+#include <stdexcept>
+
+#include "kernels.h"
+
+// One task of a FactorizationCheck.
+struct VerifyNode {
+    enum Kind : unsigned char { Residual, FormQ, Gram };
+
+    Kind kind;
+    int i;      // Row block; Gram: first block of the tile
+    int j;      // Gram: second block, j <= i
+};
+
+// Backward error ||A - QR||_F / ||A||_F and orthogonality loss ||Q^T Q - I||_F of a finished
+// factorization, computed from what the run leaves behind: R in the lower triangle of the
+// stored matrix, the reflector tails above it, and global_up_array / global_b_array. Both
+// matrices are stored transposed (row r is column r of A) and must have no more rows m than
+// columns n; Q is the thin n x m factor. The work is split into blocks of block_rows rows,
+// the task rows of the factorization:
+//   Residual(i)  rebuilds the columns of QR in block i from R and subtracts those of A,
+//   FormQ(i)     forms the columns of Q in block i by applying the reflectors to I,
+//   Gram(i, j)   adds up block (i, j) of Q^T Q - I once FormQ(i) and FormQ(j) are done.
+// Given a Q formed already (by QFormation), the check reads it and has no FormQ tasks.
+// Every task writes its own partial sums, added in id order at the end, so the results do
+// not depend on the schedule. Ids are a topological order.
+class FactorizationCheck {
+    matrix_view_t<const double> factored;
+    matrix_view_t<const double> original;
+    int block_rows;
+    int blocks;
+    size_t gram_base;                   // Id of Gram(0, 0)
+    matrix_t<double> q;                 // Row c: column c of Q, unless given one
+    matrix_view_t<const double> columns;    // Row c: column c of Q, as the Gram tasks read it
+    std::vector<VerifyNode> nodes;
+    std::vector<double> error_sq;       // Per node: squared norm of its part of A - QR or Q^T Q - I
+    std::vector<double> norm_sq;        // Residual nodes: squared norm of their part of A
+
+    int blockBegin(int i) const { return i * block_rows; }
+    int blockEnd(int i) const { return std::min((i + 1) * block_rows, factored.rows()); }
+    size_t gramId(int i, int j) const { return gram_base + (size_t)i * (i + 1) / 2 + j; }
+
+    void residual(size_t id, int i) {
+        int begin = blockBegin(i), end = blockEnd(i), n = factored.cols();
+        thread_local std::vector<double> buffer;
+        buffer.assign((size_t)(end - begin) * n, 0.0);
+        matrix_view_t<double> qr(buffer.data(), end - begin, n, n);
+        for (int r = begin; r < end; ++r) {
+            std::copy(factored.row(r), factored.row(r) + r + 1, qr.row(r - begin));
+        }
+        apply_reflectors_backward(factored, qr, n, 0, end, begin, end);
+
+        double error = 0.0, norm = 0.0;
+        for (int r = begin; r < end; ++r) {
+            const double* a = original.row(r);
+            const double* x = qr.row(r - begin);
+            for (int k = 0; k < n; ++k) {
+                error += (a[k] - x[k]) * (a[k] - x[k]);
+                norm += a[k] * a[k];
+            }
+        }
+        error_sq[id] = error;
+        norm_sq[id] = norm;
+    }
+
+    void formQ(int i) {
+        int begin = blockBegin(i), end = blockEnd(i), n = factored.cols();
+        matrix_view_t<double> block = q.block(begin, 0, end - begin, n);
+        identity_columns(block, n, begin, end);
+        apply_reflectors_backward(factored, block, n, 0, end, begin, end);
+    }
+
+    void gram(size_t id, int i, int j) {
+        int n = factored.cols();
+        double error = 0.0;
+        for (int c1 = blockBegin(i); c1 < blockEnd(i); ++c1) {
+            const double* x = columns.row(c1);
+            int last = i == j ? c1 + 1 : blockEnd(j);
+            for (int c2 = blockBegin(j); c2 < last; ++c2) {
+                const double* y = columns.row(c2);
+                double dot = 0.0;
+                for (int k = 0; k < n; ++k) {
+                    dot += x[k] * y[k];
+                }
+                double d = c1 == c2 ? dot - 1.0 : dot;
+                error += (c1 == c2 ? 1.0 : 2.0) * d * d;     // (c1, c2) and (c2, c1)
+            }
+        }
+        error_sq[id] = error;
+    }
+
+public:
+    FactorizationCheck() : block_rows(0), blocks(0), gram_base(0) {}
+
+    // Prepares the tasks; q is allocated with the given storage unless formed_q holds Q
+    // already, stored the same way (thin or full: its first rows are used). Throws
+    // std::invalid_argument if the shapes differ or the matrix has more rows than columns.
+    void init(matrix_view_t<const double> factored, matrix_view_t<const double> original, int block_rows,
+              const MatrixStorage& storage = MatrixStorage(), const matrix_t<double>* formed_q = nullptr) {
+        if (factored.rows() != original.rows() || factored.cols() != original.cols()) {
+            throw std::invalid_argument("FactorizationCheck: the copy of A has a different shape");
+        }
+        if (factored.rows() > factored.cols() || block_rows < 1) {
+            throw std::invalid_argument("FactorizationCheck: needs at most as many rows as columns");
+        }
+        this->factored = factored;
+        this->original = original;
+        this->block_rows = block_rows;
+        if (formed_q != nullptr && (formed_q->rows() < factored.rows() || formed_q->cols() != factored.cols())) {
+            throw std::invalid_argument("FactorizationCheck: the formed Q has a different shape");
+        }
+        blocks = (factored.rows() + block_rows - 1) / block_rows;
+        if (formed_q != nullptr) {
+            q = matrix_t<double>();
+            columns = formed_q->view();
+        } else {
+            q = matrix_t<double>(factored.rows(), factored.cols(), storage);
+            columns = q.view();
+        }
+
+        nodes.clear();
+        for (int i = 0; i < blocks; ++i) {
+            nodes.push_back({VerifyNode::Residual, i, 0});
+        }
+        for (int i = 0; formed_q == nullptr && i < blocks; ++i) {
+            nodes.push_back({VerifyNode::FormQ, i, 0});
+        }
+        gram_base = nodes.size();
+        for (int i = 0; i < blocks; ++i) {
+            for (int j = 0; j <= i; ++j) {
+                nodes.push_back({VerifyNode::Gram, i, j});
+            }
+        }
+        error_sq.assign(nodes.size(), 0.0);
+        norm_sq.assign(nodes.size(), 0.0);
+    }
+
+    size_t size() const { return nodes.size(); }
+
+    inline const VerifyNode& node(size_t id) const { return nodes[id]; }
+
+    size_t predecessorCount(size_t id) const {
+        const VerifyNode& t = nodes[id];
+        bool formed = gram_base == (size_t)blocks;     // No FormQ tasks: Q was given
+        return t.kind != VerifyNode::Gram || formed ? 0 : t.i == t.j ? 1 : 2;
+    }
+
+    // Calls f(succ_id) for every direct successor of task id.
+    template <class F>
+    void forEachSuccessor(size_t id, F f) const {
+        const VerifyNode& t = nodes[id];
+        if (t.kind != VerifyNode::FormQ) {
+            return;
+        }
+        for (int j = 0; j <= t.i; ++j) {
+            f(gramId(t.i, j));
+        }
+        for (int i = t.i + 1; i < blocks; ++i) {
+            f(gramId(i, t.i));
+        }
+    }
+
+    // Runs task id. Tasks may run concurrently once their predecessors have finished.
+    void run(size_t id) {
+        const VerifyNode& t = nodes[id];
+        switch (t.kind) {
+            case VerifyNode::Residual: residual(id, t.i); break;
+            case VerifyNode::FormQ: formQ(t.i); break;
+            case VerifyNode::Gram: gram(id, t.i, t.j); break;
+        }
+    }
+
+    // ||A - QR||_F / ||A||_F (the absolute error for a zero A), after every task has run.
+    double backwardError() const {
+        double error = 0.0, norm = 0.0;
+        for (size_t id = 0; id < nodes.size(); ++id) {
+            if (nodes[id].kind == VerifyNode::Residual) {
+                error += error_sq[id];
+                norm += norm_sq[id];
+            }
+        }
+        return norm > 0 ? std::sqrt(error / norm) : std::sqrt(error);
+    }
+
+    // ||Q^T Q - I||_F, after every task has run.
+    double orthogonalityLoss() const {
+        double error = 0.0;
+        for (size_t id = 0; id < nodes.size(); ++id) {
+            if (nodes[id].kind == VerifyNode::Gram) {
+                error += error_sq[id];
+            }
+        }
+        return std::sqrt(error);
+    }
+
+    // The explicit thin Q, column c in row c, once the FormQ tasks have run.
+    matrix_view_t<const double> thinQ() const { return columns.block(0, 0, factored.rows(), factored.cols()); }
+};
@@ -4,11 +4,27 @@
 #include <cmath>
 #include <pthread.h>
 #include "bn2.h"
+#include "static_schedule.h"
+#include "out_of_core.h"
+#include "checkpoint.h"
+#include "trace.h"
+#include "kernels.h"
+#include "perf_counters.h"
+#include "run_analysis.h"
+#include "live_metrics.h"
+#include "schedule_log.h"
+#include "verify.h"
+#include "form_q.h"
 #include <unistd.h>
 #include <csignal>
 #include <cstdlib>
+#include <thread>
+#include <filesystem>
 
-#define NUM_THREADS 28
+// Worker threads. make bench builds main.cpp with other counts through -DNUM_THREADS.
+#ifndef NUM_THREADS
+    #define NUM_THREADS 28
+#endif
 
 #define BETA 10
 #define ALPHA 10
@@ -16,125 +32,461 @@
 
 #define PRIORITIZE_CRITICAL_NODES 0
 
+// Build task descriptors on demand and free them after completion instead of
+// materializing the whole task grid before the run.
+#define LAZY_TASK_GENERATION 0
+
+// Use the relaxed priority MultiQueue for ready tasks instead of the single
+// CircularQueueMtx. Tasks are ordered by their TaskTable priority.
+#define USE_MULTIQUEUE 0
+#define MULTIQUEUE_SHARDS_PER_THREAD 2
+
+// Idle workers spin this many empty iterations before sleeping on the
+// termination detector for IDLE_SLEEP_US microseconds.
+#define IDLE_SPINS_BEFORE_SLEEP 1024
+#define IDLE_SLEEP_US 50
+
+// Execute a precomputed critical-path list schedule (one ordered task list per
+// thread, point-to-point ready flags) instead of the dynamic queues. Plans are
+// cached per matrix shape in STATIC_SCHEDULE_CACHE_DIR.
+#define STATIC_SCHEDULE 0
+#define STATIC_SCHEDULE_CACHE_DIR ".schedule_cache"
+
+// Stream the input on a reader thread while the factorization runs: a task row becomes
+// eligible as soon as the rows of its block have been parsed, instead of after the
+// whole file has been loaded.
+#define PIPELINED_LOAD 0
+
+// Out-of-core run: the matrix stays in a binary file (OOC_WORK_FILE, a copy of the
+// input that ends up holding the result) and BETA-row tiles are paged through
+// OOC_MEMORY_BUDGET_MB of tile buffers by a dedicated I/O thread. OOC_PREFETCH_SLOTS
+// of the buffers stream finished pivot tiles ahead of the updates that need them.
+#define OUT_OF_CORE 0
+#define OOC_MEMORY_BUDGET_MB 1024
+#define OOC_PREFETCH_SLOTS 2
+#define OOC_WORK_FILE "output.bin"
+
+// Stream each block of rows to OUTPUT_FILE from a dedicated I/O thread as soon as the
+// last task of its task row completes, instead of saving the whole matrix at the end.
+#define INCREMENTAL_WRITEBACK 0
+
+// Take a checkpoint every CHECKPOINT_INTERVAL_MS milliseconds (0 disables them) into
+// CHECKPOINT_DIR, alongside the running workers. Only task rows that progressed since
+// the previous checkpoint are written. Run with --resume to continue from the latest one.
+#define CHECKPOINT_INTERVAL_MS 0
+#define CHECKPOINT_DIR ".checkpoint"
+
+// Record every task (and out-of-core tile transfer) with its ready, start and end time and
+// the thread that made it runnable, and write them to TRACE_FILE after the run as Chrome
+// trace-event JSON for chrome://tracing or ui.perfetto.dev. With TRACE 0 the hooks compile
+// to nothing.
+#define TRACE 0
+#define TRACE_FILE "trace.json"
+
+// Count cycles, instructions, LLC misses and dTLB misses of every task with per-thread
+// perf_event counters, report IPC and misses per flop per task type and write the
+// per-task deltas to PERF_FILE. Events the kernel does not permit are skipped.
+#define PERF_COUNTERS 0
+#define PERF_FILE "perf_tasks.csv"
+
+// Time every task and split each worker's time into compute, queue operations,
+// dependency checks and idle spinning. After the run, report the critical path and total
+// work of the task DAG under the measured durations against the makespan, and which
+// bound (critical path, work, scheduler, load imbalance) dominated.
+#define RUN_ANALYSIS 0
+
+// Every METRICS_INTERVAL_MS milliseconds (0 disables it), a sampler thread prints the tasks
+// completed per second by type, the queue depths, busy and idle workers and the estimated
+// percent complete to METRICS_FILE, or stderr if it is empty. kill -USR1 <pid> prints the
+// same with per-worker detail at any time. Workers only update relaxed counters of their own.
+#define METRICS_INTERVAL_MS 0
+#define METRICS_FILE ""
+
+// Log the tasks every worker took from main_queue (or its static list), in order and with
+// their start and end times, to SCHEDULE_FILE. SCHEDULE_REPLAY reruns the worker orders of
+// the log in SCHEDULE_REPLAY_FILE instead of scheduling dynamically: each worker executes
+// its recorded tasks in the recorded order, waiting for their dependencies as under
+// STATIC_SCHEDULE. Compare two logs task by task with ./schedcmp.out.
+#define SCHEDULE_RECORD 0
+#define SCHEDULE_FILE "schedule.log"
+#define SCHEDULE_REPLAY 0
+#define SCHEDULE_REPLAY_FILE "schedule.log"
+
+// Run with --verify to check the result after the run: the backward error ||A - QR||_F / ||A||_F
+// and the orthogonality loss ||Q^T Q - I||_F, computed from the stored reflectors by row-block
+// tasks on NUM_THREADS workers and timed separately. A copy of A is written to
+// VERIFY_COPY_FILE in the binary format before the run (with PIPELINED_LOAD, row by row as
+// the rows stream in); the run fails if either measure exceeds VERIFY_TOLERANCE.
+#define VERIFY_COPY_FILE "verify_input.bin"
+#define VERIFY_TOLERANCE 1e-10
+
+// Form Q explicitly after the run from the stored reflectors, as LAPACK's orgqr does: 1 for
+// the thin Q (one column per row of the stored matrix), 2 for the full square Q, 0 for none.
+// Each task applies ALPHA reflectors to BETA columns of Q, tiled like the factorization, and
+// the tasks run on NUM_THREADS workers. Q is written to Q_OUTPUT_FILE in the OUTPUT_BINARY
+// format, stored like the result: row c holds column c of Q.
+#define FORM_Q 0
+#define Q_OUTPUT_FILE "q.txt"
+
+#if FORM_Q < 0 || FORM_Q > 2
+    #error "FORM_Q is 0 (off), 1 (thin Q) or 2 (full Q)"
+#endif
+
+#if CHECKPOINT_INTERVAL_MS && (STATIC_SCHEDULE || OUT_OF_CORE || PIPELINED_LOAD || SCHEDULE_REPLAY)
+    #error "Checkpoints are only supported with the dynamic in-core scheduler"
+#endif
+
+#if (SCHEDULE_RECORD || SCHEDULE_REPLAY) && OUT_OF_CORE
+    #error "Schedule logs cover in-core runs only"
+#endif
+#if SCHEDULE_REPLAY && STATIC_SCHEDULE
+    #error "SCHEDULE_REPLAY replaces the static schedule with the recorded one"
+#endif
+
+#if PIPELINED_LOAD && OUT_OF_CORE
+    #error "PIPELINED_LOAD does not apply to OUT_OF_CORE runs, which read tiles on demand"
+#endif
+#if INCREMENTAL_WRITEBACK && OUT_OF_CORE
+    #error "OUT_OF_CORE runs already write every tile back to OOC_WORK_FILE"
+#endif
+
+// Layout of the matrix in memory: row 0 aligned to MATRIX_ALIGNMENT bytes, rows padded to
+// an odd number of cache lines with MATRIX_PAD_LD (avoids cache set aliasing when the
+// column count is a power of two), and MATRIX_HUGE_PAGES 1 for transparent huge pages or
+// 2 for MAP_HUGETLB. Binary inputs are mapped in place unless padding or huge pages are
+// requested; the out-of-core tile buffers use the same layout.
+#define MATRIX_ALIGNMENT 64
+#define MATRIX_PAD_LD 0
+#define MATRIX_HUGE_PAGES 0
+
+const MatrixStorage matrix_storage{MATRIX_ALIGNMENT, MATRIX_PAD_LD != 0, static_cast<HugePages>(MATRIX_HUGE_PAGES)};
+
+// Result file written after the run. OUTPUT_BINARY dumps the bn2 binary format
+// instead of text; OUTPUT_R_ONLY keeps only R (the stored matrix is the
+// transpose, so R lives in its lower triangle) and zeroes the reflectors.
+#define OUTPUT_FILE "output.txt"
+#define OUTPUT_BINARY 0
+#define OUTPUT_R_ONLY 0
+
 typedef struct {
     int tid;
     int total_task_rows;
     int total_task_cols;
-    int m;
-    int n;
-    double* mat;
+    matrix_view_t<double> mat;     // Matrix being factored; only its shape in out-of-core runs
+    long long pop_ns;
+    long long pops;
+    long long pop_hits;
+    std::chrono::steady_clock::time_point exit_time;
 }thread_args_t;
 
-std::vector<std::stringstream> logstreams(NUM_THREADS);
-
 TaskTable task_table;
-DependencyTable dependency_table;
+#if LAZY_TASK_GENERATION
+    DependencyFrontier dependency_table;
+#else
+    DependencyTable dependency_table;
+#endif
+
+std::chrono::high_resolution_clock::time_point program_start;
+std::chrono::high_resolution_clock::time_point first_task_start;
+std::atomic<bool> first_task_started(false);
 
-std::vector<double> global_up_array, global_b_array;
+// Number of leading task rows whose matrix rows are loaded. Everything is loaded
+// up front unless PIPELINED_LOAD streams the input.
+std::atomic<int> task_rows_loaded(std::numeric_limits<int>::max());
 
-CircularQueueMtx<Task*> main_queue(1024), wait_queue(1024);
+inline bool task_row_loaded(int i){
+    return i < task_rows_loaded.load(std::memory_order_acquire);
+}
 
-void complete_task1(double* &mat, int m, int n, int row_start, int row_end, int col_start, int col_end){
+#if CHECKPOINT_INTERVAL_MS
+    Checkpointer checkpointer;
+#endif
 
-    double sm, sm1, cl, clinv, up, b;
-    int _row_start = row_start == 1 ? 0 : row_start;
+// Runs the kernel of a task of task row i. With checkpoints enabled it runs under the
+// row's lock, so a checkpoint never captures the row in the middle of a task.
+template <class Kernel>
+inline void run_task(int i, Kernel kernel){
+    #if CHECKPOINT_INTERVAL_MS
+        std::lock_guard<std::mutex> lock(checkpointer.rowLock(i));
+        kernel();
+        checkpointer.taskDone(i);
+    #else
+        kernel();
+    #endif
+}
 
-    for (int lpivot = _row_start; lpivot < row_end; lpivot++){
-        cl = fabs(mat[lpivot * n + lpivot]);
-        sm1 = 0;
+// Task rows whose last task has completed, for the write-back thread.
+std::unique_ptr<CircularQueueMtx<int>> writeback_queue;
 
-        for (int k = lpivot+1; k < n; k++){
-            sm = fabs(mat[lpivot * n + k]);
-            sm1 += sm * sm;
-            cl = fmax(sm, cl);
+// Called after task (i, j) completes: the rows of task row i are final after its last task.
+inline void task_row_finished(int i, int j, int total_task_cols){
+    #if INCREMENTAL_WRITEBACK
+        if (j + 1 == std::min((i+1) * BETA_DIV_ALPHA, total_task_cols)){
+            writeback_queue->push(i);
         }
+    #endif
+}
 
-        if (cl <= 0.0) { return; } clinv = 1.0/cl;
+#if TRACE
+    Tracer tracer;
+#endif
 
-        double d__1 = mat[lpivot * n + lpivot] * clinv;
-        sm = d__1 * d__1;
-        sm += sm1 * clinv * clinv;
+// Trace timestamp, 0 when tracing is compiled out.
+inline uint64_t trace_now(){
+    #if TRACE
+        return trace_ticks();
+    #else
+        return 0;
+    #endif
+}
 
-        cl *= sqrt(sm);
+// Stamps task as made runnable by thread tid (-1: the main thread) when it is first queued.
+// A parked task keeps the stamp of the thread that released it when the wait-queue poller
+// moves it on.
+inline Task* trace_ready(Task* task, int tid){
+    #if TRACE
+        if (task->ready_ticks == 0){
+            task->ready_ticks = trace_ticks();
+            task->released_by = tid;
+        }
+    #endif
+    return task;
+}
 
-        if (mat[lpivot * n + lpivot] > 0.0) { cl = -cl; }
+// Records work of the given kind that ran on thread tid from start until now.
+inline void trace_record(int tid, unsigned char kind, int i, int j, uint64_t ready, int released_by, uint64_t start){
+    #if TRACE
+        tracer.buffer(tid).record({ready, start, trace_ticks(), i, j, released_by, kind});
+    #endif
+}
 
-        up = mat[lpivot * n + lpivot] - cl;
-        mat[lpivot * n + lpivot] = cl;
+#if PERF_COUNTERS
+    PerfProfiler perf_profiler;
+#endif
 
-        if (row_end - lpivot < 0) { return; }
+// Opens the counters of worker tid on its own thread.
+inline void perf_open(int tid){
+    #if PERF_COUNTERS
+        perf_profiler.open(tid);
+    #endif
+}
 
-        b = up * mat[lpivot * n + lpivot];
+inline void perf_close(int tid){
+    #if PERF_COUNTERS
+        perf_profiler.close(tid);
+    #endif
+}
+
+// Bracket the kernel of a task: the counts in between are attributed to task (i, j).
+inline void perf_task_start(int tid){
+    #if PERF_COUNTERS
+        perf_profiler.thread(tid).start();
+    #endif
+}
 
-        if (b >= 0.0) { return; }
+inline void perf_task_stop(int tid, int type, int i, int j, int n, int row_start, int row_end, int col_start, int col_end){
+    #if PERF_COUNTERS
+        perf_profiler.thread(tid).stop(type, i, j, task_flops(type, n, row_start, row_end, col_start, col_end));
+    #endif
+}
 
-        b = 1.0/b;
+#if METRICS_INTERVAL_MS
+    LiveMetrics live_metrics;
+#endif
 
-        global_up_array[lpivot] = up;
-        global_b_array[lpivot] = b;
+// Counts a push to or pop from queue by thread tid (-1: the main thread).
+inline void metrics_push(int tid, MetricsQueue queue){
+    #if METRICS_INTERVAL_MS
+        live_metrics.thread(tid).push(queue);
+    #endif
+}
 
-        for (int j = lpivot+1; j < col_end; j++){
-            sm = mat[j * n + lpivot] * up;
+inline void metrics_pop(int tid, MetricsQueue queue){
+    #if METRICS_INTERVAL_MS
+        live_metrics.thread(tid).pop(queue);
+    #endif
+}
 
-            for (int i__ = lpivot+1; i__ < n; i__++){
-                sm += mat[j * n + i__] * mat[lpivot * n + i__];
-            }
+// Bracket the kernel of a task on worker tid.
+inline void metrics_task_start(int tid){
+    #if METRICS_INTERVAL_MS
+        live_metrics.thread(tid).taskStart();
+    #endif
+}
 
-            if (sm == 0.0) { continue; }
+inline void metrics_task_done(int tid, int type, int n, int row_start, int row_end, int col_start, int col_end){
+    #if METRICS_INTERVAL_MS
+        live_metrics.thread(tid).taskDone(type, task_flops(type, n, row_start, row_end, col_start, col_end));
+    #endif
+}
 
-            sm *= b;
-            mat[j * n + lpivot] += sm * up;
+#if SCHEDULE_RECORD
+    ScheduleRecorder schedule_recorder;
+#endif
 
-            for (int i__ = lpivot+1; i__ < n; i__++){
-                mat[j * n + i__] += sm * mat[lpivot * n + i__];
-            }
-        }
-    }
+// Schedule log timestamp, 0 when recording is compiled out.
+inline uint64_t schedule_now(){
+    #if SCHEDULE_RECORD
+        return trace_ticks();
+    #else
+        return 0;
+    #endif
 }
 
-void complete_task2(double* &mat, int m, int n, int row_start, int row_end, int col_start, int col_end){
-    
-    int _row_start = row_start == 1 ? 0 : row_start;
-    int _col_start = col_start == 1 ? 0 : col_start;
+// Logs task (i, j), run by worker tid from schedule_now() == start until now.
+inline void schedule_record(int tid, int i, int j, uint64_t start){
+    #if SCHEDULE_RECORD
+        schedule_recorder.record(tid, i, j, start, trace_ticks());
+    #endif
+}
 
-    double up = 0.0, b = 0.0, sm = 0.0;
+TerminationDetector termination;
 
-    for (int lpivot = _row_start; lpivot < row_end; lpivot++){
-        up = global_up_array[lpivot];
-        b  = global_b_array[lpivot];
+TaskGraph task_graph;
+StaticSchedule static_schedule;
+std::unique_ptr<std::atomic<bool>[]> task_ready;
+#if TRACE
+    // Static schedule: when each task finished and on which thread.
+    std::unique_ptr<uint64_t[]> trace_end_ticks;
+    std::unique_ptr<int[]> trace_finished_by;
+#endif
 
-        for (int j = _col_start; j < col_end; j++){
-            sm = mat[j * n + lpivot] * up;
+#if RUN_ANALYSIS
+    std::unique_ptr<PhaseTimer[]> phase_timers;         // Per worker
+    std::unique_ptr<uint64_t[]> task_cpu_ns;            // Kernel CPU time by TaskGraph id
+#endif
 
-            for (int i__ = lpivot+1; i__ < n; i__++){
-                sm += mat[j * n + i__] * mat[lpivot * n + i__];
-            }
+// Switches worker tid to phase.
+inline void phase_enter(int tid, WorkerPhase phase){
+    #if RUN_ANALYSIS
+        phase_timers[tid].enter(phase);
+    #endif
+}
 
-            if (sm == 0.0) { continue; }
+// Switches to phase, charging the time since the previous switch to `charged`.
+inline void phase_enter(int tid, WorkerPhase phase, WorkerPhase charged){
+    #if RUN_ANALYSIS
+        phase_timers[tid].enter(phase, charged);
+    #endif
+}
 
-            sm *= b;
-            mat[j * n + lpivot] += sm * up;
+inline void phase_start(int tid, WorkerPhase phase){
+    #if RUN_ANALYSIS
+        phase_timers[tid].start(phase);
+    #endif
+}
 
-            for (int i__ = lpivot+1; i__ < n; i__++){
-                mat[j * n + i__] += sm * mat[lpivot * n + i__];
-            }
-        }
+inline void phase_stop(int tid){
+    #if RUN_ANALYSIS
+        phase_timers[tid].stop();
+    #endif
+}
+
+// Thread CPU time at the start of a kernel, 0 without RUN_ANALYSIS.
+inline uint64_t analysis_now(){
+    #if RUN_ANALYSIS
+        return thread_cpu_ns();
+    #else
+        return 0;
+    #endif
+}
+
+// Records the kernel of task (i, j), started at analysis_now() == start, as done.
+inline void analysis_task(int i, int j, uint64_t start){
+    #if RUN_ANALYSIS
+        task_cpu_ns[task_graph.id(i, j)] = thread_cpu_ns() - start;
+    #endif
+}
+
+OutOfCorePlan ooc_plan;
+std::unique_ptr<TileStore> tile_store;
+matrix_t<double> tile_buffers(matrix_storage);     // One tile buffer per row
+size_t tile_buffer_elems = 0;
+std::unique_ptr<std::atomic<size_t>[]> ooc_pending;
+std::unique_ptr<CircularQueueMtx<size_t>> ooc_compute_queue, ooc_io_queue;
+std::atomic<long long> ooc_io_ns(0);
+#if TRACE
+    // Out-of-core nodes: when each became ready and which thread released it.
+    std::unique_ptr<uint64_t[]> ooc_ready_ticks;
+    std::unique_ptr<int[]> ooc_released_by;
+#endif
+
+// Ready tasks, and tasks waiting for the previous task of their row. A task sits in at most
+// one of them at a time, so main() sizes both for every task of the run: a resumed run can
+// park most of the remaining updates at once.
+#if USE_MULTIQUEUE
+    std::unique_ptr<MultiQueue<Task*, TaskPriority>> main_queue;
+#else
+    std::unique_ptr<CircularQueueMtx<Task*>> main_queue;
+#endif
+std::unique_ptr<CircularQueueMtx<Task*>> wait_queue;
+
+// Queues a ready task made runnable by thread tid (-1: the main thread), ahead of the others
+// if rotated. A task that does not fit would be lost and the run would never finish.
+inline void enqueue_ready(Task* task, int tid, bool rotated = false){
+    trace_ready(task, tid);
+    if (!(rotated ? main_queue->push_rotated(task) : main_queue->push(task))){
+        std::cerr << "Error: ready queue full, task (" << task->chunk_idx_i << ", " << task->chunk_idx_j << ") lost" << std::endl;
+        std::exit(EXIT_FAILURE);
+    }
+    metrics_push(tid, MetricsQueue::Ready);
+}
+
+// Parks a task until the previous task of its row is done.
+inline void enqueue_wait(Task* task, int tid){
+    trace_ready(task, tid);
+    if (!wait_queue->push(task)){
+        std::cerr << "Error: wait queue full, task (" << task->chunk_idx_i << ", " << task->chunk_idx_j << ") lost" << std::endl;
+        std::exit(EXIT_FAILURE);
     }
+    metrics_push(tid, MetricsQueue::Wait);
 }
 
+// Rows of an out-of-core task: its target tile and its pivot tile live in separate
+// tile buffers.
+struct TileRows {
+    double* target;
+    int target_begin;
+    int target_end;
+    double* pivot;
+    int pivot_begin;
+    int ld;
+    inline double* row(int r) const {
+        return r >= target_begin && r < target_end ? target + (size_t)(r - target_begin) * ld
+                                                   : pivot + (size_t)(r - pivot_begin) * ld;
+    }
+};
+
 void* thdwork(void* params){
     thread_args_t* thread_args = (thread_args_t*)params;
 
+    int tid = thread_args->tid;
     int total_task_rows = thread_args->total_task_rows;
     int total_task_cols = thread_args->total_task_cols;
-    double* mat = thread_args->mat;
-    int m = thread_args->m;
-    int n = thread_args->n;
+    matrix_view_t<double> mat = thread_args->mat;
+    int m = mat.rows();
+    int n = mat.cols();
+
+    long long pop_ns = 0, pops = 0, pop_hits = 0;
+    int idle_spins = 0;
+    perf_open(tid);
+    phase_start(tid, WorkerPhase::Queue);
 
     while (1) {
-        auto queue_elem1 = main_queue.pop();
+        phase_enter(tid, WorkerPhase::Queue);
+        #if QUEUE_STATS
+            auto pop_start = std::chrono::steady_clock::now();
+        #endif
+        auto queue_elem1 = main_queue->pop();
+        #if QUEUE_STATS
+            pop_ns += std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - pop_start).count();
+        #endif
+        pops++;
+
         if (Task* new_task = queue_elem1.value_or(nullptr)){
-            
+            pop_hits++;
+            metrics_pop(tid, MetricsQueue::Ready);
+
             int i = new_task->chunk_idx_i;
             int j = new_task->chunk_idx_j;
 
@@ -143,87 +495,578 @@ void* thdwork(void* params){
             int col_start = new_task->col_start;
             int col_end = new_task->col_end;
 
+            if (!first_task_started.load(std::memory_order_relaxed) && !first_task_started.exchange(true)){
+                first_task_start = std::chrono::high_resolution_clock::now();
+            }
+
             if (new_task->type == 1){
-                complete_task1(mat, m, n, row_start, row_end, col_start, col_end);
+                uint64_t trace_start = trace_now();
+                phase_enter(tid, WorkerPhase::Compute);
+                uint64_t kernel_start = analysis_now();
+                uint64_t schedule_start = schedule_now();
+                metrics_task_start(tid);
+                perf_task_start(tid);
+                run_task(i, [&]{ complete_task1(mat, m, n, row_start, row_end, col_start, col_end); });
+                perf_task_stop(tid, 1, i, j, n, row_start, row_end, col_start, col_end);
+                schedule_record(tid, i, j, schedule_start);
+                metrics_task_done(tid, 1, n, row_start, row_end, col_start, col_end);
+                analysis_task(i, j, kernel_start);
+                phase_enter(tid, WorkerPhase::Dependency);
+                trace_record(tid, TraceEvent::Panel, i, j, new_task->ready_ticks, new_task->released_by, trace_start);
+                task_row_finished(i, j, total_task_cols);
                 dependency_table.setDependency(i, j, true);
 
                 for (int k = i+1; k < total_task_rows; k++){
                     Task* next_task = task_table.getTask(k, j);
 
-                    if (j == 0 || dependency_table.getDependency(k, j-1)){
-                        
+                    if ((j == 0 || dependency_table.getDependency(k, j-1)) && task_row_loaded(k)){
+                        phase_enter(tid, WorkerPhase::Queue);
                         #if PRIORITIZE_CRITICAL_NODES
-
-                            if (next_task->enq_nxt_t1){
-                                main_queue.push_rotated(next_task);
-                            }
-                            else{
-                                main_queue.push(next_task);
-                            }
+                            enqueue_ready(next_task, tid, next_task->enq_nxt_t1);
                         #else
-                            main_queue.push(next_task);
+                            enqueue_ready(next_task, tid);
                         #endif
                     }
                     else{
-                        wait_queue.push(next_task);
+                        phase_enter(tid, WorkerPhase::Queue);
+                        enqueue_wait(next_task, tid);
                     }
+                    phase_enter(tid, WorkerPhase::Dependency);
                 }
+
+                // The last task row has no update task below it to release its next panel.
+                if (i == total_task_rows-1 && (j+1) < total_task_cols && (j+1) < (i+1) * BETA_DIV_ALPHA){
+                    enqueue_ready(task_table.getTask(i, j+1), tid, PRIORITIZE_CRITICAL_NODES);
+                }
+                task_table.releaseTask(new_task);
+                termination.complete();
             }
             else if (new_task->type == 2){
-                complete_task2(mat, m, n, row_start, row_end, col_start, col_end);
+                uint64_t trace_start = trace_now();
+                phase_enter(tid, WorkerPhase::Compute);
+                uint64_t kernel_start = analysis_now();
+                uint64_t schedule_start = schedule_now();
+                metrics_task_start(tid);
+                perf_task_start(tid);
+                run_task(i, [&]{ complete_task2(mat, m, n, row_start, row_end, col_start, col_end); });
+                perf_task_stop(tid, 2, i, j, n, row_start, row_end, col_start, col_end);
+                schedule_record(tid, i, j, schedule_start);
+                metrics_task_done(tid, 2, n, row_start, row_end, col_start, col_end);
+                analysis_task(i, j, kernel_start);
+                phase_enter(tid, WorkerPhase::Dependency);
+                trace_record(tid, TraceEvent::Update, i, j, new_task->ready_ticks, new_task->released_by, trace_start);
                 dependency_table.setDependency(i, j, true);
 
-                if (new_task->enq_nxt_t1 && (j+1) <= total_task_cols){
-                    #if PRIORITIZE_CRITICAL_NODES
-                        main_queue.push_rotated(task_table.getTask((j+1)/BETA_DIV_ALPHA, j+1));
-                    #else
-                        main_queue.push(task_table.getTask((j+1)/BETA_DIV_ALPHA, j+1));
-                    #endif
+                // After a resume the panel may already be done: checkpoints can capture it
+                // without the update below it that releases it.
+                if (new_task->enq_nxt_t1 && (j+1) <= total_task_cols
+                    && !((j+1) < total_task_cols && dependency_table.getDependency((j+1)/BETA_DIV_ALPHA, j+1))){
+                    enqueue_ready(task_table.getTask((j+1)/BETA_DIV_ALPHA, j+1), tid, PRIORITIZE_CRITICAL_NODES);
+                }
+                task_table.releaseTask(new_task);
+                termination.complete();
+            }
+            idle_spins = 0;
+        }
+        else{
+            phase_enter(tid, WorkerPhase::Idle, WorkerPhase::Idle);     // The empty pop was idle polling
+            if (termination.finished()){
+                break;
+            }
+            if (++idle_spins >= IDLE_SPINS_BEFORE_SLEEP){
+                idle_spins = 0;
+                if (termination.wait_for(std::chrono::microseconds(IDLE_SLEEP_US))){
+                    break;
                 }
             }
         }
-        auto queue_elem2 = wait_queue.pop();
+        phase_enter(tid, WorkerPhase::Queue);
+        auto queue_elem2 = wait_queue->pop();
         if (Task* local_task = queue_elem2.value_or(nullptr)){
+            metrics_pop(tid, MetricsQueue::Wait);
 
             int i = local_task->chunk_idx_i;
             int j = local_task->chunk_idx_j;
 
-            if (dependency_table.getDependency(i, j-1)){
-                main_queue.push(local_task);
+            phase_enter(tid, WorkerPhase::Dependency);
+            bool ready = (j == 0 || dependency_table.getDependency(i, j-1)) && task_row_loaded(i);
+            if (ready){
+                phase_enter(tid, WorkerPhase::Queue);
+                enqueue_ready(local_task, tid);
+            }
+            else{
+                // Still blocked: checking and parking it again was idle polling.
+                phase_enter(tid, WorkerPhase::Idle, WorkerPhase::Idle);
+                enqueue_wait(local_task, tid);
+            }
+        }
+        else{
+            phase_enter(tid, WorkerPhase::Idle, WorkerPhase::Idle);
+        }
+    }
+
+    phase_stop(tid);
+    perf_close(tid);
+    thread_args->exit_time = std::chrono::steady_clock::now();
+
+    thread_args->pop_ns = pop_ns;
+    thread_args->pops = pops;
+    thread_args->pop_hits = pop_hits;
+
+    return nullptr;
+}
+
+void* thdwork_static(void* params){
+    thread_args_t* thread_args = (thread_args_t*)params;
+
+    matrix_view_t<double> mat = thread_args->mat;
+    int m = mat.rows();
+    int n = mat.cols();
+
+    int tid = thread_args->tid;
+    perf_open(tid);
+    phase_start(tid, WorkerPhase::Idle);
+
+    for (size_t id : static_schedule.threadTasks(tid)){
+        phase_enter(tid, WorkerPhase::Idle);
+        #if TRACE
+            // The task became ready when its last predecessor finished.
+            uint64_t ready = tracer.startTicks();
+            int released_by = -1;
+        #endif
+        task_graph.forEachPredecessor(id, [&](size_t pred){
+            for (int spins = 0; !task_ready[pred].load(std::memory_order_acquire); spins++){
+                if (spins < IDLE_SPINS_BEFORE_SLEEP){
+                    cpu_relax();
+                }
+                else{
+                    std::this_thread::yield();
+                }
+            }
+            #if TRACE
+                if (trace_end_ticks[pred] > ready){
+                    ready = trace_end_ticks[pred];
+                    released_by = trace_finished_by[pred];
+                }
+            #endif
+        });
+
+        for (int spins = 0; !task_row_loaded(task_graph.node(id).i); spins++){
+            if (spins < IDLE_SPINS_BEFORE_SLEEP){
+                cpu_relax();
             }
             else{
-                wait_queue.push(local_task);   
+                std::this_thread::yield();
             }
         }
 
-        if (dependency_table.getDependency(total_task_rows-1, BETA_DIV_ALPHA * (total_task_rows-1))){
-            break;
+        if (!first_task_started.load(std::memory_order_relaxed) && !first_task_started.exchange(true)){
+            first_task_start = std::chrono::high_resolution_clock::now();
         }
+
+        const TaskNode& task = task_graph.node(id);
+        #if TRACE
+            uint64_t trace_start = trace_ticks();
+        #endif
+        phase_enter(tid, WorkerPhase::Compute);
+        uint64_t kernel_start = analysis_now();
+        uint64_t schedule_start = schedule_now();
+        metrics_task_start(tid);
+        perf_task_start(tid);
+        if (task.type == 1){
+            complete_task1(mat, m, n, task.row_start, task.row_end, task.col_start, task.col_end);
+        }
+        else{
+            complete_task2(mat, m, n, task.row_start, task.row_end, task.col_start, task.col_end);
+        }
+        perf_task_stop(tid, task.type, task.i, task.j, n, task.row_start, task.row_end, task.col_start, task.col_end);
+        schedule_record(tid, task.i, task.j, schedule_start);
+        metrics_task_done(tid, task.type, n, task.row_start, task.row_end, task.col_start, task.col_end);
+        analysis_task(task.i, task.j, kernel_start);
+        phase_enter(tid, WorkerPhase::Dependency);
+        #if TRACE
+            trace_record(tid, task.type, task.i, task.j, ready, released_by, trace_start);
+            trace_end_ticks[id] = trace_ticks();
+            trace_finished_by[id] = tid;
+        #endif
+        task_row_finished(task.i, task.j, task_graph.cols());
+        task_ready[id].store(true, std::memory_order_release);
     }
 
+    phase_stop(tid);
+    perf_close(tid);
+    thread_args->exit_time = std::chrono::steady_clock::now();
+
+    return nullptr;
+}
+
+
+// Task DAGs that run after the factorization (Q formation, --verify). A plan numbers its
+// tasks and provides predecessorCount(), forEachSuccessor() and run(); a task is queued
+// once its predecessors are done, as in the out-of-core scheduler.
+std::unique_ptr<std::atomic<size_t>[]> phase_pending;
+std::unique_ptr<CircularQueueMtx<size_t>> phase_queue;
+
+// Runs the tasks of the Plan at params as they become ready, until all are done.
+template <class Plan>
+void* thdwork_phase(void* params){
+    Plan& plan = *static_cast<Plan*>(params);
+    int idle_spins = 0;
+    while (1) {
+        if (auto id = phase_queue->pop()){
+            plan.run(*id);
+            plan.forEachSuccessor(*id, [](size_t next){
+                if (phase_pending[next].fetch_sub(1, std::memory_order_acq_rel) == 1){
+                    phase_queue->push(next);
+                }
+            });
+            termination.complete();
+            idle_spins = 0;
+        }
+        else{
+            if (termination.finished()){
+                break;
+            }
+            if (++idle_spins >= IDLE_SPINS_BEFORE_SLEEP){
+                idle_spins = 0;
+                if (termination.wait_for(std::chrono::microseconds(IDLE_SLEEP_US))){
+                    break;
+                }
+            }
+        }
+    }
+    return nullptr;
+}
+
+// Runs every task of plan on NUM_THREADS workers and returns the elapsed milliseconds.
+template <class Plan>
+double run_phase(Plan& plan){
+    auto start = std::chrono::high_resolution_clock::now();
+    phase_pending.reset(new std::atomic<size_t>[plan.size()]);
+    phase_queue.reset(new CircularQueueMtx<size_t>(plan.size()));
+    termination.init(plan.size());
+    for (size_t id = 0; id < plan.size(); id++){
+        phase_pending[id].store(plan.predecessorCount(id), std::memory_order_relaxed);
+        if (plan.predecessorCount(id) == 0){
+            phase_queue->push(id);
+        }
+    }
+    std::vector<pthread_t> threads(NUM_THREADS);
+    for (int i = 0; i < NUM_THREADS; i++){
+        pthread_create(&threads[i], NULL, thdwork_phase<Plan>, &plan);
+    }
+    for (int i = 0; i < NUM_THREADS; i++){
+        pthread_join(threads[i], NULL);
+    }
+    return std::chrono::duration<double, std::milli>(std::chrono::high_resolution_clock::now() - start).count();
+}
+
+double* tile_buffer(int slot){
+    return tile_buffers.data_ptr() + (size_t)slot * tile_buffers.ld();
+}
+
+// Queues a ready out-of-core node for the I/O thread or the workers. tid is the thread
+// that made it ready (-1: the main thread, NUM_THREADS: the I/O thread).
+void ooc_enqueue(size_t id, int tid){
+    #if TRACE
+        ooc_ready_ticks[id] = trace_ticks();
+        ooc_released_by[id] = tid;
+    #endif
+    if (ooc_plan.node(id).kind == OocNode::Compute){
+        ooc_compute_queue->push(id);
+        metrics_push(tid, MetricsQueue::Ready);
+    }
+    else{
+        ooc_io_queue->push(id);
+        metrics_push(tid, MetricsQueue::Wait);
+    }
+}
+
+// Marks node id, run by thread tid, as done and queues the successors it made ready.
+void ooc_complete(size_t id, int tid){
+    ooc_plan.forEachSuccessor(id, [tid](size_t next){
+        if (ooc_pending[next].fetch_sub(1, std::memory_order_acq_rel) == 1){
+            ooc_enqueue(next, tid);
+        }
+    });
+    termination.complete();
+}
+
+void* thdwork_ooc(void* params){
+    thread_args_t* thread_args = (thread_args_t*)params;
+
+    int tid = thread_args->tid;
+    int m = thread_args->mat.rows();
+    int n = thread_args->mat.cols();
+    int ld = thread_args->mat.ld();
+    int idle_spins = 0;
+    perf_open(tid);
+    phase_start(tid, WorkerPhase::Queue);
+
+    while (1) {
+        phase_enter(tid, WorkerPhase::Queue);
+        if (auto id = ooc_compute_queue->pop()){
+            metrics_pop(tid, MetricsQueue::Ready);
+            if (!first_task_started.load(std::memory_order_relaxed) && !first_task_started.exchange(true)){
+                first_task_start = std::chrono::high_resolution_clock::now();
+            }
+
+            const OocNode& node = ooc_plan.node(*id);
+            const TaskNode& task = task_graph.node(node.task);
+            TileRows rows{tile_buffer(node.slot), tile_store->tileBegin(node.tile), tile_store->tileEnd(node.tile),
+                          tile_buffer(node.pivot_slot), tile_store->tileBegin(node.pivot_tile), ld};
+
+            #if TRACE
+                uint64_t trace_start = trace_ticks();
+            #endif
+            phase_enter(tid, WorkerPhase::Compute);
+            uint64_t kernel_start = analysis_now();
+            metrics_task_start(tid);
+            perf_task_start(tid);
+            if (task.type == 1){
+                complete_task1(rows, m, n, task.row_start, task.row_end, task.col_start, task.col_end);
+            }
+            else{
+                complete_task2(rows, m, n, task.row_start, task.row_end, task.col_start, task.col_end);
+            }
+            perf_task_stop(tid, task.type, task.i, task.j, n, task.row_start, task.row_end, task.col_start, task.col_end);
+            metrics_task_done(tid, task.type, n, task.row_start, task.row_end, task.col_start, task.col_end);
+            analysis_task(task.i, task.j, kernel_start);
+            phase_enter(tid, WorkerPhase::Dependency);
+            #if TRACE
+                trace_record(tid, task.type, task.i, task.j, ooc_ready_ticks[*id], ooc_released_by[*id], trace_start);
+            #endif
+            ooc_complete(*id, tid);
+            idle_spins = 0;
+        }
+        else{
+            phase_enter(tid, WorkerPhase::Idle, WorkerPhase::Idle);     // The empty pop was idle polling
+            if (termination.finished()){
+                break;
+            }
+            if (++idle_spins >= IDLE_SPINS_BEFORE_SLEEP){
+                idle_spins = 0;
+                if (termination.wait_for(std::chrono::microseconds(IDLE_SLEEP_US))){
+                    break;
+                }
+            }
+        }
+    }
+
+    phase_stop(tid);
+    perf_close(tid);
+    thread_args->exit_time = std::chrono::steady_clock::now();
+
+    return nullptr;
+}
+
+// Performs the tile loads and stores of the out-of-core plan in the order they become ready.
+void* ooc_io_thread(void*){
+    while (!termination.finished()){
+        auto id = ooc_io_queue->pop();
+        if (!id){
+            termination.wait_for(std::chrono::microseconds(IDLE_SLEEP_US));
+            continue;
+        }
+        metrics_pop(NUM_THREADS, MetricsQueue::Wait);
+
+        const OocNode& node = ooc_plan.node(*id);
+        auto io_start = std::chrono::steady_clock::now();
+        #if TRACE
+            uint64_t trace_start = trace_ticks();
+        #endif
+        try {
+            if (node.kind == OocNode::Load){
+                tile_store->read(node.tile, tile_buffer(node.slot));
+            }
+            else{
+                tile_store->write(node.tile, tile_buffer(node.slot));
+            }
+        } catch (const std::exception& e) {
+            std::cerr << e.what() << std::endl;
+            std::exit(EXIT_FAILURE);
+        }
+        ooc_io_ns += std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - io_start).count();
+        #if TRACE
+            trace_record(NUM_THREADS, node.kind == OocNode::Load ? TraceEvent::TileLoad : TraceEvent::TileStore,
+                         node.tile, node.slot, ooc_ready_ticks[*id], ooc_released_by[*id], trace_start);
+        #endif
+        ooc_complete(*id, NUM_THREADS);
+    }
     return nullptr;
 }
 
 int main(int argc, char *argv[]){
+    program_start = std::chrono::high_resolution_clock::now();
     std::cout << "[1]. Inside main." << std::endl;
+    #if METRICS_INTERVAL_MS
+        // Before any thread exists, so that SIGUSR1 only reaches the sampler.
+        LiveMetrics::blockSignal();
+    #endif
 
-    if (argc < 2) {
-        std::cerr << "Usage: " << argv[0] << " <filename>" << std::endl;
+    bool resume = false, verify = false, usage = argc < 2;
+    for (int k = 2; k < argc; k++){
+        std::string option = argv[k];
+        if (option == "--resume") resume = true;
+        else if (option == "--verify") verify = true;
+        else usage = true;
+    }
+    if (usage) {
+        std::cerr << "Usage: " << argv[0] << " <filename> [--resume] [--verify]" << std::endl;
         return EXIT_FAILURE;
     }
 
-    matrix_t<double> data_matrix(argv[1]);
+    #if CHECKPOINT_INTERVAL_MS
+        CheckpointData resumed;
+        if (resume && !Checkpointer::load(CHECKPOINT_DIR, ALPHA, BETA, resumed)){
+            std::cerr << "No checkpoint found in " << CHECKPOINT_DIR << std::endl;
+            return EXIT_FAILURE;
+        }
+    #else
+        if (resume){
+            std::cerr << "--resume needs a build with CHECKPOINT_INTERVAL_MS set" << std::endl;
+            return EXIT_FAILURE;
+        }
+    #endif
 
-    int total_task_rows = std::ceil((double)data_matrix.rows()/BETA);
-    int total_task_cols = std::ceil((double)data_matrix.rows()/ALPHA);
+    auto load_start = std::chrono::high_resolution_clock::now();
+    #if OUT_OF_CORE
+        // The work file is updated in place; only tile buffers are held in memory. The input
+        // is checked first so that a text file does not overwrite the work file.
+        try {
+            TileStore::check(argv[1]);
+        } catch (const std::runtime_error& e) {
+            std::cerr << e.what() << std::endl
+                      << "Out-of-core mode needs a binary matrix (convert it with ./matconv.out <input> <output> --binary)" << std::endl;
+            return EXIT_FAILURE;
+        }
+        try {
+            std::filesystem::copy_file(argv[1], OOC_WORK_FILE, std::filesystem::copy_options::overwrite_existing);
+            tile_store.reset(new TileStore(OOC_WORK_FILE, BETA));
+        } catch (const std::exception& e) {
+            std::cerr << e.what() << std::endl;
+            return EXIT_FAILURE;
+        }
+        matrix_view_t<double> mat(nullptr, tile_store->rows(), tile_store->cols(), tile_store->ld());
+    #elif PIPELINED_LOAD
+        matrix_t<double> data_matrix(matrix_storage);
+        MatrixStreamLoader<double> loader;
+        loader.open(argv[1], data_matrix);
+        MatrixWriter<double> verify_writer;     // Copy of A for --verify, written as the rows arrive
+        int verify_rows = 0;
+        task_rows_loaded.store(0);
+        matrix_view_t<double> mat = data_matrix.view();
+    #elif CHECKPOINT_INTERVAL_MS
+        // A resumed run starts from an owned copy of the checkpointed rows: the
+        // checkpoint files are rewritten while the run goes on.
+        matrix_t<double> data_matrix(matrix_storage);
+        if (resume){
+            matrix_t<double> snapshot(resumed.matrix_file, MapMode::ReadOnly);
+            data_matrix = snapshot;
+            std::cout << "Resuming from checkpoint " << resumed.sequence << " in " << CHECKPOINT_DIR << std::endl;
+        }
+        else{
+            data_matrix.read_matrix(argv[1]);
+        }
+        matrix_view_t<double> mat = data_matrix.view();
+    #else
+        matrix_t<double> data_matrix(argv[1], matrix_storage);
+        matrix_view_t<double> mat = data_matrix.view();
+    #endif
+    int mat_rows = mat.rows();
+    int mat_cols = mat.cols();
+    double load_ms = std::chrono::duration<double, std::milli>(std::chrono::high_resolution_clock::now() - load_start).count();
+    double load_mb = std::filesystem::file_size(argv[1]) / 1e6;
+
+    #if PIPELINED_LOAD
+        std::cout << "Opened " << argv[1] << " (" << load_mb << " MB, " << mat_rows << " x " << mat_cols
+                  << ") in " << load_ms << " ms, streaming the values" << std::endl;
+    #else
+        std::cout << "Loaded " << argv[1] << " (" << load_mb << " MB) in " << load_ms << " ms, "
+                  << (load_ms > 0 ? load_mb / (load_ms / 1e3) : 0.0) << " MB/s" << std::endl;
+    #endif
+    #if !OUT_OF_CORE
+        static const char* const huge_page_names[] = {"none", "transparent", "explicit"};
+        std::cout << "Storage: ld " << mat.ld() << " for " << mat_cols << " columns, "
+                  << (data_matrix.is_mapped() ? std::string("mapped from the file")
+                                              : std::string("huge pages ") + huge_page_names[(int)data_matrix.huge_pages()])
+                  << std::endl;
+    #endif
+
+    // The copy of A for --verify is taken before the workers change the matrix.
+    double verify_copy_ms = 0;
+    if ((verify || FORM_Q) && mat_rows > mat_cols){
+        std::cerr << (verify ? "--verify" : "FORM_Q") << " needs at least as many columns as rows" << std::endl;
+        return EXIT_FAILURE;
+    }
+    if (verify){
+        auto copy_start = std::chrono::high_resolution_clock::now();
+        try {
+            #if OUT_OF_CORE
+                std::filesystem::copy_file(argv[1], VERIFY_COPY_FILE, std::filesystem::copy_options::overwrite_existing);
+            #elif PIPELINED_LOAD
+                // The reader writes the rows as they are parsed, before the workers get them.
+                verify_writer.open(VERIFY_COPY_FILE, data_matrix, MatrixFormat::Binary);
+            #elif CHECKPOINT_INTERVAL_MS
+                // The matrix in memory may come from a checkpoint.
+                matrix_t<double>(argv[1]).save(VERIFY_COPY_FILE, MatrixFormat::Binary);
+            #else
+                data_matrix.save(VERIFY_COPY_FILE, MatrixFormat::Binary);
+            #endif
+        } catch (const std::exception& e) {
+            std::cerr << e.what() << std::endl;
+            return EXIT_FAILURE;
+        }
+        verify_copy_ms = std::chrono::duration<double, std::milli>(std::chrono::high_resolution_clock::now() - copy_start).count();
+    }
+
+    int total_task_rows = std::ceil((double)mat_rows/BETA);
+    int total_task_cols = std::ceil((double)mat_rows/ALPHA);
 
     std::cout<< total_task_rows << " " << total_task_cols << std::endl;
 
-    global_up_array.resize(data_matrix.rows(), 0.0);
-    global_b_array.resize(data_matrix.rows() , 0.0);
+    global_up_array.resize(mat_rows, 0.0);
+    global_b_array.resize(mat_rows , 0.0);
 
     dependency_table.init(total_task_rows, total_task_cols);
-    task_table.init(total_task_rows, total_task_cols, ALPHA, BETA, data_matrix);
+    task_table.init(total_task_rows, total_task_cols, ALPHA, BETA, mat, LAZY_TASK_GENERATION);
+
+    #if CHECKPOINT_INTERVAL_MS
+        if (resume){
+            if (resumed.progress.size() != (size_t)total_task_rows || resumed.up.size() != (size_t)mat_rows){
+                std::cerr << "Checkpoint in " << CHECKPOINT_DIR << " does not match the matrix shape" << std::endl;
+                return EXIT_FAILURE;
+            }
+            global_up_array = resumed.up;
+            global_b_array = resumed.b;
+        }
+        checkpointer.init(CHECKPOINT_DIR, data_matrix, task_table, resume ? &resumed : nullptr);
+    #endif
+
+    #if METRICS_INTERVAL_MS
+        // Progress is measured in flops over the tasks this run executes; a resumed run
+        // leaves out the ones its checkpoint completed.
+        uint64_t metrics_tasks = 0;
+        double metrics_flops = 0;
+        for (int i = 0; i < total_task_rows; i++){
+            int first = 0;
+            #if CHECKPOINT_INTERVAL_MS
+                first = resume ? resumed.progress[i] : 0;
+            #endif
+            for (int j = first; j < std::min((i+1) * BETA_DIV_ALPHA, total_task_cols); j++){
+                std::unique_ptr<Task> t(task_table.makeTask(i, j));
+                metrics_flops += task_flops(t->type, mat_cols, t->row_start, t->row_end, t->col_start, t->col_end);
+                metrics_tasks++;
+            }
+        }
+        #if OUT_OF_CORE
+            live_metrics.init(NUM_THREADS, metrics_tasks, metrics_flops, "compute", "I/O");
+        #elif STATIC_SCHEDULE || SCHEDULE_REPLAY
+            live_metrics.init(NUM_THREADS, metrics_tasks, metrics_flops, nullptr, nullptr);
+        #else
+            live_metrics.init(NUM_THREADS, metrics_tasks, metrics_flops, "ready", "wait");
+        #endif
+    #endif
 
     std::vector<pthread_t> threads(NUM_THREADS);
     std::vector<thread_args_t> thread_args(NUM_THREADS);
@@ -232,30 +1075,471 @@ int main(int argc, char *argv[]){
         thread_args[i].tid = i;
         thread_args[i].total_task_rows = total_task_rows;
         thread_args[i].total_task_cols = total_task_cols;
-        thread_args[i].m = data_matrix.rows();
-        thread_args[i].n = data_matrix.cols();
-        thread_args[i].mat = data_matrix.data_ptr();
+        thread_args[i].mat = mat;
     }
     
-    main_queue.push(task_table.getTask(0, 0));
+    #if OUT_OF_CORE
+        task_graph.build(task_table, mat_cols);
+        tile_buffer_elems = tile_store->maxTileElements();
+        int tile_slots = (int)std::min<size_t>((size_t)(OOC_MEMORY_BUDGET_MB * 1048576.0) / (tile_buffer_elems * sizeof(double)),
+                                               total_task_rows + OOC_PREFETCH_SLOTS);
+        try {
+            ooc_plan.build(task_graph, tile_slots, OOC_PREFETCH_SLOTS);
+        } catch (const std::invalid_argument& e) {
+            std::cerr << e.what() << " (" << tile_buffer_elems * sizeof(double) << " bytes each, raise OOC_MEMORY_BUDGET_MB)" << std::endl;
+            return EXIT_FAILURE;
+        }
+        tile_buffers = matrix_t<double>(ooc_plan.slots(), (int)tile_buffer_elems, matrix_storage);
+        tile_buffers.fill(0.0);
+
+        ooc_pending.reset(new std::atomic<size_t>[ooc_plan.size()]);
+        ooc_compute_queue.reset(new CircularQueueMtx<size_t>(ooc_plan.size()));
+        ooc_io_queue.reset(new CircularQueueMtx<size_t>(ooc_plan.size()));
+        termination.init(ooc_plan.size());
+        #if TRACE
+            ooc_ready_ticks.reset(new uint64_t[ooc_plan.size()]());
+            ooc_released_by.reset(new int[ooc_plan.size()]());
+        #endif
+        for (size_t id = 0; id < ooc_plan.size(); id++){
+            ooc_pending[id].store(ooc_plan.predecessorCount(id), std::memory_order_relaxed);
+        }
+        for (size_t id = 0; id < ooc_plan.size(); id++){
+            if (ooc_plan.predecessorCount(id) == 0){
+                ooc_enqueue(id, -1);
+            }
+        }
+        void* (*worker)(void*) = thdwork_ooc;
+    #elif STATIC_SCHEDULE || SCHEDULE_REPLAY
+        auto plan_start = std::chrono::high_resolution_clock::now();
+        task_graph.build(task_table, mat_cols);
+        #if SCHEDULE_REPLAY
+            ScheduleLog replay_log;
+            try {
+                replay_log = ScheduleLog::load(SCHEDULE_REPLAY_FILE);
+                if (replay_log.threads() != NUM_THREADS){
+                    throw std::runtime_error(std::string(SCHEDULE_REPLAY_FILE) + " was recorded with "
+                                             + std::to_string(replay_log.threads()) + " workers, this build has "
+                                             + std::to_string(NUM_THREADS));
+                }
+                static_schedule.assign(task_graph, replay_log.threadLists(task_graph));
+            } catch (const std::exception& e) {
+                std::cerr << e.what() << std::endl;
+                return EXIT_FAILURE;
+            }
+        #else
+            bool plan_cached = static_schedule.loadOrBuild(STATIC_SCHEDULE_CACHE_DIR, task_graph, NUM_THREADS, std::cerr);
+        #endif
+        task_ready.reset(new std::atomic<bool>[task_graph.size()]());
+        #if TRACE
+            trace_end_ticks.reset(new uint64_t[task_graph.size()]());
+            trace_finished_by.reset(new int[task_graph.size()]());
+        #endif
+        auto plan_ms = std::chrono::duration_cast<std::chrono::milliseconds>(
+            std::chrono::high_resolution_clock::now() - plan_start).count();
+        void* (*worker)(void*) = thdwork_static;
+    #else
+        #if USE_MULTIQUEUE
+            main_queue.reset(new MultiQueue<Task*, TaskPriority>(MULTIQUEUE_SHARDS_PER_THREAD * NUM_THREADS));
+        #else
+            main_queue.reset(new CircularQueueMtx<Task*>(task_table.taskCount()));
+        #endif
+        wait_queue.reset(new CircularQueueMtx<Task*>(task_table.taskCount()));
+        termination.init(task_table.taskCount());
+        #if CHECKPOINT_INTERVAL_MS
+            if (resume){
+                termination.complete(resume_tasks(resumed.progress, task_table, dependency_table,
+                                                  [](Task* task){ enqueue_ready(task, -1); },
+                                                  [](Task* task){ enqueue_wait(task, -1); }));
+            }
+            else
+        #endif
+        if (task_row_loaded(0)){
+            enqueue_ready(task_table.getTask(0, 0), -1);
+        }
+        else{
+            enqueue_wait(task_table.getTask(0, 0), -1);
+        }
+        void* (*worker)(void*) = thdwork;
+    #endif
+
+    #if TRACE
+        // Threads share the work evenly on average; a buffer grows past its reservation if not.
+        #if OUT_OF_CORE
+            size_t trace_events = ooc_plan.size();
+        #else
+            size_t trace_events = task_table.taskCount();
+        #endif
+        tracer.init(NUM_THREADS + 1, 2 * trace_events / NUM_THREADS + 1024);
+        tracer.start();
+    #endif
+    #if PERF_COUNTERS
+        #if OUT_OF_CORE
+            perf_profiler.init(NUM_THREADS, 2 * ooc_plan.size() / NUM_THREADS + 1024);
+        #else
+            perf_profiler.init(NUM_THREADS, 2 * task_table.taskCount() / NUM_THREADS + 1024);
+        #endif
+    #endif
+
+    #if SCHEDULE_RECORD
+        schedule_recorder.init(NUM_THREADS, 2 * task_table.taskCount() / NUM_THREADS + 1024);
+        schedule_recorder.start();
+    #endif
+
+    #if RUN_ANALYSIS
+        #if !STATIC_SCHEDULE && !OUT_OF_CORE && !SCHEDULE_REPLAY
+            task_graph.build(task_table, mat_cols);
+        #endif
+        phase_timers.reset(new PhaseTimer[NUM_THREADS]);
+        task_cpu_ns.reset(new uint64_t[task_graph.size()]());
+        TraceClock analysis_clock;
+        analysis_clock.start();
+    #endif
+
+    #if INCREMENTAL_WRITEBACK
+        // Opened before any thread starts, so an unwritable OUTPUT_FILE fails the run up front.
+        MatrixWriter<double> writer;
+        try {
+            writer.open(OUTPUT_FILE, data_matrix,
+                        OUTPUT_BINARY ? MatrixFormat::Binary : MatrixFormat::Text,
+                        OUTPUT_R_ONLY ? MatrixPart::LowerTriangle : MatrixPart::Full);
+        } catch (const std::exception& e) {
+            std::cerr << e.what() << std::endl;
+            return EXIT_FAILURE;
+        }
+    #endif
 
     auto start = std::chrono::high_resolution_clock::now();
     
+    #if OUT_OF_CORE
+        pthread_t io_thread;
+        pthread_create(&io_thread, NULL, ooc_io_thread, NULL);
+    #elif PIPELINED_LOAD
+        std::chrono::high_resolution_clock::time_point load_end;
+        std::thread reader([&](){
+            try {
+                loader.parse([&](int rows){
+                    if (verify){
+                        auto copy_start = std::chrono::high_resolution_clock::now();
+                        verify_writer.write_rows(verify_rows, rows);
+                        verify_rows = rows;
+                        verify_copy_ms += std::chrono::duration<double, std::milli>(std::chrono::high_resolution_clock::now() - copy_start).count();
+                    }
+                    int loaded = task_rows_loaded.load(std::memory_order_relaxed);
+                    while (loaded < total_task_rows && task_table.targetRowEnd(loaded) <= rows){
+                        loaded++;
+                    }
+                    task_rows_loaded.store(loaded, std::memory_order_release);
+                });
+            } catch (const std::exception& e) {
+                std::cerr << e.what() << std::endl;
+                std::exit(EXIT_FAILURE);
+            }
+            load_end = std::chrono::high_resolution_clock::now();
+        });
+    #endif
+
+    #if INCREMENTAL_WRITEBACK
+        // Task rows finish in order, but the writer does not rely on it: it writes the
+        // longest finished prefix, which text output needs anyway.
+        writeback_queue.reset(new CircularQueueMtx<int>(total_task_rows));
+        #if CHECKPOINT_INTERVAL_MS
+            // Rows finished before the checkpoint are not finished again.
+            for (int i = 0; i < total_task_rows; i++){
+                if (checkpointer.rowProgress(i) == std::min((i+1) * BETA_DIV_ALPHA, total_task_cols)){
+                    writeback_queue->push(i);
+                }
+            }
+        #endif
+        std::chrono::high_resolution_clock::time_point writeback_end;
+        std::thread writeback([&](){
+            std::vector<char> finished(total_task_rows, 0);
+            int next = 0;
+            try {
+                while (next < total_task_rows){
+                    auto i = writeback_queue->pop();
+                    if (!i){
+                        std::this_thread::sleep_for(std::chrono::microseconds(IDLE_SLEEP_US));
+                        continue;
+                    }
+                    finished[*i] = 1;
+                    while (next < total_task_rows && finished[next]){
+                        writer.write_rows(task_table.targetRowBegin(next), task_table.targetRowEnd(next));
+                        next++;
+                    }
+                }
+                writer.close();
+            } catch (const std::exception& e) {
+                std::cerr << e.what() << std::endl;
+                std::exit(EXIT_FAILURE);
+            }
+            writeback_end = std::chrono::high_resolution_clock::now();
+        });
+    #endif
+
+    #if METRICS_INTERVAL_MS
+        std::ofstream metrics_file;
+        if (*METRICS_FILE){
+            metrics_file.open(METRICS_FILE, std::ios::trunc);
+            if (!metrics_file.is_open()){
+                std::cerr << "Error opening file for writing: " << METRICS_FILE << std::endl;
+                return EXIT_FAILURE;
+            }
+        }
+        std::ostream& metrics_out = *METRICS_FILE ? metrics_file : std::cerr;
+        std::thread metrics_thread([&](){
+            live_metrics.run(metrics_out, std::chrono::milliseconds(METRICS_INTERVAL_MS));
+        });
+    #endif
+
     for (int i = 0; i < NUM_THREADS; i++){
-        pthread_create(&threads[i], NULL, thdwork, &thread_args[i]);
+        pthread_create(&threads[i], NULL, worker, &thread_args[i]);
     }
 
+    #if CHECKPOINT_INTERVAL_MS
+        std::thread checkpoint_thread([&](){
+            try {
+                while (!termination.wait_for(std::chrono::milliseconds(CHECKPOINT_INTERVAL_MS))){
+                    checkpointer.save(global_up_array, global_b_array);
+                }
+            } catch (const std::exception& e) {
+                std::cerr << e.what() << std::endl;
+                std::exit(EXIT_FAILURE);
+            }
+        });
+    #endif
+
     for (int i = 0; i < NUM_THREADS; i++){
         pthread_join(threads[i], NULL);
     }
+
+    #if CHECKPOINT_INTERVAL_MS
+        checkpoint_thread.join();
+    #endif
+
+    #if OUT_OF_CORE
+        pthread_join(io_thread, NULL);
+    #elif PIPELINED_LOAD
+        reader.join();
+    #endif
+
+    #if METRICS_INTERVAL_MS
+        live_metrics.stop();
+        metrics_thread.join();
+    #endif
     
     auto end = std::chrono::high_resolution_clock::now();
+    #if TRACE
+        tracer.stop();
+    #endif
+    #if SCHEDULE_RECORD
+        schedule_recorder.stop();
+    #endif
+    #if RUN_ANALYSIS
+        analysis_clock.stop();
+    #endif
+
+    #if INCREMENTAL_WRITEBACK
+        writeback.join();
+    #endif
 
     auto elapsed = std::chrono::duration_cast<std::chrono::milliseconds>(end - start).count();
 
     std::cout << "Time taken: " << elapsed << " ms" << std::endl;
+    std::cout << "Time to first task: "
+              << std::chrono::duration_cast<std::chrono::milliseconds>(first_task_start - program_start).count()
+              << " ms" << std::endl;
+    #if PIPELINED_LOAD
+        double stream_ms = std::chrono::duration<double, std::milli>(load_end - load_start).count();
+        std::cout << "Loaded " << argv[1] << " in " << stream_ms << " ms, "
+                  << (stream_ms > 0 ? load_mb / (stream_ms / 1e3) : 0.0) << " MB/s, overlapped with the factorization" << std::endl;
+    #endif
+
+    #if OUT_OF_CORE
+        std::cout << "Schedule: out-of-core, " << ooc_plan.slots() << " tile buffers ("
+                  << ooc_plan.slots() * tile_buffer_elems * sizeof(double) / 1e6 << " MB), "
+                  << ooc_plan.groupCount() << " resident groups" << std::endl;
+        std::cout << "Tile I/O: " << ooc_plan.loadCount() << " loads (" << tile_store->bytesRead() / 1e6 << " MB), "
+                  << ooc_plan.storeCount() << " stores (" << tile_store->bytesWritten() / 1e6 << " MB), "
+                  << ooc_io_ns.load() / 1000000 << " ms busy" << std::endl;
+    #elif SCHEDULE_REPLAY
+        std::cout << "Schedule: replay of " << SCHEDULE_REPLAY_FILE << " (" << replay_log.taskCount()
+                  << " tasks, recorded makespan " << replay_log.makespanUs() / 1e3 << " ms), loaded in "
+                  << plan_ms << " ms" << std::endl;
+    #elif STATIC_SCHEDULE
+        std::cout << "Schedule: static, plan " << (plan_cached ? "loaded from cache" : "built and cached")
+                  << " in " << plan_ms << " ms" << std::endl;
+        std::cout << "Predicted parallel efficiency: "
+                  << 100.0 * task_graph.totalCost() / (NUM_THREADS * static_schedule.predictedMakespan())
+                  << " %" << std::endl;
+    #else
+        auto last_exit = thread_args[0].exit_time;
+        for (int i = 1; i < NUM_THREADS; i++){
+            last_exit = std::max(last_exit, thread_args[i].exit_time);
+        }
+        auto shutdown_latency = std::chrono::duration_cast<std::chrono::microseconds>(last_exit - termination.finishTime()).count();
+
+        #if USE_MULTIQUEUE
+            std::cout << "Main queue: MultiQueue (" << main_queue->shard_count() << " shards)" << std::endl;
+        #else
+            std::cout << "Main queue: CircularQueueMtx" << std::endl;
+        #endif
+        std::cout << "Shutdown latency: " << shutdown_latency << " us" << std::endl;
+        #if QUEUE_STATS
+            // Idle workers pop in a loop, so the pops are only timed with the contention counters.
+            long long pop_ns = 0, pops = 0, pop_hits = 0;
+            for (int i = 0; i < NUM_THREADS; i++){
+                pop_ns += thread_args[i].pop_ns;
+                pops += thread_args[i].pops;
+                pop_hits += thread_args[i].pop_hits;
+            }
+            std::cout << "Average pop latency: " << (pops ? pop_ns / pops : 0) << " ns over " << pops
+                      << " pops (" << pop_hits << " returned a task)" << std::endl;
+        #endif
+    #endif
+
+    #if QUEUE_STATS && !OUT_OF_CORE && !STATIC_SCHEDULE && !SCHEDULE_REPLAY
+        #if !USE_MULTIQUEUE
+            main_queue->stats().print(std::cout, "main_queue");
+        #endif
+        wait_queue->stats().print(std::cout, "wait_queue");
+    #endif
+
+    #if CHECKPOINT_INTERVAL_MS
+        std::cout << "Checkpoints: " << checkpointer.checkpointCount() << " taken, "
+                  << checkpointer.bytesWritten() / 1e6 << " MB of rows written, last took "
+                  << checkpointer.lastSaveMs() << " ms" << std::endl;
+    #endif
+
+    #if LAZY_TASK_GENERATION
+        std::cout << "Peak live tasks: " << task_table.peakLiveTasks() << std::endl;
+    #endif
+
+    #if OUT_OF_CORE
+        std::cout << "Result written to " << OOC_WORK_FILE << std::endl;
+    #elif INCREMENTAL_WRITEBACK
+        std::cout << "Result streamed to " << OUTPUT_FILE << " (" << writer.bytesWritten() / 1e6 << " MB), done "
+                  << std::max(0.0, std::chrono::duration<double, std::milli>(writeback_end - end).count())
+                  << " ms after the last worker" << std::endl;
+    #else
+        data_matrix.save(OUTPUT_FILE,
+                         OUTPUT_BINARY ? MatrixFormat::Binary : MatrixFormat::Text,
+                         OUTPUT_R_ONLY ? MatrixPart::LowerTriangle : MatrixPart::Full);
+    #endif
+
+    #if RUN_ANALYSIS
+        std::vector<double> task_ms(task_graph.size());
+        for (size_t id = 0; id < task_graph.size(); id++){
+            task_ms[id] = task_cpu_ns[id] / 1e6;
+        }
+        std::vector<RunAnalysis::PhaseMs> worker_ms(NUM_THREADS);
+        for (int t = 0; t < NUM_THREADS; t++){
+            for (size_t p = 0; p < worker_ms[t].size(); p++){
+                worker_ms[t][p] = analysis_clock.durationMicros(phase_timers[t].get(static_cast<WorkerPhase>(p))) / 1e3;
+            }
+        }
+        RunAnalysis analysis;
+        analysis.analyze(task_graph, task_ms, std::chrono::duration<double, std::milli>(end - start).count(),
+                         worker_ms, std::thread::hardware_concurrency());
+        analysis.report(std::cout);
+    #endif
 
-    data_matrix.save("output.txt");
+    #if PERF_COUNTERS
+        perf_profiler.report(std::cout);
+        if (perf_profiler.openedThreads() > 0){
+            try {
+                perf_profiler.writeCsv(PERF_FILE);
+                std::cout << "Per-task counters written to " << PERF_FILE << std::endl;
+            } catch (const std::exception& e) {
+                std::cerr << "Warning: per-task counters not written: " << e.what() << std::endl;
+            }
+        }
+    #endif
+
+    #if TRACE
+        std::vector<std::string> trace_threads;
+        for (int i = 0; i < NUM_THREADS; i++){
+            trace_threads.push_back("worker " + std::to_string(i));
+        }
+        trace_threads.push_back("I/O");
+        try {
+            tracer.writeChromeJson(TRACE_FILE, trace_threads);
+            std::cout << "Trace: " << tracer.eventCount() << " events written to " << TRACE_FILE << std::endl;
+        } catch (const std::exception& e) {
+            std::cerr << "Warning: trace not written: " << e.what() << std::endl;
+        }
+    #endif
+
+    #if SCHEDULE_RECORD
+        ScheduleLog schedule_log = schedule_recorder.log(mat_rows, mat_cols, ALPHA, BETA);
+        try {
+            schedule_log.save(SCHEDULE_FILE);
+            std::cout << "Schedule: " << schedule_log.taskCount() << " tasks of " << NUM_THREADS
+                      << " workers written to " << SCHEDULE_FILE << std::endl;
+        } catch (const std::exception& e) {
+            std::cerr << "Warning: schedule not written: " << e.what() << std::endl;
+        }
+    #endif
+
+    #if CHECKPOINT_INTERVAL_MS
+        // The result is complete, so the checkpoints are of no further use.
+        checkpointer.remove();
+    #endif
+
+    #if FORM_Q
+        QFormation q_formation;
+        try {
+            #if OUT_OF_CORE
+                matrix_t<double> result(OOC_WORK_FILE, MapMode::ReadOnly);
+            #else
+                matrix_t<double>& result = data_matrix;
+            #endif
+            q_formation.init(result.view(), FORM_Q == 2, ALPHA, BETA, matrix_storage);
+            double q_ms = run_phase(q_formation);
+            const matrix_t<double>& q = q_formation.result();
+            q.save(Q_OUTPUT_FILE, OUTPUT_BINARY ? MatrixFormat::Binary : MatrixFormat::Text);
+            std::cout << "Q formation: " << (FORM_Q == 2 ? "full" : "thin") << " Q (" << q.cols() << " x " << q.rows()
+                      << "), " << q_formation.size() << " tasks on " << NUM_THREADS << " workers in " << q_ms
+                      << " ms, written to " << Q_OUTPUT_FILE << std::endl;
+        } catch (const std::exception& e) {
+            std::cerr << e.what() << std::endl;
+            return EXIT_FAILURE;
+        }
+    #endif
+
+    if (verify){
+        FactorizationCheck factorization_check;
+        double verify_ms = 0;
+        try {
+            #if OUT_OF_CORE
+                matrix_t<double> result(OOC_WORK_FILE, MapMode::ReadOnly);
+            #else
+                matrix_t<double>& result = data_matrix;
+            #endif
+            auto verify_start = std::chrono::high_resolution_clock::now();
+            matrix_t<double> input_copy(VERIFY_COPY_FILE, MapMode::ReadOnly);
+            #if FORM_Q
+                // The check reads the Q formed above instead of forming it again.
+                factorization_check.init(result.view(), input_copy.view(), BETA, matrix_storage, &q_formation.result());
+            #else
+                factorization_check.init(result.view(), input_copy.view(), BETA, matrix_storage);
+            #endif
+            run_phase(factorization_check);
+            verify_ms = std::chrono::duration<double, std::milli>(std::chrono::high_resolution_clock::now() - verify_start).count();
+        } catch (const std::exception& e) {
+            std::cerr << e.what() << std::endl;
+            return EXIT_FAILURE;
+        }
+
+        double backward_error = factorization_check.backwardError();
+        double orthogonality = factorization_check.orthogonalityLoss();
+        std::cout << "Verification: ||A - QR||_F / ||A||_F = " << backward_error << ", ||Q^T Q - I||_F = " << orthogonality
+                  << " (" << factorization_check.size() << " tasks on " << NUM_THREADS << " workers in " << verify_ms
+                  << " ms; copy of A written to " << VERIFY_COPY_FILE << " in " << verify_copy_ms << " ms)" << std::endl;
+        if (!(backward_error <= VERIFY_TOLERANCE && orthogonality <= VERIFY_TOLERANCE)){
+            std::cerr << "Verification failed: tolerance " << VERIFY_TOLERANCE << std::endl;
+            return EXIT_FAILURE;
+        }
+    }
 
     return 0;
 }
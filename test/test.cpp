@@ -5,8 +5,20 @@
 #include <sstream>    // Added for std::stringstream
 #include <cstdlib>    // Added for std::remove
 #include "bn2.h"     
+#include "static_schedule.h"
+#include "out_of_core.h"
+#include "checkpoint.h"
+#include "trace.h"
+#include "perf_counters.h"
+#include "run_analysis.h"
+#include "live_metrics.h"
+#include "scheduler_sim.h"
+#include "schedule_log.h"
+#include "verify.h"
+#include "form_q.h"
 
 #include <thread>
+#include <random>
 
 // Define color codes
 #define RED "\033[31m"
@@ -160,6 +172,488 @@ void test_save() {
     }
 }
 
+// Test Function 4: Binary Save and Mapped Load
+void test_binary_map() {
+    std::stringstream errors;
+
+    matrix_t<double> mat(3, 4);
+    for (int i = 0; i < 3; ++i) {
+        for (int j = 0; j < 4; ++j) {
+            mat.set(i, j, i * 10.0 + j + 0.5);
+        }
+    }
+
+    std::string filename = "test_matrix.bin";
+    mat.save(filename, MatrixFormat::Binary);
+
+    {
+        matrix_t<double> mapped(filename, MapMode::ReadOnly);
+        CHECK(mapped.is_mapped(), "Read-only load should map the file", errors);
+        CHECK(mapped.rows() == 3 && mapped.cols() == 4, "Mapped matrix should have the saved dimensions", errors);
+        CHECK(mapped.get(2, 3) == 23.5, "Mapped element (2,3) should be 23.5", errors);
+        CHECK(reinterpret_cast<uintptr_t>(mapped.data_ptr()) % MatrixFileHeader::ALIGNMENT == 0,
+              "Mapped data should be page aligned", errors);
+    }
+
+    {
+        // The filename constructor detects the binary format and maps it copy-on-write.
+        matrix_t<double> priv(filename);
+        CHECK(priv.is_mapped(), "Binary file should be mapped by the filename constructor", errors);
+        priv.set(0, 0, -1.0);
+        CHECK(priv.get(0, 0) == -1.0, "Private mapping should be writable", errors);
+
+        matrix_t<double> copy(priv);
+        CHECK(!copy.is_mapped() && copy.get(1, 2) == 12.5, "Copy of a mapped matrix should own equal data", errors);
+    }
+
+    matrix_t<double> reread(filename, MapMode::ReadOnly);
+    CHECK(reread.get(0, 0) == 0.5, "Writes to a private mapping should not reach the file", errors);
+
+    std::remove(filename.c_str());
+
+    if (errors.str().empty()) {
+        std::cout << std::left << std::setw(60) << "[MT4]. Test Binary Save and Mapped Load."
+                  << GREEN << "[Passed]" << RESET << std::endl;
+    } else {
+        std::cout << std::left << std::setw(60) << "[MT4]. Test Binary Save and Mapped Load."
+                  << RED << "[Failed]" << RESET << std::endl;
+        std::cout << errors.str()<< std::endl;
+    }
+}
+
+// Test Function 5: Chunked Text Parser
+void test_parse_text_chunks() {
+    std::stringstream errors;
+
+    // Header form: values may wrap across lines.
+    std::string with_header = "2 3\n1 2.5 -3\n4e1\n+5 6\n";
+    matrix_t<double> a;
+    a.parse_text(with_header.data(), with_header.data() + with_header.size(), 4);
+    CHECK(a.rows() == 2 && a.cols() == 3, "Header should set the dimensions", errors);
+    CHECK(a.get(0, 1) == 2.5 && a.get(0, 2) == -3.0, "First row should be parsed", errors);
+    CHECK(a.get(1, 0) == 40.0 && a.get(1, 1) == 5.0 && a.get(1, 2) == 6.0, "Second row should be parsed", errors);
+
+    // Headerless form: rows are lines, empty lines are skipped.
+    std::string headerless = "1.5 2 3\n\n4 5 6\n7 8 9\n10 11 12";
+    matrix_t<double> b;
+    b.parse_text(headerless.data(), headerless.data() + headerless.size(), 3);
+    CHECK(b.rows() == 4 && b.cols() == 3, "Headerless matrix should be 4 x 3", errors);
+    CHECK(b.get(0, 0) == 1.5 && b.get(3, 2) == 12.0, "Headerless values should be parsed in order", errors);
+
+    // Validation errors are preserved.
+    std::string ragged = "1 2 3\n4 5\n";
+    std::string short_data = "2 2\n1 2 3\n";
+    std::string extra_data = "1 2\n1 2 3\n";
+    std::string bad_value = "1 2 3\n4 x 6\n";
+    for (const std::string* input : {&ragged, &short_data, &extra_data, &bad_value}) {
+        matrix_t<double> c;
+        try {
+            c.parse_text(input->data(), input->data() + input->size(), 2);
+            errors << RED << "Failure: Malformed input should throw: " << *input << RESET << std::endl;
+            ++total_failures;
+        } catch (const std::runtime_error&) {
+            // Expected exception
+        }
+    }
+
+    if (errors.str().empty()) {
+        std::cout << std::left << std::setw(60) << "[MT5]. Test Chunked Text Parser."
+                  << GREEN << "[Passed]" << RESET << std::endl;
+    } else {
+        std::cout << std::left << std::setw(60) << "[MT5]. Test Chunked Text Parser."
+                  << RED << "[Failed]" << RESET << std::endl;
+        std::cout << errors.str()<< std::endl;
+    }
+}
+
+// Test Function 6: Parallel Text Writer
+void test_save_text() {
+    std::stringstream errors;
+
+    matrix_t<double> mat(5, 5);
+    for (int i = 0; i < 5; ++i) {
+        for (int j = 0; j < 5; ++j) {
+            mat.set(i, j, (i + 1) / 3.0 - j * 0.1);
+        }
+    }
+
+    std::string filename = "test_matrix_out.txt";
+    mat.save(filename);
+    matrix_t<double> full(filename);
+    CHECK(full.rows() == 5 && full.cols() == 5, "Saved matrix should keep its dimensions", errors);
+    bool exact = true;
+    for (int i = 0; i < 5; ++i) {
+        for (int j = 0; j < 5; ++j) {
+            exact = exact && full.get(i, j) == mat.get(i, j);
+        }
+    }
+    CHECK(exact, "Shortest round-trip formatting should reload identical values", errors);
+
+    mat.save(filename, MatrixFormat::Text, MatrixPart::UpperTriangle);
+    matrix_t<double> upper(filename);
+    CHECK(upper.get(3, 1) == 0.0 && upper.get(1, 3) == mat.get(1, 3),
+          "Upper triangle save should zero entries below the diagonal", errors);
+
+    mat.save(filename, MatrixFormat::Binary, MatrixPart::LowerTriangle);
+    matrix_t<double> lower(filename, MapMode::ReadOnly);
+    CHECK(lower.get(1, 3) == 0.0 && lower.get(3, 1) == mat.get(3, 1) && lower.get(2, 2) == mat.get(2, 2),
+          "Lower triangle binary save should keep the diagonal and below", errors);
+
+    std::remove(filename.c_str());
+
+    if (errors.str().empty()) {
+        std::cout << std::left << std::setw(60) << "[MT6]. Test Parallel Text Writer."
+                  << GREEN << "[Passed]" << RESET << std::endl;
+    } else {
+        std::cout << std::left << std::setw(60) << "[MT6]. Test Parallel Text Writer."
+                  << RED << "[Failed]" << RESET << std::endl;
+        std::cout << errors.str()<< std::endl;
+    }
+}
+
+// Test Function 7: Streaming Loader
+void test_stream_loader() {
+    std::stringstream errors;
+    std::string filename = "test_stream.txt";
+
+    auto write_file = [&](const std::string& text) {
+        std::ofstream out(filename);
+        out << text;
+    };
+
+    // Headerless: one row per line, blank lines skipped, progress reported per row.
+    write_file("1 2 3\n\n4 5 6\n7 8 9\n");
+    {
+        matrix_t<double> mat;
+        MatrixStreamLoader<double> loader;
+        loader.open(filename, mat);
+        CHECK(mat.rows() == 3 && mat.cols() == 3, "open() should size a headerless matrix", errors);
+        std::vector<int> progress;
+        loader.parse([&](int rows) { progress.push_back(rows); });
+        CHECK((progress == std::vector<int>{1, 2, 3}), "Rows should be reported as they complete", errors);
+        CHECK(mat.get(1, 0) == 4.0 && mat.get(2, 2) == 9.0, "Headerless values should be parsed in order", errors);
+    }
+
+    // Header form: values may wrap across lines.
+    write_file("2 3\n1 2\n3 4 5\n6\n");
+    {
+        matrix_t<double> mat;
+        MatrixStreamLoader<double> loader;
+        loader.open(filename, mat);
+        std::vector<int> progress;
+        loader.parse([&](int rows) { progress.push_back(rows); });
+        CHECK(mat.rows() == 2 && mat.cols() == 3, "open() should size from the header", errors);
+        CHECK((progress == std::vector<int>{1, 2}), "Wrapped rows should be reported once complete", errors);
+        CHECK(mat.get(0, 2) == 3.0 && mat.get(1, 2) == 6.0, "Wrapped values should be parsed in order", errors);
+    }
+
+    // Malformed input throws from parse().
+    for (const char* text : {"1 2 3\n4 5\n", "2 2\n1 2 3\n", "1 2\n1 2 3\n"}) {
+        write_file(text);
+        matrix_t<double> mat;
+        MatrixStreamLoader<double> loader;
+        try {
+            loader.open(filename, mat);
+            loader.parse([](int) {});
+            errors << RED << "Failure: Malformed input should throw: " << text << RESET << std::endl;
+            ++total_failures;
+        } catch (const std::runtime_error&) {
+            // Expected exception
+        }
+    }
+    std::remove(filename.c_str());
+
+    if (errors.str().empty()) {
+        std::cout << std::left << std::setw(60) << "[MT7]. Test Streaming Loader."
+                  << GREEN << "[Passed]" << RESET << std::endl;
+    } else {
+        std::cout << std::left << std::setw(60) << "[MT7]. Test Streaming Loader."
+                  << RED << "[Failed]" << RESET << std::endl;
+        std::cout << errors.str()<< std::endl;
+    }
+}
+
+// Test Function 8: Incremental Writer
+void test_matrix_writer() {
+    std::stringstream errors;
+
+    matrix_t<double> mat(7, 4);
+    for (int i = 0; i < 7; ++i) {
+        for (int j = 0; j < 4; ++j) {
+            mat.set(i, j, i * 0.1 + j);
+        }
+    }
+    auto read_file = [](const std::string& name) {
+        std::ifstream in(name, std::ios::binary);
+        return std::string(std::istreambuf_iterator<char>(in), std::istreambuf_iterator<char>());
+    };
+
+    // Text blocks written in order give the same file as save().
+    mat.save("test_writer_ref.txt", MatrixFormat::Text, MatrixPart::LowerTriangle);
+    {
+        MatrixWriter<double> writer;
+        writer.open("test_writer.txt", mat, MatrixFormat::Text, MatrixPart::LowerTriangle);
+        writer.write_rows(0, 3);
+        writer.write_rows(3, 7);
+        writer.close();
+    }
+    CHECK(read_file("test_writer.txt") == read_file("test_writer_ref.txt"),
+          "Incremental text output should match save()", errors);
+
+    // Binary blocks may arrive in any order.
+    {
+        MatrixWriter<double> writer;
+        writer.open("test_writer.bin", mat, MatrixFormat::Binary);
+        writer.write_rows(4, 7);
+        writer.write_rows(0, 4);
+        writer.close();
+        matrix_t<double> reread("test_writer.bin", MapMode::ReadOnly);
+        CHECK(reread.rows() == 7 && reread.get(5, 3) == mat.get(5, 3) && reread.get(0, 1) == mat.get(0, 1),
+              "Binary blocks should land at their rows", errors);
+    }
+
+    // Text rows out of order are rejected.
+    {
+        MatrixWriter<double> writer;
+        writer.open("test_writer.txt", mat);
+        try {
+            writer.write_rows(3, 7);
+            errors << RED << "Failure: Out of order text rows should throw" << RESET << std::endl;
+            ++total_failures;
+        } catch (const std::logic_error&) {
+            // Expected exception
+        }
+    }
+
+    std::remove("test_writer_ref.txt");
+    std::remove("test_writer.txt");
+    std::remove("test_writer.bin");
+
+    if (errors.str().empty()) {
+        std::cout << std::left << std::setw(60) << "[MT8]. Test Incremental Writer."
+                  << GREEN << "[Passed]" << RESET << std::endl;
+    } else {
+        std::cout << std::left << std::setw(60) << "[MT8]. Test Incremental Writer."
+                  << RED << "[Failed]" << RESET << std::endl;
+        std::cout << errors.str()<< std::endl;
+    }
+}
+
+// Test Function 9: Aligned and Padded Storage
+void test_padded_storage() {
+    std::stringstream errors;
+
+    MatrixStorage storage;
+    storage.pad_ld = true;
+    matrix_t<double> mat(6, 16, storage);
+    CHECK(mat.ld() == 24, "16 doubles (2 cache lines) should be padded to 3 lines", errors);
+    CHECK(reinterpret_cast<uintptr_t>(mat.data_ptr()) % 64 == 0, "Rows should start on a cache line", errors);
+    CHECK(matrix_t<double>(2, 8, storage).ld() == 8, "An odd number of lines should not be padded", errors);
+    for (int i = 0; i < 6; ++i) {
+        for (int j = 0; j < 16; ++j) {
+            mat.set(i, j, i * 100.0 + j);
+        }
+    }
+    CHECK(mat.data_ptr()[2 * 24 + 5] == 205.0, "Rows should be ld elements apart", errors);
+
+    // Copies and files drop the padding; loading into a padded matrix adds it back.
+    matrix_t<double> packed(mat);
+    matrix_t<double> dense;
+    dense = mat;
+    CHECK(packed.ld() == 24 && dense.ld() == 16 && dense.get(5, 15) == 515.0 && packed.get(3, 7) == 307.0,
+          "Copies should keep the values in their own layout", errors);
+    mat.save("test_padded.bin", MatrixFormat::Binary);
+    mat.save("test_padded.txt");
+    matrix_t<double> mapped("test_padded.bin", MapMode::ReadOnly);
+    matrix_t<double> reread("test_padded.txt", storage);
+    matrix_t<double> recopied("test_padded.bin", storage);
+    CHECK(mapped.ld() == 16 && mapped.get(4, 9) == 409.0, "Binary files should be packed", errors);
+    CHECK(reread.ld() == 24 && reread.get(5, 15) == 515.0 && reread.get(1, 0) == 100.0,
+          "Text should parse into the padded layout", errors);
+    CHECK(!recopied.is_mapped() && recopied.ld() == 24 && recopied.get(3, 3) == 303.0,
+          "Binary files should be copied into a padded layout", errors);
+    std::remove("test_padded.bin");
+    std::remove("test_padded.txt");
+
+    MatrixStorage huge;
+    huge.huge_pages = HugePages::Transparent;
+    matrix_t<double> large(4, 4, huge);
+    CHECK(reinterpret_cast<uintptr_t>(large.data_ptr()) % (size_t(1) << 21) == 0,
+          "Huge page storage should be 2 MiB aligned", errors);
+
+    if (errors.str().empty()) {
+        std::cout << std::left << std::setw(60) << "[MT9]. Test Aligned and Padded Storage."
+                  << GREEN << "[Passed]" << RESET << std::endl;
+    } else {
+        std::cout << std::left << std::setw(60) << "[MT9]. Test Aligned and Padded Storage."
+                  << RED << "[Failed]" << RESET << std::endl;
+        std::cout << errors.str()<< std::endl;
+    }
+}
+
+// Test Function 10: Strided Views
+void test_matrix_view() {
+    std::stringstream errors;
+
+    matrix_t<double> mat(6, 8);
+    for (int i = 0; i < 6; ++i) {
+        for (int j = 0; j < 8; ++j) {
+            mat.set(i, j, i * 10.0 + j);
+        }
+    }
+
+    // A trailing block shares the matrix storage.
+    matrix_view_t<double> trailing = mat.block(2, 3, 4, 5);
+    CHECK(trailing.rows() == 4 && trailing.cols() == 5 && trailing.ld() == 8, "Block should keep the leading dimension", errors);
+    CHECK(trailing.get(0, 0) == 23.0 && trailing.row(1)[4] == 37.0, "Block should start at its offset", errors);
+    trailing.set(3, 4, -1.0);
+    CHECK(mat.get(5, 7) == -1.0, "Writes through a view should reach the matrix", errors);
+    matrix_view_t<double> inner = trailing.block(1, 1, 2, 2);
+    CHECK(inner.data_ptr() == &mat(3, 4) && inner(1, 1) == 45.0, "Nested blocks should compose", errors);
+
+    matrix_view_t<const double> readonly = inner;
+    CHECK(readonly.get(0, 1) == 35.0, "Views should convert to const views", errors);
+
+    try {
+        trailing.block(1, 0, 4, 1);
+        errors << RED << "Failure: Block past the last row should throw" << RESET << std::endl;
+        ++total_failures;
+    } catch (const std::out_of_range&) {
+        // Expected exception
+    }
+    try {
+        matrix_view_t<double>(mat.data_ptr(), 2, 8, 4);
+        errors << RED << "Failure: Leading dimension below the column count should throw" << RESET << std::endl;
+        ++total_failures;
+    } catch (const std::invalid_argument&) {
+        // Expected exception
+    }
+
+    // Tasks can be laid out over a view alone.
+    TaskTable table;
+    table.init(2, 2, 2, 2, trailing);
+    CHECK(table.getTask(1, 1) != nullptr && table.getTask(1, 1)->col_end == 4, "Task bounds should follow the view rows", errors);
+
+    if (errors.str().empty()) {
+        std::cout << std::left << std::setw(60) << "[MT10]. Test Strided Views."
+                  << GREEN << "[Passed]" << RESET << std::endl;
+    } else {
+        std::cout << std::left << std::setw(60) << "[MT10]. Test Strided Views."
+                  << RED << "[Failed]" << RESET << std::endl;
+        std::cout << errors.str()<< std::endl;
+    }
+}
+
+// Test Function 11: 64-bit Element Offsets
+void test_large_offsets() {
+    std::stringstream errors;
+
+    // 2.5e9 elements: row * cols overflows int. Only the touched pages are committed.
+    const int rows = 50000, cols = 50000;
+    try {
+        matrix_t<char> big(rows, cols);
+        big.set(rows - 1, cols - 1, 'x');
+        big(rows - 1, 0) = 'y';
+        CHECK(&big(rows - 1, cols - 1) - big.data_ptr() == static_cast<long long>(rows) * cols - 1,
+              "Offsets past 2^31 should not wrap", errors);
+        CHECK(big.get(rows - 1, cols - 1) == 'x' && big.view().row(rows - 1)[0] == 'y',
+              "Elements past 2^31 should read back", errors);
+    } catch (const std::bad_alloc&) {
+        std::cout << "(Skipping large allocation: not enough address space)" << std::endl;
+    }
+
+    // Binary headers whose dimensions do not fit the index types are rejected.
+    MatrixFileHeader header = matrix_t<double>(1, 1).binary_header();
+    header.rows = uint64_t(3) << 30;
+    {
+        std::ofstream out("test_large.bin", std::ios::binary);
+        out.write(reinterpret_cast<const char*>(&header), sizeof(header));
+    }
+    try {
+        matrix_t<double> mapped("test_large.bin", MapMode::ReadOnly);
+        errors << RED << "Failure: Oversized header should throw" << RESET << std::endl;
+        ++total_failures;
+    } catch (const std::runtime_error& e) {
+        CHECK(std::string(e.what()).find("exceed") != std::string::npos, "Oversized header should be reported", errors);
+    }
+    std::remove("test_large.bin");
+
+    if (errors.str().empty()) {
+        std::cout << std::left << std::setw(60) << "[MT11]. Test 64-bit Element Offsets."
+                  << GREEN << "[Passed]" << RESET << std::endl;
+    } else {
+        std::cout << std::left << std::setw(60) << "[MT11]. Test 64-bit Element Offsets."
+                  << RED << "[Failed]" << RESET << std::endl;
+        std::cout << errors.str()<< std::endl;
+    }
+}
+
+// Test Function 12: Kernels on a Block at an Offset
+void test_block_factorization() {
+    std::stringstream errors;
+
+    // A 23x31 block at (5, 7) of a 40x50 allocation, and the same data on its own.
+    const int m = 23, n = 31, r0 = 5, c0 = 7;
+    matrix_t<double> host(40, 50);
+    std::mt19937 rng(11);
+    std::uniform_real_distribution<double> dist(-1.0, 1.0);
+    for (int i = 0; i < host.rows(); ++i) {
+        for (int j = 0; j < host.cols(); ++j) {
+            host.set(i, j, dist(rng));
+        }
+    }
+    const matrix_t<double> pristine = host;
+    matrix_t<double> standalone(m, n);
+    for (int i = 0; i < m; ++i) {
+        for (int j = 0; j < n; ++j) {
+            standalone.set(i, j, host(r0 + i, c0 + j));
+        }
+    }
+
+    TaskTable table;
+    table.init((m + 3) / 4, (m + 1) / 2, 2, 4, m);
+    TaskGraph graph(table, n);
+    auto factor = [&](matrix_view_t<double> rows) {
+        global_up_array.assign(m, 0.0);
+        global_b_array.assign(m, 0.0);
+        for (size_t id : graph.topologicalOrder()) {
+            const TaskNode& t = graph.node(id);
+            if (t.type == 1) {
+                complete_task1(rows, m, n, t.row_start, t.row_end, t.col_start, t.col_end);
+            } else {
+                complete_task2(rows, m, n, t.row_start, t.row_end, t.col_start, t.col_end);
+            }
+        }
+    };
+    factor(host.block(r0, c0, m, n));
+    factor(standalone.view());
+
+    bool same = true, untouched = true, changed = false;
+    for (int i = 0; i < host.rows(); ++i) {
+        for (int j = 0; j < host.cols(); ++j) {
+            bool inside = i >= r0 && i < r0 + m && j >= c0 && j < c0 + n;
+            if (inside) {
+                same = same && host(i, j) == standalone(i - r0, j - c0);
+                changed = changed || host(i, j) != pristine(i, j);
+            } else {
+                untouched = untouched && host(i, j) == pristine(i, j);
+            }
+        }
+    }
+    CHECK(changed, "The block should be factored in place", errors);
+    CHECK(same, "Factoring a block should match factoring the same data alone", errors);
+    CHECK(untouched, "Elements outside the block should be unchanged", errors);
+
+    if (errors.str().empty()) {
+        std::cout << std::left << std::setw(60) << "[MT12]. Test Kernels on an Offset Block."
+                  << GREEN << "[Passed]" << RESET << std::endl;
+    } else {
+        std::cout << std::left << std::setw(60) << "[MT12]. Test Kernels on an Offset Block."
+                  << RED << "[Failed]" << RESET << std::endl;
+        std::cout << errors.str()<< std::endl;
+    }
+}
+
 // ========================= DependencyTable Tests =========================
 
 // Test Function 4: Default Constructor
@@ -1023,6 +1517,67 @@ void test_queue_multi_threaded() {
 }
 
 
+// Test Case 6: Contention counters (only populated when built with QUEUE_STATS).
+void test_queue_stats() {
+    std::stringstream errors;
+    CircularQueueMtx<int> queue(2);
+    CircularQueueAtomic<int> atomic_queue(2);
+
+    queue.push(1);
+    queue.push(2);
+    queue.push(3);           // fails, queue is full
+    queue.pop();
+    atomic_queue.push(1);
+    atomic_queue.pop();
+    atomic_queue.pop();      // finds the queue empty
+
+    QueueStats stats = queue.stats();
+    QueueStats atomic_stats = atomic_queue.stats();
+#if QUEUE_STATS
+    CHECK(stats.pushes == 2, "Two pushes should be recorded", errors);
+    CHECK(stats.push_failures == 1, "One push failure should be recorded", errors);
+    CHECK(stats.pops == 1, "One pop should be recorded", errors);
+    CHECK(stats.high_water == 2, "High-water mark should be 2", errors);
+    CHECK(stats.lock_acquisitions == 4, "Every operation should take the lock once", errors);
+    CHECK(atomic_stats.pushes == 1 && atomic_stats.pops == 1, "Atomic queue should record one push and one pop", errors);
+    CHECK(atomic_stats.empty_pops == 1, "Atomic queue should record one empty pop", errors);
+    queue.reset_stats();
+    CHECK(queue.stats().pushes == 0, "reset_stats should clear the counters", errors);
+
+    // More threads alive at once than one chunk of slots: none may share a slot.
+    CircularQueueMtx<int> shared(1024);
+    std::vector<std::thread> threads;
+    for (int t = 0; t < 300; ++t) {
+        threads.emplace_back([&shared] {
+            for (int k = 0; k < 1000; ++k) {
+                shared.push(k);
+                shared.pop();
+            }
+        });
+    }
+    for (auto& thread : threads) {
+        thread.join();
+    }
+    QueueStats shared_stats = shared.stats();
+    CHECK(shared_stats.pushes == 300000 && shared_stats.lock_acquisitions == 600000,
+          "Counters of concurrent threads should not lose updates", errors);
+#else
+    CHECK(stats.pushes == 0 && stats.lock_acquisitions == 0, "Counters should stay zero without QUEUE_STATS", errors);
+    CHECK(atomic_stats.pushes == 0 && atomic_stats.cas_failures == 0, "Counters should stay zero without QUEUE_STATS", errors);
+#endif
+
+    if (errors.str().empty()) {
+         std::cout << std::left << std::setw(60)
+                   << "[QueueTest6] Test Contention Counters"
+                   << GREEN << "[Passed]" << RESET << std::endl;
+    } else {
+         std::cout << std::left << std::setw(60)
+                   << "[QueueTest6] Test Contention Counters"
+                   << RED << "[Failed]" << RESET << std::endl;
+         std::cout << errors.str();
+    }
+}
+
 // ==================== CircularQueueAtomic Tests ========================= //
 
 // Test 1: Verify that a new queue is empty and its size is zero.
@@ -1227,57 +1782,1482 @@ void test_atomic_queue_push_and_pop() {
     }
 }
 
-int main(int argc, char *argv[]) {
-    std::cout << "Inside Test.\n" << std::endl;
-
-    std::cout << YELLOW << "Starting matrix_t Test Cases." << RESET << std::endl;
+// ======================== MultiQueue Tests ============================== //
 
-    // Run matrix_t test functions
-    test_operator_access();
-    test_get_set();
-    test_save();
+// Test Case 1: A single shard behaves like a strict priority queue.
+void test_multiqueue_single_shard_order() {
+    std::stringstream errors;
+    MultiQueue<int> queue(1);
 
-    std::cout << YELLOW << "\nStarting DependencyTable Test Cases." << RESET << std::endl;
+    CHECK(queue.empty(), "MultiQueue should be empty initially", errors);
+    int values[] = {5, 1, 9, 3, 7};
+    for (int v : values) {
+         CHECK(queue.push(v), "push should succeed", errors);
+    }
+    CHECK(queue.size() == 5, "MultiQueue size should be 5 after five pushes", errors);
 
-    // Run DependencyTable test functions
-    test_default_constructor();
-    test_parameterized_constructor();
-    test_init();
-    test_move_constructor();
-    test_move_assignment();
-    test_get_set_dependency();
-    test_operator_overloading();
-    test_out_of_bounds();
+    int expected[] = {9, 7, 5, 3, 1};
+    for (int e : expected) {
+         auto result = queue.pop();
+         CHECK(result.has_value() && result.value() == e, "pop should return elements by descending priority", errors);
+    }
+    CHECK(!queue.pop().has_value(), "pop on empty MultiQueue should return nullopt", errors);
 
-    std::cout << YELLOW << "\nStarting DependencyTableAtomic Test Cases." << RESET << std::endl;
+    if (errors.str().empty()) {
+         std::cout << std::left << std::setw(60)
+                   << "[MultiQueueTest1] Test Single Shard Priority Order"
+                   << GREEN << "[Passed]" << RESET << std::endl;
+    } else {
+         std::cout << std::left << std::setw(60)
+                   << "[MultiQueueTest1] Test Single Shard Priority Order"
+                   << RED << "[Failed]" << RESET << std::endl;
+         std::cout << errors.str();
+    }
+}
 
-    // Run DependencyTableAtomic test functions
-    test_default_constructor_atomic();
-    test_parameterized_constructor_atomic();
-    test_init_atomic();
-    test_move_constructor_atomic();
-    test_move_assignment_atomic();
-    test_get_set_dependency_atomic();
-    test_operator_overloading_atomic();
-    test_out_of_bounds_atomic();
+// Test Case 2: Every pushed element comes back exactly once across many shards.
+void test_multiqueue_no_loss() {
+    std::stringstream errors;
+    MultiQueue<int> queue(8);
+    const int num_elements = 500;
 
-    std::cout << YELLOW << "\nStarting CircularQueueMtx Test Cases." << RESET << std::endl;
+    for (int i = 0; i < num_elements; ++i) {
+         queue.push(i);
+    }
+    std::vector<int> seen(num_elements, 0);
+    while (auto item = queue.pop()) {
+         seen[item.value()]++;
+    }
+    CHECK(std::all_of(seen.begin(), seen.end(), [](int c) { return c == 1; }),
+          "Every element should be popped exactly once", errors);
+    CHECK(queue.empty(), "MultiQueue should be empty after draining", errors);
 
-    test_queue_empty_and_size();
-    test_queue_push_pop_fifo();
-    test_queue_push_front_pop_back();
-    test_queue_full();
-    test_queue_multi_threaded();
+    if (errors.str().empty()) {
+         std::cout << std::left << std::setw(60)
+                   << "[MultiQueueTest2] Test No Element Loss"
+                   << GREEN << "[Passed]" << RESET << std::endl;
+    } else {
+         std::cout << std::left << std::setw(60)
+                   << "[MultiQueueTest2] Test No Element Loss"
+                   << RED << "[Failed]" << RESET << std::endl;
+         std::cout << errors.str();
+    }
+}
 
-    std::cout << YELLOW << "\nStarting CircularQueueAtomic Test Cases." << RESET << std::endl;
+// Test Case 3: Multi-threaded producers and consumers.
+void test_multiqueue_multi_threaded() {
+    std::stringstream errors;
+    MultiQueue<int> queue(8);
+    const int num_elements = 1000;
+    std::atomic<int> produced{0};
+    std::atomic<int> consumed{0};
 
-    test_atomic_queue_empty_and_size();
+    auto producer = [&](int offset) {
+         for (int i = 0; i < num_elements; ++i) {
+              queue.push(offset + i);
+              produced.fetch_add(1, std::memory_order_relaxed);
+         }
+    };
+    auto consumer = [&]() {
+         while (consumed.load(std::memory_order_relaxed) < 2 * num_elements) {
+              if (queue.pop().has_value()) {
+                   consumed.fetch_add(1, std::memory_order_relaxed);
+              } else {
+                   std::this_thread::yield();
+              }
+         }
+    };
+
+    std::thread p1(producer, 0), p2(producer, num_elements);
+    std::thread c1(consumer), c2(consumer);
+    p1.join(); p2.join(); c1.join(); c2.join();
+
+    CHECK(produced.load() == 2 * num_elements, "Produced count should equal 2 * num_elements", errors);
+    CHECK(consumed.load() == 2 * num_elements, "Consumed count should equal 2 * num_elements", errors);
+    CHECK(queue.empty(), "MultiQueue should be empty at the end", errors);
+
+    if (errors.str().empty()) {
+         std::cout << std::left << std::setw(60)
+                   << "[MultiQueueTest3] Test Multi-threaded Operations"
+                   << GREEN << "[Passed]" << RESET << std::endl;
+    } else {
+         std::cout << std::left << std::setw(60)
+                   << "[MultiQueueTest3] Test Multi-threaded Operations"
+                   << RED << "[Failed]" << RESET << std::endl;
+         std::cout << errors.str();
+    }
+}
+
+// ========================= TaskTable Tests ============================== //
+
+// Test Case 1: Lazy descriptors match the eagerly built table.
+void test_task_table_lazy_matches_eager() {
+    std::stringstream errors;
+
+    matrix_t<double> mat(45, 50);
+    int total_task_rows = 5;   // ceil(45 / 10)
+    int total_task_cols = 9;   // ceil(45 / 5)
+
+    TaskTable eager(total_task_rows, total_task_cols, 5, 10, mat);
+    TaskTable lazy(total_task_rows, total_task_cols, 5, 10, mat, true);
+
+    CHECK(!eager.isLazy(), "Default TaskTable should be eager", errors);
+    CHECK(lazy.isLazy(), "TaskTable built with lazy=true should be lazy", errors);
+
+    for (int i = 0; i < total_task_rows; ++i) {
+        for (int j = 0; j < total_task_cols; ++j) {
+            Task* e = eager.getTask(i, j);
+            Task* l = lazy.getTask(i, j);
+            if (!e || !l) {
+                CHECK(e == l, "Lazy and eager tables should agree on empty cells", errors);
+                lazy.releaseTask(l);
+                continue;
+            }
+            CHECK(e->type == l->type, "Task type should match", errors);
+            CHECK(e->enq_nxt_t1 == l->enq_nxt_t1, "enq_nxt_t1 flag should match", errors);
+            CHECK(e->row_start == l->row_start && e->row_end == l->row_end, "Row bounds should match", errors);
+            CHECK(e->col_start == l->col_start && e->col_end == l->col_end, "Column bounds should match", errors);
+            CHECK(e->chunk_idx_i == l->chunk_idx_i && e->chunk_idx_j == l->chunk_idx_j, "Chunk indices should match", errors);
+            lazy.releaseTask(l);
+        }
+    }
+
+    CHECK(lazy.liveTasks() == 0, "All lazy tasks should have been released", errors);
+    CHECK(lazy.peakLiveTasks() == 1, "Only one lazy task should have been alive at a time", errors);
+
+    if (errors.str().empty()) {
+         std::cout << std::left << std::setw(60)
+                   << "[TaskTableTest1] Test Lazy Matches Eager"
+                   << GREEN << "[Passed]" << RESET << std::endl;
+    } else {
+         std::cout << std::left << std::setw(60)
+                   << "[TaskTableTest1] Test Lazy Matches Eager"
+                   << RED << "[Failed]" << RESET << std::endl;
+         std::cout << errors.str();
+    }
+}
+
+// Test Case 2: DependencyFrontier answers like a full table for in-order completion.
+void test_dependency_frontier() {
+    std::stringstream errors;
+
+    DependencyFrontier frontier(3, 4);
+    CHECK(frontier.rows() == 3 && frontier.cols() == 4, "Frontier should report its dimensions", errors);
+    CHECK(!frontier.getDependency(1, 0), "Nothing should be done initially", errors);
+
+    frontier.setDependency(1, 0, true);
+    frontier.setDependency(1, 1, true);
+    CHECK(frontier.getDependency(1, 0), "(1,0) should be done", errors);
+    CHECK(frontier.getDependency(1, 1), "(1,1) should be done", errors);
+    CHECK(!frontier.getDependency(1, 2), "(1,2) should not be done", errors);
+    CHECK(!frontier.getDependency(0, 0), "Other rows should be unaffected", errors);
+    CHECK(frontier.rowProgress(1) == 2, "Row 1 should have two completed tasks", errors);
+
+    try {
+        frontier(3, 0);
+        errors << RED << "Failure: Accessing (3,0) should throw." << RESET << std::endl;
+        ++total_failures;
+    } catch (const std::out_of_range&) {
+        // Expected exception
+    }
+
+    if (errors.str().empty()) {
+         std::cout << std::left << std::setw(60)
+                   << "[TaskTableTest2] Test Dependency Frontier"
+                   << GREEN << "[Passed]" << RESET << std::endl;
+    } else {
+         std::cout << std::left << std::setw(60)
+                   << "[TaskTableTest2] Test Dependency Frontier"
+                   << RED << "[Failed]" << RESET << std::endl;
+         std::cout << errors.str();
+    }
+}
+
+// ==================== TerminationDetector Tests ========================= //
+
+// Test Case 1: Only the last completion reports termination.
+void test_termination_detector_count() {
+    std::stringstream errors;
+    TerminationDetector detector(3);
+
+    CHECK(!detector.finished(), "Detector should not be finished initially", errors);
+    CHECK(!detector.complete(), "First completion should not be the last", errors);
+    CHECK(!detector.complete(), "Second completion should not be the last", errors);
+    CHECK(detector.remaining() == 1, "One task should remain", errors);
+    CHECK(detector.complete(), "Third completion should be the last", errors);
+    CHECK(detector.finished(), "Detector should be finished after the last completion", errors);
+    CHECK(detector.wait_for(std::chrono::milliseconds(0)), "wait_for should return immediately once finished", errors);
+
+    if (errors.str().empty()) {
+         std::cout << std::left << std::setw(60)
+                   << "[TerminationTest1] Test Completion Count"
+                   << GREEN << "[Passed]" << RESET << std::endl;
+    } else {
+         std::cout << std::left << std::setw(60)
+                   << "[TerminationTest1] Test Completion Count"
+                   << RED << "[Failed]" << RESET << std::endl;
+         std::cout << errors.str();
+    }
+}
+
+// Test Case 2: Waiting threads are woken by the last completion.
+void test_termination_detector_wakeup() {
+    std::stringstream errors;
+    const int num_tasks = 1000;
+    TerminationDetector detector(num_tasks);
+    std::atomic<int> woken{0};
+
+    auto waiter = [&]() {
+         detector.wait();
+         woken.fetch_add(1, std::memory_order_relaxed);
+    };
+    auto worker = [&]() {
+         for (int i = 0; i < num_tasks / 2; ++i) {
+              detector.complete();
+         }
+    };
+
+    std::thread w1(waiter), w2(waiter);
+    std::thread t1(worker), t2(worker);
+    t1.join(); t2.join(); w1.join(); w2.join();
+
+    CHECK(detector.finished(), "Detector should be finished", errors);
+    CHECK(detector.remaining() == 0, "No task should remain", errors);
+    CHECK(woken.load() == 2, "Both waiters should have been woken", errors);
+
+    if (errors.str().empty()) {
+         std::cout << std::left << std::setw(60)
+                   << "[TerminationTest2] Test Waiter Wakeup"
+                   << GREEN << "[Passed]" << RESET << std::endl;
+    } else {
+         std::cout << std::left << std::setw(60)
+                   << "[TerminationTest2] Test Waiter Wakeup"
+                   << RED << "[Failed]" << RESET << std::endl;
+         std::cout << errors.str();
+    }
+}
+
+// ================== TaskGraph / StaticSchedule Tests ==================== //
+
+// Test Case 1: The graph covers the task table and its order respects every edge.
+void test_task_graph_structure() {
+    std::stringstream errors;
+
+    matrix_t<double> mat(45, 50);
+    TaskTable table(5, 9, 5, 10, mat);
+    TaskGraph graph(table, mat.cols());
+
+    CHECK(graph.size() == table.taskCount(), "Graph should have one node per task", errors);
+
+    std::vector<size_t> position(graph.size());
+    const std::vector<size_t>& order = graph.topologicalOrder();
+    CHECK(order.size() == graph.size(), "Topological order should contain every task", errors);
+    for (size_t k = 0; k < order.size(); ++k) {
+         position[order[k]] = k;
+    }
+    bool ordered = true;
+    for (size_t id = 0; id < graph.size(); ++id) {
+         graph.forEachPredecessor(id, [&](size_t pred) { ordered = ordered && position[pred] < position[id]; });
+    }
+    CHECK(ordered, "Every predecessor should come first in the topological order", errors);
+    CHECK(graph.predecessorCount(graph.id(0, 0)) == 0, "Task (0,0) should have no predecessor", errors);
+    CHECK(graph.predecessorCount(graph.id(3, 2)) == 2, "An update should wait for its panel and its left neighbour", errors);
+
+    if (errors.str().empty()) {
+         std::cout << std::left << std::setw(60)
+                   << "[StaticScheduleTest1] Test Task Graph Structure"
+                   << GREEN << "[Passed]" << RESET << std::endl;
+    } else {
+         std::cout << std::left << std::setw(60)
+                   << "[StaticScheduleTest1] Test Task Graph Structure"
+                   << RED << "[Failed]" << RESET << std::endl;
+         std::cout << errors.str();
+    }
+}
+
+// Test Case 2: A built schedule covers every task once and survives a save/load round trip.
+void test_static_schedule_round_trip() {
+    std::stringstream errors;
+
+    matrix_t<double> mat(100, 120);
+    TaskTable table(10, 10, 10, 10, mat);
+    TaskGraph graph(table, mat.cols());
+
+    StaticSchedule schedule;
+    schedule.build(graph, 4);
+
+    size_t total = 0;
+    for (int t = 0; t < schedule.threads(); ++t) {
+         total += schedule.threadTasks(t).size();
+    }
+    CHECK(total == graph.size(), "Schedule should contain every task once", errors);
+    CHECK(std::abs(schedule.simulate(graph) - schedule.predictedMakespan()) < 1e-6 * schedule.predictedMakespan(),
+          "Replaying the lists should reproduce the predicted makespan", errors);
+    CHECK(schedule.predictedMakespan() >= graph.totalCost() / 4, "Makespan cannot beat perfect balance", errors);
+
+    std::string filename = "test_schedule.txt";
+    schedule.save(filename, graph);
+    StaticSchedule loaded;
+    CHECK(loaded.load(filename, graph, 4), "Schedule should load for the same shape", errors);
+    CHECK(!loaded.load(filename, graph, 8), "Schedule should not load for another thread count", errors);
+    for (int t = 0; t < 4; ++t) {
+         CHECK(loaded.threadTasks(t) == schedule.threadTasks(t), "Loaded lists should match the saved ones", errors);
+    }
+    std::remove(filename.c_str());
+
+    // A corrupt cache file is rebuilt and rewritten, with a warning.
+    std::string cache_dir = "test_schedule_cache";
+    std::filesystem::create_directories(cache_dir);
+    std::ofstream(StaticSchedule::cacheFileName(cache_dir, graph, 4)) << "static_schedule 1\n100 120 10 10 4 " << graph.size() << "\n3 0 1";
+    std::stringstream warnings;
+    StaticSchedule cached;
+    CHECK(!cached.loadOrBuild(cache_dir, graph, 4, warnings), "A corrupt cache file should not be used", errors);
+    CHECK(!warnings.str().empty(), "A corrupt cache file should be reported", errors);
+    CHECK(cached.threadTasks(0) == schedule.threadTasks(0), "The schedule should be rebuilt", errors);
+    warnings.str("");
+    CHECK(cached.loadOrBuild(cache_dir, graph, 4, warnings) && warnings.str().empty(),
+          "The rebuilt schedule should have been cached", errors);
+    std::filesystem::remove_all(cache_dir);
+
+    if (errors.str().empty()) {
+         std::cout << std::left << std::setw(60)
+                   << "[StaticScheduleTest2] Test Build and Save/Load"
+                   << GREEN << "[Passed]" << RESET << std::endl;
+    } else {
+         std::cout << std::left << std::setw(60)
+                   << "[StaticScheduleTest2] Test Build and Save/Load"
+                   << RED << "[Failed]" << RESET << std::endl;
+         std::cout << errors.str();
+    }
+}
+
+// ========================= OutOfCore Tests =========================
+
+// Test Case 1: Tiles read and written through a TileStore land at the right rows of the file.
+void test_tile_store_round_trip() {
+    std::stringstream errors;
+
+    matrix_t<double> mat(25, 7);
+    for (int i = 0; i < 25; ++i) {
+        for (int j = 0; j < 7; ++j) {
+            mat.set(i, j, i * 100.0 + j);
+        }
+    }
+    std::string filename = "test_tiles.bin";
+    mat.save(filename, MatrixFormat::Binary);
+
+    {
+        TileStore store(filename, 10);
+        CHECK(store.tileCount() == 3, "25 rows in tiles of 10 should give 3 tiles", errors);
+        CHECK(store.tileBegin(0) == 0 && store.tileEnd(0) == 11 && store.tileBegin(2) == 21 && store.tileEnd(2) == 25,
+              "Tile bounds should follow the task row bounds", errors);
+        CHECK(store.tileOf(0) == 0 && store.tileOf(10) == 0 && store.tileOf(11) == 1 && store.tileOf(24) == 2,
+              "tileOf should invert the tile bounds", errors);
+
+        std::vector<double> buf(store.maxTileElements());
+        store.read(1, buf.data());
+        CHECK(buf[0] == 1100.0 && buf[9 * 7 + 6] == 2006.0, "Tile 1 should hold rows 11 to 20", errors);
+        buf[0] = -1.0;
+        store.write(1, buf.data());
+        CHECK(store.bytesRead() == 10 * 7 * sizeof(double) && store.bytesWritten() == store.bytesRead(),
+              "Transferred bytes should be counted", errors);
+    }
+
+    matrix_t<double> reread(filename, MapMode::ReadOnly);
+    CHECK(reread.get(11, 0) == -1.0 && reread.get(10, 6) == 1006.0 && reread.get(21, 0) == 2100.0,
+          "Only the written tile should change in the file", errors);
+    std::remove(filename.c_str());
+
+    if (errors.str().empty()) {
+         std::cout << std::left << std::setw(60)
+                   << "[OutOfCoreTest1] Test TileStore Round Trip"
+                   << GREEN << "[Passed]" << RESET << std::endl;
+    } else {
+         std::cout << std::left << std::setw(60)
+                   << "[OutOfCoreTest1] Test TileStore Round Trip"
+                   << RED << "[Failed]" << RESET << std::endl;
+         std::cout << errors.str();
+    }
+}
+
+// Test Case 2: Any execution order of the plan finds every task's tiles in its buffers.
+void test_out_of_core_plan() {
+    std::stringstream errors;
+
+    const int shapes[][3] = {{10, 10, 5}, {20, 10, 4}, {20, 10, 6}, {30, 10, 5}, {10, 10, 30}};
+    for (const auto& shape : shapes) {
+        int beta = shape[0], alpha = shape[1], slots = shape[2];
+        int rows = 205;
+        int task_rows = (rows + beta - 1) / beta;
+        int task_cols = (rows + alpha - 1) / alpha;
+        TaskTable table;
+        table.init(task_rows, task_cols, alpha, beta, rows);
+        TaskGraph graph(table, rows);
+
+        OutOfCorePlan plan;
+        plan.build(graph, slots, 2);
+        CHECK(plan.slots() <= slots, "Plan should stay within its buffers", errors);
+        CHECK(plan.storeCount() == static_cast<size_t>(task_rows), "Every tile should be stored once", errors);
+
+        for (unsigned seed = 1; seed <= 3; ++seed) {
+            std::mt19937 rng(seed);
+            std::vector<size_t> pending(plan.size());
+            std::vector<size_t> ready;
+            for (size_t id = 0; id < plan.size(); ++id) {
+                pending[id] = plan.predecessorCount(id);
+                if (pending[id] == 0) {
+                    ready.push_back(id);
+                }
+            }
+
+            std::vector<int> slot_tile(plan.slots(), -1);
+            std::vector<char> done(graph.size(), 0);
+            size_t executed = 0;
+            bool resident = true, ordered = true;
+            while (!ready.empty()) {
+                size_t pick = rng() % ready.size();
+                size_t id = ready[pick];
+                ready[pick] = ready.back();
+                ready.pop_back();
+                executed++;
+
+                const OocNode& node = plan.node(id);
+                if (node.kind == OocNode::Load) {
+                    slot_tile[node.slot] = node.tile;
+                } else if (node.kind == OocNode::Store) {
+                    resident = resident && slot_tile[node.slot] == node.tile;
+                } else {
+                    const TaskNode& task = graph.node(node.task);
+                    resident = resident && slot_tile[node.slot] == task.i && node.tile == task.i
+                        && slot_tile[node.pivot_slot] == node.pivot_tile && node.pivot_tile == task.j / (beta / alpha);
+                    ordered = ordered && (task.j == 0 || done[graph.id(task.i, task.j - 1)])
+                        && (task.type == 1 || done[graph.id(task.j / (beta / alpha), task.j)]);
+                    done[node.task]++;
+                }
+
+                plan.forEachSuccessor(id, [&](size_t next) {
+                    if (--pending[next] == 0) {
+                        ready.push_back(next);
+                    }
+                });
+            }
+            CHECK(executed == plan.size(), "Every node should become ready", errors);
+            CHECK(std::count(done.begin(), done.end(), 1) == static_cast<long>(graph.size()),
+                  "Every task should run exactly once", errors);
+            CHECK(resident, "Tasks should only see the tiles they need in their buffers", errors);
+            CHECK(ordered, "Tasks should run after their row predecessor and panel", errors);
+        }
+    }
+
+    OutOfCorePlan small;
+    try {
+        TaskTable table;
+        table.init(3, 3, 10, 10, 25);
+        small.build(TaskGraph(table, 25), 2, 2);
+        errors << RED << "Failure: Too few buffers should throw" << RESET << std::endl;
+        ++total_failures;
+    } catch (const std::invalid_argument&) {
+        // Expected exception
+    }
+
+    if (errors.str().empty()) {
+         std::cout << std::left << std::setw(60)
+                   << "[OutOfCoreTest2] Test Plan Residency and Order"
+                   << GREEN << "[Passed]" << RESET << std::endl;
+    } else {
+         std::cout << std::left << std::setw(60)
+                   << "[OutOfCoreTest2] Test Plan Residency and Order"
+                   << RED << "[Failed]" << RESET << std::endl;
+         std::cout << errors.str();
+    }
+}
+
+// ========================= Checkpoint Tests =========================
+
+// Test Case 1: Checkpoints rewrite only task rows that progressed and load back what was saved.
+void test_checkpoint_round_trip() {
+    std::stringstream errors;
+
+    const int rows = 25, cols = 7, alpha = 5, beta = 10;
+    matrix_t<double> mat(rows, cols);
+    for (int i = 0; i < rows; ++i) {
+        for (int j = 0; j < cols; ++j) {
+            mat.set(i, j, i * 100.0 + j);
+        }
+    }
+    TaskTable table;
+    table.init(3, 5, alpha, beta, rows);
+    std::vector<double> up(rows, 0.5), b(rows, 2.0);
+    std::string dir = "test_checkpoint";
+    const uint64_t row_bytes = cols * sizeof(double);
+
+    Checkpointer checkpointer;
+    checkpointer.init(dir, mat, table);
+    checkpointer.taskDone(0);
+    checkpointer.save(up, b);       // Both matrix files start empty, so the first
+    checkpointer.save(up, b);       // two checkpoints write every row.
+    CHECK(checkpointer.bytesWritten() == 2 * rows * row_bytes, "First checkpoints should write every row", errors);
+
+    {
+        std::lock_guard<std::mutex> lock(checkpointer.rowLock(1));
+        mat.set(15, 3, -1.0);
+        checkpointer.taskDone(1);
+    }
+    up[3] = 7.0;
+    checkpointer.save(up, b);
+    CHECK(checkpointer.bytesWritten() == (2 * rows + 10) * row_bytes, "Only task row 1 should be rewritten", errors);
+    CHECK(checkpointer.checkpointCount() == 3, "Three checkpoints should be counted", errors);
+
+    CheckpointData data;
+    CHECK(Checkpointer::load(dir, alpha, beta, data), "Checkpoint should be found", errors);
+    CHECK(data.sequence == 2 && data.progress == std::vector<int>({1, 1, 0}),
+          "Loaded counters should match the last checkpoint", errors);
+    // Only panel 0 (pivots 0 to 5, in task row 0) is in the cut.
+    std::vector<double> up_cut(rows, 0.0), b_cut(rows, 0.0);
+    std::copy(up.begin(), up.begin() + 6, up_cut.begin());
+    std::copy(b.begin(), b.begin() + 6, b_cut.begin());
+    CHECK(data.up == up_cut && data.b == b_cut, "Loaded reflector arrays should hold the panels in the cut", errors);
+    {
+        matrix_t<double> snapshot(data.matrix_file, MapMode::ReadOnly);
+        bool same = snapshot.rows() == rows && snapshot.cols() == cols;
+        for (int i = 0; same && i < rows; ++i) {
+            for (int j = 0; j < cols; ++j) {
+                same = same && snapshot.get(i, j) == mat.get(i, j);
+            }
+        }
+        CHECK(same, "Loaded matrix should match the last checkpoint", errors);
+    }
+
+    try {
+        Checkpointer::load(dir, alpha, 20, data);
+        errors << RED << "Failure: Mismatched block sizes should throw" << RESET << std::endl;
+        ++total_failures;
+    } catch (const std::runtime_error&) {
+        // Expected exception
+    }
+
+    checkpointer.remove();
+    CHECK(!Checkpointer::load(dir, alpha, beta, data), "Removed checkpoint should not be found", errors);
+
+    if (errors.str().empty()) {
+         std::cout << std::left << std::setw(60)
+                   << "[CheckpointTest1] Test Incremental Save and Load"
+                   << GREEN << "[Passed]" << RESET << std::endl;
+    } else {
+         std::cout << std::left << std::setw(60)
+                   << "[CheckpointTest1] Test Incremental Save and Load"
+                   << RED << "[Failed]" << RESET << std::endl;
+         std::cout << errors.str();
+    }
+}
+
+// Test Case 2: A cut that leaves most rows behind resumes into queues that hold all its
+// tasks, and scheduling from there completes every remaining task.
+void test_checkpoint_resume_rows_behind() {
+    std::stringstream errors;
+
+    // The 1200 x 1200 shape with ALPHA = BETA = 10: panels 0 to 40 are done, the rows below
+    // row 41 have not started, so every one of them parks its updates 1 to 40.
+    const int task_rows = 120, alpha = 10, beta = 10;
+    TaskTable table;
+    table.init(task_rows, task_rows, alpha, beta, 1200);
+    DependencyTable deps;
+    deps.init(task_rows, task_rows);
+    std::vector<int> progress(task_rows, 0);
+    for (int i = 0; i <= 41; ++i) {
+        progress[i] = std::min(i + 1, 41);
+    }
+
+    CircularQueueMtx<Task*> ready_queue(table.taskCount()), wait_queue(table.taskCount());
+    bool lost = false;
+    size_t ready = 0, parked = 0;
+    int64_t completed = resume_tasks(progress, table, deps,
+                                     [&](Task* t){ lost |= !ready_queue.push(t); ready++; },
+                                     [&](Task* t){ lost |= !wait_queue.push(t); parked++; });
+    CHECK(completed == 41 * 42 / 2 + 41, "Completed tasks of the cut should be counted", errors);
+    CHECK(ready == 79 && parked == 78 * 40, "The next task of every row should be ready, later updates parked", errors);
+    CHECK(parked > 1024, "The cut should park more tasks than a fixed 1024-slot queue holds", errors);
+
+    // Single-threaded model of the dynamic scheduler's release rules.
+    auto push_ready = [&](Task* t){ lost |= !ready_queue.push(t); };
+    size_t stalled = 0;
+    while (!lost && stalled <= wait_queue.size()) {
+        if (auto t = ready_queue.pop()) {
+            int i = (*t)->chunk_idx_i, j = (*t)->chunk_idx_j;
+            deps.setDependency(i, j, true);
+            completed++;
+            if ((*t)->type == 1) {
+                for (int k = i + 1; k < task_rows; ++k) {
+                    if (j == 0 || deps.getDependency(k, j - 1)) {
+                        push_ready(table.getTask(k, j));
+                    } else {
+                        lost |= !wait_queue.push(table.getTask(k, j));
+                    }
+                }
+                if (i == task_rows - 1 && j + 1 < task_rows && j + 1 < i + 1) {
+                    push_ready(table.getTask(i, j + 1));
+                }
+            } else if ((*t)->enq_nxt_t1 && j + 1 < task_rows && !deps.getDependency(j + 1, j + 1)) {
+                push_ready(table.getTask(j + 1, j + 1));
+            }
+            stalled = 0;
+        } else if (auto w = wait_queue.pop()) {
+            if ((*w)->chunk_idx_j == 0 || deps.getDependency((*w)->chunk_idx_i, (*w)->chunk_idx_j - 1)) {
+                push_ready(*w);
+                stalled = 0;
+            } else {
+                lost |= !wait_queue.push(*w);
+                stalled++;
+            }
+        } else {
+            break;
+        }
+    }
+    CHECK(!lost, "No push should fail", errors);
+    CHECK(completed == (int64_t)table.taskCount(), "Every task should complete after the resume", errors);
+
+    if (errors.str().empty()) {
+         std::cout << std::left << std::setw(60)
+                   << "[CheckpointTest2] Test Resume With Rows Behind"
+                   << GREEN << "[Passed]" << RESET << std::endl;
+    } else {
+         std::cout << std::left << std::setw(60)
+                   << "[CheckpointTest2] Test Resume With Rows Behind"
+                   << RED << "[Failed]" << RESET << std::endl;
+         std::cout << errors.str();
+    }
+}
+
+// ========================= Tracer Tests =========================
+
+// Test Case 1: Events recorded per thread come out as named tracks of complete slices.
+void test_tracer_chrome_json() {
+    std::stringstream errors;
+
+    Tracer tracer;
+    tracer.init(2, 4);
+    tracer.start();
+    uint64_t t0 = tracer.startTicks();
+    std::thread worker([&]() {
+        uint64_t start = trace_ticks();
+        tracer.buffer(1).record({t0, start, trace_ticks(), 3, 1, 0, TraceEvent::Update});
+    });
+    worker.join();
+    uint64_t start = trace_ticks();
+    tracer.buffer(0).record({t0, start, trace_ticks(), 0, 0, -1, TraceEvent::Panel});
+    for (int k = 0; k < 8; ++k) {
+        tracer.buffer(0).record({t0, t0, t0, k, k, 1, TraceEvent::TileLoad});     // Past the reservation
+    }
+    tracer.stop();
+    CHECK(tracer.eventCount() == 10, "All recorded events should be counted", errors);
+
+    std::string filename = "test_trace.json";
+    tracer.writeChromeJson(filename, {"worker 0"});
+    std::ifstream in(filename);
+    std::stringstream content;
+    content << in.rdbuf();
+    std::string json = content.str();
+    auto count = [&](const std::string& needle) {
+        size_t n = 0;
+        for (size_t pos = json.find(needle); pos != std::string::npos; pos = json.find(needle, pos + 1)) {
+            ++n;
+        }
+        return n;
+    };
+    CHECK(json.find("\"traceEvents\":[") != std::string::npos && json.find("]}") != std::string::npos,
+          "Trace should be a traceEvents object", errors);
+    CHECK(count("\"ph\":\"M\"") == 2 && count("\"ph\":\"X\"") == 10, "Trace should hold 2 tracks and 10 slices", errors);
+    CHECK(json.find("{\"name\":\"worker 0\"}") != std::string::npos && json.find("{\"name\":\"thread 1\"}") != std::string::npos,
+          "Tracks should be named, with a default for missing names", errors);
+    CHECK(json.find("\"name\":\"update (3,1)\",\"cat\":\"update\",\"ph\":\"X\",\"pid\":0,\"tid\":1") != std::string::npos,
+          "Slices should land on the track of the recording thread", errors);
+    CHECK(json.find("\"released_by\":-1") != std::string::npos, "Releasing thread should be reported", errors);
+    CHECK(count(",\n") == 11, "Events should be comma separated", errors);
+    std::remove(filename.c_str());
+
+    if (errors.str().empty()) {
+         std::cout << std::left << std::setw(60)
+                   << "[TracerTest1] Test Chrome Trace Export"
+                   << GREEN << "[Passed]" << RESET << std::endl;
+    } else {
+         std::cout << std::left << std::setw(60)
+                   << "[TracerTest1] Test Chrome Trace Export"
+                   << RED << "[Failed]" << RESET << std::endl;
+         std::cout << errors.str();
+    }
+}
+
+// ========================= PerfCounters Tests =========================
+
+// Test Case 1: Counters attribute deltas to tasks, and events the kernel refuses are skipped
+// without failing. Software events stand in for hardware ones, which VMs often lack.
+void test_perf_counters() {
+    std::stringstream errors;
+
+    const std::vector<PerfEventSpec> events = {
+        {"task_clock", PERF_TYPE_SOFTWARE, PERF_COUNT_SW_TASK_CLOCK},
+        {"bogus", PERF_TYPE_HARDWARE, 0xffffff},
+        {"page_faults", PERF_TYPE_SOFTWARE, PERF_COUNT_SW_PAGE_FAULTS},
+    };
+    PerfProfiler profiler;
+    profiler.init(2, 8, events);
+    bool opened = profiler.open(0);
+    CHECK(!profiler.unavailableReason().empty() && profiler.unavailableReason().find("bogus") == 0,
+          "The refused event should be reported", errors);
+
+    std::vector<double> work(1 << 16, 1.0);
+    for (int task = 0; task < 3; ++task) {
+        profiler.thread(0).start();
+        for (double& x : work) {
+            x = std::sqrt(x + task);
+        }
+        profiler.thread(0).stop(task == 0 ? 1 : 2, task, 0, 100.0);
+    }
+    profiler.thread(1).start();     // Never opened: recording is a no-op
+    profiler.thread(1).stop(1, 0, 0, 1.0);
+    profiler.close(0);
+
+    size_t tasks;
+    double flops;
+    profiler.total(0, tasks, flops);
+    std::stringstream report;
+    profiler.report(report);
+    if (opened) {
+        PerfSample sum = profiler.total(2, tasks, flops);
+        CHECK(profiler.openedThreads() == 1, "One thread should have counters", errors);
+        CHECK(tasks == 2 && flops == 200.0, "Updates should be aggregated by type", errors);
+        CHECK(sum[0] > 0 && sum[1] == 0, "Counted events should advance, refused ones read 0", errors);
+        profiler.total(2, tasks, flops, {0});
+        CHECK(tasks == 2, "Totals of a counted event should cover the measured tasks", errors);
+        profiler.total(2, tasks, flops, {0, 1});
+        CHECK(tasks == 0 && flops == 0.0, "Totals should leave out threads that did not count an event", errors);
+        CHECK(report.str().find("update 2 tasks") != std::string::npos, "Report should list the updates", errors);
+
+        std::string filename = "test_perf.csv";
+        profiler.writeCsv(filename);
+        std::ifstream in(filename);
+        std::string header, line;
+        std::getline(in, header);
+        std::getline(in, line);
+        CHECK(header == "thread,i,j,type,flops,task_clock,bogus,page_faults", "CSV header should name the events", errors);
+        CHECK(line.rfind("0,0,0,1,100,", 0) == 0 && line.find(",,") != std::string::npos,
+              "CSV should hold one line per task with the refused event empty", errors);
+        std::remove(filename.c_str());
+    } else {
+        CHECK(tasks == 0, "Nothing should be recorded without counters", errors);
+        CHECK(report.str().find("unavailable") != std::string::npos, "Report should say counters are unavailable", errors);
+    }
+
+    if (errors.str().empty()) {
+         std::cout << std::left << std::setw(60)
+                   << "[PerfTest1] Test Per-Task Counters"
+                   << GREEN << "[Passed]" << RESET << std::endl;
+    } else {
+         std::cout << std::left << std::setw(60)
+                   << "[PerfTest1] Test Per-Task Counters"
+                   << RED << "[Failed]" << RESET << std::endl;
+         std::cout << errors.str();
+    }
+}
+
+// ========================= RunAnalysis Tests =========================
+
+// Test Case 1: Critical path, work and the dominant bound from given task durations.
+void test_run_analysis() {
+    std::stringstream errors;
+
+    // Three task rows with ALPHA == BETA: panels take 10 ms, updates 1 ms. The longest
+    // chain is (0,0) (1,0) (1,1) (2,1) (2,2).
+    TaskTable table;
+    table.init(3, 3, 10, 10, 30);
+    TaskGraph graph(table, 30);
+    std::vector<double> task_ms(graph.size());
+    for (size_t id = 0; id < graph.size(); ++id) {
+        task_ms[id] = graph.node(id).type == 1 ? 10.0 : 1.0;
+    }
+    using PhaseMs = RunAnalysis::PhaseMs;
+
+    RunAnalysis analysis;
+    analysis.analyze(graph, task_ms, 35.0, {PhaseMs{20, 1, 1, 13}, PhaseMs{13, 1, 1, 20}}, 2);
+    CHECK(analysis.workMs() == 33.0 && analysis.criticalPathMs() == 32.0, "Work and critical path should match", errors);
+    CHECK(analysis.criticalPathTasks() == 5 && analysis.criticalPathPanels() == 3, "Critical path should hold 5 tasks, 3 panels", errors);
+    CHECK(analysis.lowerBoundMs() == 32.0, "Lower bound should be the critical path", errors);
+    CHECK(analysis.bound() == RunAnalysis::Bound::CriticalPath, "Panel chain should dominate", errors);
+
+    analysis.analyze(graph, task_ms, 36.0, {PhaseMs{33, 1, 1, 1}}, 4);
+    CHECK(analysis.bound() == RunAnalysis::Bound::Work, "A single busy worker should be work bound", errors);
+
+    std::vector<double> short_ms(graph.size(), 0.1);
+    analysis.analyze(graph, short_ms, 10.0, {PhaseMs{0.3, 6, 2, 1.7}, PhaseMs{0.4, 6, 2, 1.6}}, 2);
+    CHECK(analysis.bound() == RunAnalysis::Bound::Scheduler, "Queue-heavy workers should be scheduler bound", errors);
+    analysis.analyze(graph, short_ms, 10.0, {PhaseMs{0.6, 0.2, 0.1, 9.1}, PhaseMs{0.1, 0.2, 0.1, 9.6}}, 2);
+    CHECK(analysis.bound() == RunAnalysis::Bound::Imbalance, "Idle workers should be imbalance bound", errors);
+    analysis.analyze(graph, short_ms, 10.0, {PhaseMs{0.3, 6, 2, 1.7}, PhaseMs{0.4, 6, 2, 1.6}}, 1);
+    CHECK(analysis.bound() == RunAnalysis::Bound::Work, "Oversubscribed workers should be work bound", errors);
+    analysis.analyze(graph, short_ms, 10.0, {PhaseMs{0.6, 0.2, 0.1, 9.1}, PhaseMs{0.1, 0.2, 0.1, 9.6}}, 2);
+    CHECK(std::abs(analysis.share(WorkerPhase::Idle) - 0.935) < 1e-9, "Phase shares should cover all workers", errors);
+
+    std::stringstream report;
+    analysis.report(report);
+    CHECK(report.str().find("Bound: load imbalance") != std::string::npos, "Report should name the bound", errors);
+
+    PhaseTimer timer;
+    timer.start(WorkerPhase::Queue);
+    timer.enter(WorkerPhase::Compute);
+    std::this_thread::sleep_for(std::chrono::milliseconds(2));
+    timer.enter(WorkerPhase::Idle);
+    timer.stop();
+    CHECK(timer.get(WorkerPhase::Compute) > timer.get(WorkerPhase::Queue) && timer.get(WorkerPhase::Dependency) == 0,
+          "Phase timer should charge time to the running phase", errors);
+    timer.start(WorkerPhase::Queue);
+    std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    timer.enter(WorkerPhase::Idle, WorkerPhase::Idle);
+    timer.stop();
+    CHECK(timer.get(WorkerPhase::Queue) == 0 && timer.get(WorkerPhase::Idle) > 0,
+          "Phase timer should charge time to the given phase", errors);
+
+    if (errors.str().empty()) {
+         std::cout << std::left << std::setw(60)
+                   << "[AnalysisTest1] Test Critical Path and Bounds"
+                   << GREEN << "[Passed]" << RESET << std::endl;
+    } else {
+         std::cout << std::left << std::setw(60)
+                   << "[AnalysisTest1] Test Critical Path and Bounds"
+                   << RED << "[Failed]" << RESET << std::endl;
+         std::cout << errors.str();
+    }
+}
+
+// ========================= LiveMetrics Tests =========================
+
+// Test Case 1: Counter sums, the progress line and the sampler with a SIGUSR1 dump.
+void test_live_metrics() {
+    std::stringstream errors;
+
+    LiveMetrics metrics;
+    metrics.init(2, 4, 100.0, "ready", "wait");
+    metrics.thread(-1).push(MetricsQueue::Ready);
+    metrics.thread(0).pop(MetricsQueue::Ready);
+    metrics.thread(0).push(MetricsQueue::Wait);
+    metrics.thread(1).push(MetricsQueue::Wait);
+    metrics.thread(1).pop(MetricsQueue::Wait);
+    metrics.thread(0).taskStart();
+    metrics.thread(0).taskDone(1, 20.0);
+    metrics.thread(1).taskStart();
+    metrics.thread(1).taskDone(2, 30.0);
+    metrics.thread(1).taskStart();
+
+    MetricsSample s = metrics.sample();
+    CHECK(s.tasks[0] == 1 && s.tasks[1] == 1 && s.flops == 50.0, "Sample should sum the tasks of all threads", errors);
+    CHECK(s.depth[0] == 0 && s.depth[1] == 1, "Queue depths should be pushes minus pops", errors);
+    CHECK(s.busy == 1, "Only the worker inside a task should be busy", errors);
+
+    MetricsSample prev = s;
+    prev.seconds = s.seconds - 1.0;
+    prev.tasks = {0, 0};
+    std::stringstream line;
+    metrics.writeSample(line, s, prev);
+    CHECK(line.str().find("50.0 % done (2/4 tasks), 1.0 panels/s, 1.0 updates/s, ready queue 0, wait queue 1, "
+                          "1 busy / 1 idle workers") != std::string::npos, "Progress line should hold the rates", errors);
+
+    // The sampler takes SIGUSR1 with sigtimedwait, so every thread must block it.
+    LiveMetrics::blockSignal();
+    std::stringstream out;
+    std::thread sampler([&]() { metrics.run(out, std::chrono::milliseconds(20)); });
+    std::this_thread::sleep_for(std::chrono::milliseconds(60));
+    kill(getpid(), SIGUSR1);
+    std::this_thread::sleep_for(std::chrono::milliseconds(40));
+    metrics.stop();
+    sampler.join();
+    std::string printed = out.str();
+    CHECK(printed.find("worker 1: busy, 0 panels, 1 updates") != std::string::npos, "SIGUSR1 should dump every worker", errors);
+    CHECK(std::count(printed.begin(), printed.end(), '\n') >= 5, "Sampler should print periodically", errors);
+
+    if (errors.str().empty()) {
+         std::cout << std::left << std::setw(60)
+                   << "[MetricsTest1] Test Live Metrics Sampler"
+                   << GREEN << "[Passed]" << RESET << std::endl;
+    } else {
+         std::cout << std::left << std::setw(60)
+                   << "[MetricsTest1] Test Live Metrics Sampler"
+                   << RED << "[Failed]" << RESET << std::endl;
+         std::cout << errors.str();
+    }
+}
+
+// ========================= SchedulerSimulator Tests =========================
+
+// Test Case 1: Simulated makespans against the work and critical path bounds.
+void test_scheduler_simulator() {
+    std::stringstream errors;
+
+    // Same graph as AnalysisTest1: panels take 10 ns, updates 1 ns, work 33, critical path 32.
+    TaskTable table;
+    table.init(3, 3, 10, 10, 30);
+    TaskGraph graph(table, 30);
+    SimCostModel model;
+    model.ns_per_flop = {0.0, 0.0};
+    model.task_ns = {10.0, 1.0};
+    model.queue_ns = 0.0;
+    model.steal_ns = 0.0;
+    SchedulerSimulator simulator(graph, model);
+    CHECK(simulator.workNs() == 33.0 && simulator.criticalPathNs() == 32.0, "Work and critical path should match", errors);
+
+    for (SimPolicy policy : {SimPolicy::Fifo, SimPolicy::Rotation, SimPolicy::CriticalPath, SimPolicy::WorkStealing}) {
+        SimResult one = simulator.run(policy, 1);
+        SimResult many = simulator.run(policy, 8);
+        CHECK(one.makespan_ns == 33.0, std::string(simPolicyName(policy)) + ": one worker should run the work serially", errors);
+        CHECK(many.makespan_ns >= 32.0 && many.makespan_ns <= 33.0,
+              std::string(simPolicyName(policy)) + ": makespan should lie between the bounds", errors);
+    }
+    SimResult critical = simulator.run(SimPolicy::CriticalPath, 8);
+    CHECK(critical.makespan_ns == 32.0 && std::abs(critical.utilization() - 33.0 / (8 * 32.0)) < 1e-12,
+          "Critical-path priority should reach the critical path", errors);
+    CHECK(parseSimPolicy("stealing") == SimPolicy::WorkStealing, "Policy names should round-trip", errors);
+
+    // Shared queue operations are serialized: two workers popping at once wait for each other.
+    model.queue_ns = 5.0;
+    SchedulerSimulator slow(graph, model);
+    CHECK(slow.run(SimPolicy::Fifo, 1).makespan_ns > 33.0, "Queue operations should add to the makespan", errors);
+
+    // push_rotated moves the previous tail to the second slot once more than three are queued.
+    SimFifoQueue rotation(true);
+    for (size_t id = 0; id < 5; ++id) {
+        rotation.push(id, 0, id == 4);
+    }
+    std::vector<size_t> order;
+    size_t id;
+    bool stolen;
+    while (rotation.pop(0, id, stolen)) {
+        order.push_back(id);
+    }
+    CircularQueueMtx<size_t> real(16);
+    for (size_t k = 0; k < 4; ++k) {
+        real.push(k);
+    }
+    real.push_rotated(4);
+    std::vector<size_t> real_order;
+    while (auto k = real.pop()) {
+        real_order.push_back(*k);
+    }
+    CHECK(order == real_order && (order == std::vector<size_t>{0, 3, 2, 1, 4}),
+          "Rotation should match CircularQueueMtx::push_rotated", errors);
+
+    if (errors.str().empty()) {
+         std::cout << std::left << std::setw(60)
+                   << "[SimulatorTest1] Test Scheduling Policy Simulator"
+                   << GREEN << "[Passed]" << RESET << std::endl;
+    } else {
+         std::cout << std::left << std::setw(60)
+                   << "[SimulatorTest1] Test Scheduling Policy Simulator"
+                   << RED << "[Failed]" << RESET << std::endl;
+         std::cout << errors.str();
+    }
+}
+
+// ========================= ScheduleLog Tests =========================
+
+// Test Case 1: Recording, saving, replaying through StaticSchedule and comparing logs.
+void test_schedule_log() {
+    std::stringstream errors;
+
+    TaskTable table;
+    table.init(3, 3, 10, 10, 30);
+    TaskGraph graph(table, 30);
+
+    // Two workers: worker 0 runs the panels and the first update row, worker 1 the rest,
+    // each in a topological order.
+    ScheduleRecorder recorder;
+    recorder.init(2, 8);
+    recorder.start();
+    uint64_t tick = trace_ticks();
+    for (size_t id : graph.topologicalOrder()) {
+        const TaskNode& t = graph.node(id);
+        recorder.record(t.type == 1 || t.i == 1 ? 0 : 1, t.i, t.j, tick, tick + 1);
+        tick += 2;
+    }
+    recorder.stop();
+    ScheduleLog log = recorder.log(30, 30, 10, 10);
+    CHECK(log.taskCount() == graph.size() && log.tasks(0).size() == 4, "Log should hold every task per worker", errors);
+
+    const std::string filename = "test_schedule.log";
+    log.save(filename);
+    ScheduleLog loaded = ScheduleLog::load(filename);
+    std::remove(filename.c_str());
+    CHECK(loaded.threads() == 2 && loaded.taskCount() == log.taskCount() && loaded.matches(graph),
+          "Loaded log should match the saved one", errors);
+
+    StaticSchedule replay;
+    replay.assign(graph, loaded.threadLists(graph));
+    bool same = replay.threads() == 2;
+    for (int t = 0; t < 2 && same; ++t) {
+        for (size_t k = 0; k < loaded.tasks(t).size(); ++k) {
+            const ScheduleEntry& e = loaded.tasks(t)[k];
+            same = same && replay.threadTasks(t)[k] == graph.id(e.i, e.j);
+        }
+    }
+    CHECK(same, "Replay should keep every worker's recorded order", errors);
+
+    ScheduleLog partial(30, 30, 10, 10, 1);
+    partial.add(0, {0, 0, 0.0, 1.0});
+    bool threw = false;
+    try {
+        partial.threadLists(graph);
+    } catch (const std::runtime_error&) {
+        threw = true;
+    }
+    CHECK(threw, "A log missing tasks should not be replayed", errors);
+
+    // The same tasks, (2, 2) slower, with worker 1's two tasks swapped and the last moved to worker 0.
+    ScheduleLog other(30, 30, 10, 10, 2);
+    for (int t = 0; t < 2; ++t) {
+        for (const ScheduleEntry& e : log.tasks(t)) {
+            other.add(t, {e.i, e.j, e.start_us, e.end_us + (e.i == 2 && e.j == 2 ? 5.0 : 0.0)});
+        }
+    }
+    std::vector<ScheduleEntry> swapped = other.tasks(1);
+    std::swap(swapped[0], swapped[1]);
+    ScheduleLog reordered(30, 30, 10, 10, 2);
+    for (const ScheduleEntry& e : other.tasks(0)) reordered.add(0, e);
+    reordered.add(0, swapped.back());
+    for (size_t k = 0; k + 1 < swapped.size(); ++k) reordered.add(1, swapped[k]);
+    ScheduleDiff diff;
+    diff.compare(reordered, log);
+    CHECK(diff.movedTasks() == 1 && diff.reorderedTasks() == 1, "Diff should count moved and reordered tasks", errors);
+    std::stringstream report;
+    diff.report(report, 1);
+    CHECK(report.str().find("(2, 2)") != std::string::npos, "Report should name the slowed task", errors);
+
+    if (errors.str().empty()) {
+         std::cout << std::left << std::setw(60)
+                   << "[ScheduleLogTest1] Test Schedule Recording and Replay"
+                   << GREEN << "[Passed]" << RESET << std::endl;
+    } else {
+         std::cout << std::left << std::setw(60)
+                   << "[ScheduleLogTest1] Test Schedule Recording and Replay"
+                   << RED << "[Failed]" << RESET << std::endl;
+         std::cout << errors.str();
+    }
+}
+
+// ========================= FactorizationCheck Tests =========================
+
+// Test Case 1: Residual and orthogonality of a factorization, in two task orders.
+void test_factorization_check() {
+    std::stringstream errors;
+
+    // 23 rows (columns of A) of length 31, task rows of 4 and task columns of 2.
+    const int m = 23, n = 31;
+    matrix_t<double> original(m, n);
+    std::mt19937 rng(7);
+    std::uniform_real_distribution<double> dist(-1.0, 1.0);
+    for (int i = 0; i < m; ++i) {
+        for (int j = 0; j < n; ++j) {
+            original.set(i, j, dist(rng));
+        }
+    }
+    TaskTable table;
+    table.init((m + 3) / 4, (m + 1) / 2, 2, 4, m);
+    TaskGraph graph(table, n);
+    matrix_t<double> factored = original;
+    global_up_array.assign(m, 0.0);
+    global_b_array.assign(m, 0.0);
+    for (size_t id : graph.topologicalOrder()) {
+        const TaskNode& t = graph.node(id);
+        if (t.type == 1) {
+            complete_task1(factored.view(), m, n, t.row_start, t.row_end, t.col_start, t.col_end);
+        } else {
+            complete_task2(factored.view(), m, n, t.row_start, t.row_end, t.col_start, t.col_end);
+        }
+    }
+
+    FactorizationCheck check;
+    check.init(factored.view(), original.view(), 4);
+    size_t edges = 0, preds = 0;
+    for (size_t id = 0; id < check.size(); ++id) {
+        preds += check.predecessorCount(id);
+        check.forEachSuccessor(id, [&](size_t next) {
+            edges++;
+            CHECK(next > id && check.node(next).kind == VerifyNode::Gram, "Edges should lead to later Gram tiles", errors);
+        });
+    }
+    CHECK(check.size() == 6 + 6 + 21 && edges == preds, "Tasks and edges should cover the blocks", errors);
+
+    for (size_t id = 0; id < check.size(); ++id) {
+        check.run(id);
+    }
+    double backward = check.backwardError(), orthogonality = check.orthogonalityLoss();
+    CHECK(backward < 1e-14 && orthogonality < 1e-13, "An exact factorization should verify", errors);
+
+    // Another valid order gives the same sums: FormQ and Gram tiles backwards, residuals last.
+    FactorizationCheck reordered;
+    reordered.init(factored.view(), original.view(), 4);
+    for (size_t id = reordered.size(); id-- > 0;) {
+        if (reordered.node(id).kind == VerifyNode::FormQ) reordered.run(id);
+    }
+    for (size_t id = reordered.size(); id-- > 0;) {
+        if (reordered.node(id).kind != VerifyNode::FormQ) reordered.run(id);
+    }
+    CHECK(reordered.backwardError() == backward && reordered.orthogonalityLoss() == orthogonality,
+          "Results should not depend on the task order", errors);
+
+    // A perturbed copy of A shows up in the backward error only.
+    matrix_t<double> perturbed = original;
+    perturbed.set(17, 3, perturbed(17, 3) + 1e-3);
+    FactorizationCheck wrong;
+    wrong.init(factored.view(), perturbed.view(), 4);
+    for (size_t id = 0; id < wrong.size(); ++id) {
+        wrong.run(id);
+    }
+    CHECK(wrong.backwardError() > 1e-5 && wrong.orthogonalityLoss() == orthogonality,
+          "A wrong A should fail the residual check", errors);
+
+    bool threw = false;
+    try {
+        matrix_t<double> wide(n, m);
+        check.init(wide.view(), wide.view(), 4);
+    } catch (const std::invalid_argument&) {
+        threw = true;
+    }
+    CHECK(threw, "More rows than columns should be rejected", errors);
+
+    if (errors.str().empty()) {
+         std::cout << std::left << std::setw(60)
+                   << "[VerifyTest1] Test Factorization Check"
+                   << GREEN << "[Passed]" << RESET << std::endl;
+    } else {
+         std::cout << std::left << std::setw(60)
+                   << "[VerifyTest1] Test Factorization Check"
+                   << RED << "[Failed]" << RESET << std::endl;
+         std::cout << errors.str();
+    }
+}
+
+// ========================= Timing Tests =========================
+
+// Test Case 1: Statistics, repetition control and clocks of measure_exec_time.
+void test_measure_exec_time() {
+    std::stringstream errors;
+
+    TimingResult stats = TimingResult::summarize({5, 1, 4, 2, 3});
+    CHECK(stats.min_ns == 1 && stats.median_ns == 3 && stats.max_ns == 5 && stats.mean_ns == 3,
+          "Order statistics of the samples should be exact", errors);
+    CHECK(stats.p95_ns == 5 && stats.p99_ns == 5 && stats.percentile(40) == 2, "Percentiles should use the nearest rank", errors);
+    CHECK(std::abs(stats.stddev_ns - std::sqrt(2.5)) < 1e-12
+          && std::abs(stats.ci95_ns - 2.776 * std::sqrt(2.5) / std::sqrt(5.0)) < 1e-12,
+          "Standard deviation and confidence interval should use n - 1", errors);
+
+    // Warmup, batches and setup: every sample runs setup once and the call batch times.
+    int calls = 0, setups = 0;
+    TimingOptions options;
+    options.warmup = 3;
+    options.max_reps = 10;
+    options.batch = 4;
+    options.setup = [&]() { setups++; };
+    TimingResult counted = measure_exec_time(options, [&](int step) { calls += step; }, 1);
+    CHECK(counted.reps() == 10 && calls == 13 * 4 && setups == 13, "Warmup and batches should run as configured", errors);
+    CHECK(counted.min_ns >= 0 && counted.min_ns <= counted.median_ns && counted.median_ns <= counted.p95_ns
+          && counted.p95_ns <= counted.p99_ns && counted.p99_ns <= counted.max_ns, "Statistics should be ordered", errors);
+
+    // A steady call meets a loose confidence target long before max_reps.
+    TimingOptions confident;
+    confident.min_reps = 5;
+    confident.max_reps = 100000;
+    confident.rel_ci = 0.5;
+    TimingResult converged = measure_exec_time(confident, []() {
+        std::this_thread::sleep_for(std::chrono::microseconds(200));
+    });
+    CHECK(converged.converged && converged.reps() >= 5 && converged.reps() < 100000
+          && converged.ci95_ns <= 0.5 * converged.mean_ns, "The confidence target should stop the sampling", errors);
+
+    // The time budget stops sampling; each clock measures a 1 ms sleep as at least 1 ms.
+    for (TimingClock clock : {TimingClock::Steady, TimingClock::MonotonicRaw, TimingClock::Tsc}) {
+        TimingOptions budget;
+        budget.max_reps = 100000;
+        budget.time_budget_ms = 20;
+        budget.clock = clock;
+        TimingResult slept = measure_exec_time(budget, []() {
+            std::this_thread::sleep_for(std::chrono::milliseconds(1));
+        });
+        CHECK(slept.reps() >= 1 && slept.reps() <= 21 && !slept.converged && slept.clock == clock,
+              std::string(timing_clock_name(clock)) + ": the time budget should stop the sampling", errors);
+        CHECK(slept.min_ns >= 0.95e6 && slept.median_ns < 1e9,
+              std::string(timing_clock_name(clock)) + ": a 1 ms sleep should measure about 1 ms", errors);
+    }
+
+    if (errors.str().empty()) {
+         std::cout << std::left << std::setw(60)
+                   << "[TimingTest1] Test measure_exec_time Statistics"
+                   << GREEN << "[Passed]" << RESET << std::endl;
+    } else {
+         std::cout << std::left << std::setw(60)
+                   << "[TimingTest1] Test measure_exec_time Statistics"
+                   << RED << "[Failed]" << RESET << std::endl;
+         std::cout << errors.str();
+    }
+}
+
+// ========================= QFormation Tests =========================
+
+// Test Case 1: Thin and full Q from the stored reflectors, against the factorization check.
+void test_q_formation() {
+    std::stringstream errors;
+
+    // 23 rows (columns of A) of length 31, task rows of 4 and task columns of 2.
+    const int m = 23, n = 31;
+    matrix_t<double> original(m, n);
+    std::mt19937 rng(11);
+    std::uniform_real_distribution<double> dist(-1.0, 1.0);
+    for (int i = 0; i < m; ++i) {
+        for (int j = 0; j < n; ++j) {
+            original.set(i, j, dist(rng));
+        }
+    }
+    TaskTable table;
+    table.init((m + 3) / 4, (m + 1) / 2, 2, 4, m);
+    TaskGraph graph(table, n);
+    matrix_t<double> factored = original;
+    global_up_array.assign(m, 0.0);
+    global_b_array.assign(m, 0.0);
+    for (size_t id : graph.topologicalOrder()) {
+        const TaskNode& t = graph.node(id);
+        if (t.type == 1) {
+            complete_task1(factored.view(), m, n, t.row_start, t.row_end, t.col_start, t.col_end);
+        } else {
+            complete_task2(factored.view(), m, n, t.row_start, t.row_end, t.col_start, t.col_end);
+        }
+    }
+
+    QFormation thin, full;
+    thin.init(factored.view(), false, 2, 4);
+    full.init(factored.view(), true, 2, 4);
+    // Block i of the thin Q takes pivot blocks 0 .. min(4i + 3, 22) / 2; the full Q adds two
+    // blocks past row 23 that take all 12 pivot blocks.
+    CHECK(thin.size() == 2 + 4 + 6 + 8 + 10 + 12 && full.size() == thin.size() + 12 + 12,
+          "Tasks should follow the tiling", errors);
+    size_t edges = 0, preds = 0;
+    for (size_t id = 0; id < full.size(); ++id) {
+        preds += full.predecessorCount(id);
+        full.forEachSuccessor(id, [&](size_t next) {
+            edges++;
+            CHECK(full.node(next).i == full.node(id).i && full.node(next).j == full.node(id).j - 1,
+                  "A task should release the next pivot block of its column block", errors);
+        });
+    }
+    CHECK(edges == preds && edges == full.size() - 8, "Every column block should form one chain", errors);
+
+    // The chains in any interleaving: blocks in reverse, one task of each in turn.
+    std::vector<size_t> next;
+    for (size_t id = 0; id < full.size(); ++id) {
+        if (full.predecessorCount(id) == 0) {
+            next.push_back(id);
+        }
+    }
+    for (size_t done = 0; done < full.size();) {
+        for (auto it = next.rbegin(); it != next.rend(); ++it) {
+            if (*it == SIZE_MAX) continue;
+            size_t id = *it;
+            full.run(id);
+            done++;
+            *it = SIZE_MAX;
+            full.forEachSuccessor(id, [&](size_t succ) { *it = succ; });
+        }
+    }
+    for (size_t id = 0; id < thin.size(); ++id) {
+        thin.run(id);
+    }
+
+    // The thin Q is the leading columns of the full Q and the one FactorizationCheck forms.
+    FactorizationCheck check;
+    check.init(factored.view(), original.view(), 4);
+    for (size_t id = 0; id < check.size(); ++id) {
+        check.run(id);
+    }
+    const matrix_t<double>& q = thin.result();
+    const matrix_t<double>& f = full.result();
+    bool same_thin = q.rows() == m && f.rows() == n, same_check = true;
+    for (int c = 0; c < m; ++c) {
+        for (int k = 0; k < n; ++k) {
+            same_thin = same_thin && q(c, k) == f(c, k);
+            same_check = same_check && q(c, k) == check.thinQ()(c, k);
+        }
+    }
+    CHECK(same_thin && same_check, "The thin Q should match the full Q and the check's Q", errors);
+
+    // Given the formed Q, the check skips its FormQ tasks and gets the same results.
+    FactorizationCheck reused;
+    reused.init(factored.view(), original.view(), 4, MatrixStorage(), &full.result());
+    for (size_t id = 0; id < reused.size(); ++id) {
+        CHECK(reused.node(id).kind != VerifyNode::FormQ, "A check given Q should not form it", errors);
+        reused.run(id);
+    }
+    CHECK(reused.size() == check.size() - 6 && reused.backwardError() == check.backwardError()
+          && reused.orthogonalityLoss() == check.orthogonalityLoss() && reused.thinQ()(m - 1, n - 1) == q(m - 1, n - 1),
+          "A check given Q should match one that forms it", errors);
+
+    // Q^T Q = I for the full Q, and Q R = A.
+    double orthogonality = 0, residual = 0;
+    for (int a = 0; a < n; ++a) {
+        for (int b = 0; b < n; ++b) {
+            double dot = 0;
+            for (int k = 0; k < n; ++k) dot += f(a, k) * f(b, k);
+            orthogonality = std::max(orthogonality, std::abs(dot - (a == b)));
+        }
+    }
+    for (int r = 0; r < m; ++r) {
+        for (int k = 0; k < n; ++k) {
+            double sum = 0;
+            for (int c = 0; c <= r; ++c) sum += q(c, k) * factored(r, c);
+            residual = std::max(residual, std::abs(sum - original(r, k)));
+        }
+    }
+    CHECK(orthogonality < 1e-14 && residual < 1e-14, "Q should be orthogonal and reproduce A", errors);
+
+    double flops = 0;
+    for (size_t id = 0; id < thin.size(); ++id) {
+        flops += thin.flops(id);
+    }
+    CHECK(flops > 0, "Tasks should report their flops", errors);
+
+    if (errors.str().empty()) {
+         std::cout << std::left << std::setw(60)
+                   << "[QFormTest1] Test Explicit Q Formation"
+                   << GREEN << "[Passed]" << RESET << std::endl;
+    } else {
+         std::cout << std::left << std::setw(60)
+                   << "[QFormTest1] Test Explicit Q Formation"
+                   << RED << "[Failed]" << RESET << std::endl;
+         std::cout << errors.str();
+    }
+}
+
+int main(int argc, char *argv[]) {
+    std::cout << "Inside Test.\n" << std::endl;
+
+    std::cout << YELLOW << "Starting matrix_t Test Cases." << RESET << std::endl;
+
+    // Run matrix_t test functions
+    test_operator_access();
+    test_get_set();
+    test_save();
+    test_binary_map();
+    test_parse_text_chunks();
+    test_save_text();
+    test_stream_loader();
+    test_matrix_writer();
+    test_padded_storage();
+    test_matrix_view();
+    test_large_offsets();
+    test_block_factorization();
+
+    std::cout << YELLOW << "\nStarting DependencyTable Test Cases." << RESET << std::endl;
+
+    // Run DependencyTable test functions
+    test_default_constructor();
+    test_parameterized_constructor();
+    test_init();
+    test_move_constructor();
+    test_move_assignment();
+    test_get_set_dependency();
+    test_operator_overloading();
+    test_out_of_bounds();
+
+    std::cout << YELLOW << "\nStarting DependencyTableAtomic Test Cases." << RESET << std::endl;
+
+    // Run DependencyTableAtomic test functions
+    test_default_constructor_atomic();
+    test_parameterized_constructor_atomic();
+    test_init_atomic();
+    test_move_constructor_atomic();
+    test_move_assignment_atomic();
+    test_get_set_dependency_atomic();
+    test_operator_overloading_atomic();
+    test_out_of_bounds_atomic();
+
+    std::cout << YELLOW << "\nStarting CircularQueueMtx Test Cases." << RESET << std::endl;
+
+    test_queue_empty_and_size();
+    test_queue_push_pop_fifo();
+    test_queue_push_front_pop_back();
+    test_queue_full();
+    test_queue_multi_threaded();
+    test_queue_stats();
+
+    std::cout << YELLOW << "\nStarting CircularQueueAtomic Test Cases." << RESET << std::endl;
+
+    test_atomic_queue_empty_and_size();
     test_atomic_queue_push_pop_fifo();
     test_atomic_queue_push_front_pop_back();
     test_atomic_queue_full();
     test_atomic_queue_multi_threaded();
     test_atomic_queue_push_and_pop();
 
+    std::cout << YELLOW << "\nStarting MultiQueue Test Cases." << RESET << std::endl;
+
+    test_multiqueue_single_shard_order();
+    test_multiqueue_no_loss();
+    test_multiqueue_multi_threaded();
+
+    std::cout << YELLOW << "\nStarting TaskTable Test Cases." << RESET << std::endl;
+
+    test_task_table_lazy_matches_eager();
+    test_dependency_frontier();
+
+    std::cout << YELLOW << "\nStarting TerminationDetector Test Cases." << RESET << std::endl;
+
+    test_termination_detector_count();
+    test_termination_detector_wakeup();
+
+    std::cout << YELLOW << "\nStarting StaticSchedule Test Cases." << RESET << std::endl;
+
+    test_task_graph_structure();
+    test_static_schedule_round_trip();
+
+    std::cout << YELLOW << "\nStarting OutOfCore Test Cases." << RESET << std::endl;
+
+    test_tile_store_round_trip();
+    test_out_of_core_plan();
+
+    std::cout << YELLOW << "\nStarting Checkpoint Test Cases." << RESET << std::endl;
+
+    test_checkpoint_round_trip();
+    test_checkpoint_resume_rows_behind();
+
+    std::cout << YELLOW << "\nStarting Tracer Test Cases." << RESET << std::endl;
+
+    test_tracer_chrome_json();
+
+    std::cout << YELLOW << "\nStarting PerfCounters Test Cases." << RESET << std::endl;
+
+    test_perf_counters();
+
+    std::cout << YELLOW << "\nStarting RunAnalysis Test Cases." << RESET << std::endl;
+
+    test_run_analysis();
+
+    std::cout << YELLOW << "\nStarting LiveMetrics Test Cases." << RESET << std::endl;
+
+    test_live_metrics();
+
+    std::cout << YELLOW << "\nStarting SchedulerSimulator Test Cases." << RESET << std::endl;
+
+    test_scheduler_simulator();
+
+    std::cout << YELLOW << "\nStarting ScheduleLog Test Cases." << RESET << std::endl;
+
+    test_schedule_log();
+
+    std::cout << YELLOW << "\nStarting FactorizationCheck Test Cases." << RESET << std::endl;
+
+    test_factorization_check();
+
+    std::cout << YELLOW << "\nStarting Timing Test Cases." << RESET << std::endl;
+
+    test_measure_exec_time();
+
+    std::cout << YELLOW << "\nStarting QFormation Test Cases." << RESET << std::endl;
+
+    test_q_formation();
 
     std::cout << std::endl;
 
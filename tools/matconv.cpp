@@ -0,0 +1,42 @@
+#include <iostream>
+#include <string>
+#include <cstdlib>
+#include "bn2.h"
+
+// Converts matrix files between the text and binary formats.
+// The output format defaults to the opposite of the input format.
+int main(int argc, char *argv[]){
+    if (argc < 3 || argc > 4) {
+        std::cerr << "Usage: " << argv[0] << " <input> <output> [--text|--binary]" << std::endl;
+        return EXIT_FAILURE;
+    }
+
+    std::string input = argv[1];
+    std::string output = argv[2];
+
+    try {
+        matrix_t<double> mat(input);
+
+        MatrixFormat format = mat.is_mapped() ? MatrixFormat::Text : MatrixFormat::Binary;
+        if (argc == 4) {
+            std::string option = argv[3];
+            if (option == "--text") {
+                format = MatrixFormat::Text;
+            } else if (option == "--binary") {
+                format = MatrixFormat::Binary;
+            } else {
+                std::cerr << "Unknown option: " << option << std::endl;
+                return EXIT_FAILURE;
+            }
+        }
+
+        mat.save(output, format);
+        std::cout << input << " -> " << output << " (" << mat.rows() << " x " << mat.cols() << ", "
+                  << (format == MatrixFormat::Binary ? "binary" : "text") << ")" << std::endl;
+    } catch (const std::exception& e) {
+        std::cerr << e.what() << std::endl;
+        return EXIT_FAILURE;
+    }
+
+    return 0;
+}
@@ -0,0 +1,28 @@
+#include <iostream>
+#include <string>
+#include <cstdlib>
+#include "schedule_log.h"
+
+// Compares two schedule logs (SCHEDULE_RECORD) of the same matrix task by task, e.g. a
+// slow run (A) against a normal one (B).
+int main(int argc, char *argv[]){
+    if (argc != 3 && !(argc == 5 && std::string(argv[3]) == "--top")) {
+        std::cerr << "Usage: " << argv[0] << " <run_a.log> <run_b.log> [--top N]" << std::endl;
+        return EXIT_FAILURE;
+    }
+
+    try {
+        size_t top = argc == 5 ? std::stoul(argv[4]) : 10;
+        ScheduleLog a = ScheduleLog::load(argv[1]);
+        ScheduleLog b = ScheduleLog::load(argv[2]);
+        std::cout << "A: " << argv[1] << "\nB: " << argv[2] << std::endl;
+        ScheduleDiff diff;
+        diff.compare(a, b);
+        diff.report(std::cout, top);
+    } catch (const std::exception& e) {
+        std::cerr << e.what() << std::endl;
+        return EXIT_FAILURE;
+    }
+
+    return 0;
+}
@@ -0,0 +1,256 @@
+#include <iostream>
+#include <iomanip>
+#include <fstream>
+#include <string>
+#include <vector>
+#include <cstdlib>
+#include <random>
+#include "bn2.h"
+#include "kernels.h"
+#include "scheduler_sim.h"
+
+// Predicts the makespan and utilization of the dynamic scheduler under several ready-queue
+// policies for any matrix size and worker count, without running the factorization.
+// Task durations come from a cost model calibrated on this machine: both kernels are run
+// once over a small matrix and a line (ns = a * flops + b) is fitted per task type; the
+// queue operation is timed on an uncontended CircularQueueMtx.
+
+struct SimOptions {
+    std::vector<int> sizes = {1024, 4096};
+    int cols = 0;                       // Matrix columns, 0: square
+    std::vector<int> threads = {1, 2, 4, 8, 16, 28};
+    std::vector<SimPolicy> policies = {SimPolicy::Fifo, SimPolicy::Rotation, SimPolicy::CriticalPath,
+                                       SimPolicy::WorkStealing};
+    int alpha = 10;
+    int beta = 10;
+    int calibrate = 512;                // Calibration matrix size, 0: use the model as given
+    SimCostModel model;
+    std::vector<bool> fixed = std::vector<bool>(6, false);   // Model terms set on the command line
+    std::string csv;
+};
+
+// Least-squares fit of ns = slope * flops + intercept, with the intercept clamped at 0.
+void fit_line(const std::vector<std::pair<double, double>>& samples, double& slope, double& intercept) {
+    double n = samples.size(), sx = 0, sy = 0, sxx = 0, sxy = 0;
+    for (const auto& s : samples) {
+        sx += s.first;
+        sy += s.second;
+        sxx += s.first * s.first;
+        sxy += s.first * s.second;
+    }
+    double det = n * sxx - sx * sx;
+    slope = det > 0 ? (n * sxy - sx * sy) / det : 0.0;
+    intercept = det > 0 ? (sy - slope * sx) / n : 0.0;
+    if (intercept < 0 || slope <= 0) {
+        intercept = 0;
+        slope = sxx > 0 ? sxy / sxx : 0.0;
+    }
+}
+
+// Runs every task of a size x size matrix in a topological order (once to warm up, once
+// timed) and fits the kernel costs, then times queue operations.
+void calibrate(SimOptions& options) {
+    int size = options.calibrate;
+    matrix_t<double> pristine(size, size);
+    std::mt19937 rng(42);
+    std::uniform_real_distribution<double> dist(-1.0, 1.0);
+    for (int i = 0; i < size; ++i) {
+        for (int j = 0; j < size; ++j) {
+            pristine.set(i, j, dist(rng));
+        }
+    }
+    TaskTable table;
+    table.init((size + options.beta - 1) / options.beta, (size + options.alpha - 1) / options.alpha,
+               options.alpha, options.beta, size, true);
+    TaskGraph graph(table, size);
+
+    std::vector<std::pair<double, double>> samples[2];
+    matrix_t<double> mat(size, size);
+    for (int pass = 0; pass < 2; ++pass) {
+        mat = pristine;
+        global_up_array.assign(size, 0.0);
+        global_b_array.assign(size, 0.0);
+        for (size_t id : graph.topologicalOrder()) {
+            const TaskNode& t = graph.node(id);
+            auto start = std::chrono::steady_clock::now();
+            if (t.type == 1) {
+                complete_task1(mat.view(), size, size, t.row_start, t.row_end, t.col_start, t.col_end);
+            } else {
+                complete_task2(mat.view(), size, size, t.row_start, t.row_end, t.col_start, t.col_end);
+            }
+            double ns = std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - start).count();
+            if (pass == 1) {
+                samples[t.type == 1 ? 0 : 1].emplace_back(t.cost, ns);
+            }
+        }
+    }
+    SimCostModel fitted;
+    for (int k = 0; k < 2; ++k) {
+        fit_line(samples[k], fitted.ns_per_flop[k], fitted.task_ns[k]);
+    }
+
+    const size_t ops = 1 << 20;
+    CircularQueueMtx<size_t> queue(1024);
+    auto start = std::chrono::steady_clock::now();
+    for (size_t k = 0; k < ops; ++k) {
+        queue.push_back(k);
+        queue.pop_front();
+    }
+    fitted.queue_ns = std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - start).count() / (2 * ops);
+    // A steal also moves the victim's queue between caches, which one thread cannot time.
+    fitted.steal_ns = 2 * fitted.queue_ns;
+
+    double* fitted_terms[] = {&fitted.ns_per_flop[0], &fitted.ns_per_flop[1], &fitted.task_ns[0],
+                              &fitted.task_ns[1], &fitted.queue_ns, &fitted.steal_ns};
+    double* terms[] = {&options.model.ns_per_flop[0], &options.model.ns_per_flop[1], &options.model.task_ns[0],
+                       &options.model.task_ns[1], &options.model.queue_ns, &options.model.steal_ns};
+    for (size_t k = 0; k < options.fixed.size(); ++k) {
+        if (!options.fixed[k]) {
+            *terms[k] = *fitted_terms[k];
+        }
+    }
+}
+
+std::vector<int> parse_list(const std::string& text) {
+    std::vector<int> values;
+    std::string item;
+    for (char c : text + ",") {
+        if (c == ',' || c == ' ') {
+            if (!item.empty()) {
+                values.push_back(std::stoi(item));
+            }
+            item.clear();
+        } else {
+            item += c;
+        }
+    }
+    return values;
+}
+
+int main(int argc, char *argv[]) {
+    SimOptions options;
+    for (int k = 1; k < argc; ++k) {
+        std::string arg = argv[k];
+        auto value = [&]() -> std::string {
+            if (k + 1 >= argc) {
+                std::cerr << "Missing value for " << arg << std::endl;
+                std::exit(EXIT_FAILURE);
+            }
+            return argv[++k];
+        };
+        auto term = [&](size_t index, double& target) {
+            target = std::stod(value());
+            options.fixed[index] = true;
+        };
+        try {
+            if (arg == "--sizes") options.sizes = parse_list(value());
+            else if (arg == "--cols") options.cols = std::stoi(value());
+            else if (arg == "--threads") options.threads = parse_list(value());
+            else if (arg == "--alpha") options.alpha = std::stoi(value());
+            else if (arg == "--beta") options.beta = std::stoi(value());
+            else if (arg == "--calibrate") options.calibrate = std::stoi(value());
+            else if (arg == "--panel-ns-per-flop") term(0, options.model.ns_per_flop[0]);
+            else if (arg == "--update-ns-per-flop") term(1, options.model.ns_per_flop[1]);
+            else if (arg == "--panel-task-ns") term(2, options.model.task_ns[0]);
+            else if (arg == "--update-task-ns") term(3, options.model.task_ns[1]);
+            else if (arg == "--queue-ns") term(4, options.model.queue_ns);
+            else if (arg == "--steal-ns") term(5, options.model.steal_ns);
+            else if (arg == "--csv") options.csv = value();
+            else if (arg == "--policies") {
+                options.policies.clear();
+                std::string list = value() + ",", item;
+                for (char c : list) {
+                    if (c == ',') {
+                        if (!item.empty()) options.policies.push_back(parseSimPolicy(item));
+                        item.clear();
+                    } else {
+                        item += c;
+                    }
+                }
+            }
+            else {
+                std::cerr << "Usage: " << argv[0] << " [--sizes LIST] [--cols N] [--threads LIST]"
+                          << " [--policies fifo,rotation,critical,stealing] [--alpha N] [--beta N]"
+                          << " [--calibrate SIZE|0] [--panel-ns-per-flop X] [--update-ns-per-flop X]"
+                          << " [--panel-task-ns X] [--update-task-ns X] [--queue-ns X] [--steal-ns X]"
+                          << " [--csv FILE]" << std::endl;
+                return EXIT_FAILURE;
+            }
+        } catch (const std::exception& e) {
+            std::cerr << "Invalid value for " << arg << ": " << e.what() << std::endl;
+            return EXIT_FAILURE;
+        }
+    }
+    if (options.alpha < 1 || options.beta % options.alpha != 0) {
+        std::cerr << "BETA must be a multiple of ALPHA" << std::endl;
+        return EXIT_FAILURE;
+    }
+
+    try {
+        std::cout << std::fixed << std::setprecision(3);
+        if (options.calibrate > 0) {
+            auto start = std::chrono::steady_clock::now();
+            calibrate(options);
+            std::cout << "Calibrated on " << options.calibrate << " x " << options.calibrate << " in "
+                      << std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count() << " s" << std::endl;
+        }
+        const SimCostModel& model = options.model;
+        std::cout << "Cost model: panel " << model.ns_per_flop[0] << " ns/flop + " << model.task_ns[0]
+                  << " ns, update " << model.ns_per_flop[1] << " ns/flop + " << model.task_ns[1]
+                  << " ns, queue op " << model.queue_ns << " ns, steal " << model.steal_ns << " ns" << std::endl;
+
+        std::ofstream csv;
+        if (!options.csv.empty()) {
+            csv.open(options.csv, std::ios::trunc);
+            if (!csv.is_open()) {
+                throw std::runtime_error("Error opening file for writing: " + options.csv);
+            }
+            csv << "rows,cols,alpha,beta,policy,workers,makespan_ms,utilization,speedup,queue_ms,steals\n";
+        }
+
+        for (int rows : options.sizes) {
+            int cols = options.cols > 0 ? options.cols : rows;
+            auto start = std::chrono::steady_clock::now();
+            TaskTable table;
+            table.init((rows + options.beta - 1) / options.beta, (rows + options.alpha - 1) / options.alpha,
+                       options.alpha, options.beta, rows, true);
+            TaskGraph graph(table, cols);
+            SchedulerSimulator simulator(graph, model);
+
+            std::cout << "\n" << rows << " x " << cols << " (ALPHA " << options.alpha << ", BETA " << options.beta
+                      << "): " << graph.size() << " tasks, work " << simulator.workNs() / 1e6 << " ms, critical path "
+                      << simulator.criticalPathNs() / 1e6 << " ms" << std::endl;
+            std::cout << "  " << std::left << std::setw(10) << "policy" << std::right << std::setw(8) << "workers"
+                      << std::setw(14) << "makespan_ms" << std::setw(13) << "utilization" << std::setw(10) << "speedup"
+                      << std::setw(12) << "queue_ms" << std::setw(9) << "steals" << std::endl;
+            for (SimPolicy policy : options.policies) {
+                for (int workers : options.threads) {
+                    SimResult r = simulator.run(policy, workers);
+                    std::cout << "  " << std::left << std::setw(10) << simPolicyName(policy) << std::right
+                              << std::setw(8) << workers << std::setw(14) << r.makespan_ns / 1e6
+                              << std::setw(12) << 100.0 * r.utilization() << "%" << std::setw(10) << r.speedup()
+                              << std::setw(12) << r.queue_ns / 1e6 << std::setw(9) << r.steals << std::endl;
+                    if (csv.is_open()) {
+                        csv << rows << "," << cols << "," << options.alpha << "," << options.beta << ","
+                            << simPolicyName(policy) << "," << workers << "," << r.makespan_ns / 1e6 << ","
+                            << r.utilization() << "," << r.speedup() << "," << r.queue_ns / 1e6 << "," << r.steals << "\n";
+                    }
+                }
+            }
+            std::cout << "  (simulated in " << std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count()
+                      << " s)" << std::endl;
+        }
+        if (csv.is_open()) {
+            csv.close();
+            if (csv.fail()) {
+                throw std::runtime_error("Error writing results to file: " + options.csv);
+            }
+            std::cout << "\nResults written to " << options.csv << std::endl;
+        }
+    } catch (const std::exception& e) {
+        std::cerr << e.what() << std::endl;
+        return EXIT_FAILURE;
+    }
+
+    return 0;
+}